@@ -17,9 +17,14 @@
 
 #include <assert.h>
 
+#include <algorithm>
+
 #include "AtlasContainer.h"
+#include "AtlasWriter.h"
 #include "CmdLineOptions.h"
 #include "TextureObject.h"
+#include "Packer.h"
+#include "ThreadPool.h"
 
 //-----------------------------------------------------------------------------
 // Name: AtlasContainer()
@@ -54,23 +59,35 @@ AtlasContainer::~AtlasContainer()
 //       Update the passed in textures to point at their relevant atlases:
 //       This modifies the pointed at data, but the vector in fact stays const.
 //       Optionally adds a margin (pixels) around the image when it is embedded into the atlas image (transparent empty space between images)
+//       2D atlases use the packer pPackerName names, or if it is nullptr
+//       the one selected w/ -packer.
+//       Inserts into different atlas vectors can run concurrently: each only
+//       touches its own atlas vector.  The atlases are numbered within their
+//       vector here, NumberAtlases() gives them their final ids.
 //-----------------------------------------------------------------------------
-void AtlasContainer::Insert(int i, TTexture2DPtrVector const &textureVector, LONG margin)
+void AtlasContainer::Insert(int i, TTexture2DPtrVector const &textureVector, LONG margin, char const *pPackerName)
 {
+    bool const kBestFit = mpOptions->IsSet(CLO_BESTFIT) && ! mpOptions->IsSet(CLO_VOLUME);
+
     // for each texture in the vector
-    int     totalNumAtlases = 0;
+    int     totalNumAtlases = static_cast<int>(mpAtlasVectorArray[i].size());
     TTexture2DPtrVector::const_iterator   texIter;
     for (texIter = textureVector.begin(); texIter != textureVector.end(); ++texIter)  
     {
         // try inserting this texture into all existing elements of the atlas vector:
         // if they all fail (ie they are full), then create a new atlas and insert it there.
         TAtlasVector::iterator    atlas;
-        for (atlas = mpAtlasVectorArray[i].begin(); atlas != mpAtlasVectorArray[i].end(); ++atlas)
+        if (kBestFit)
+            atlas = InsertBestFit(i, *texIter, margin);
+        else
         {
-            if ((*atlas)->Insert(*texIter, margin))
+            for (atlas = mpAtlasVectorArray[i].begin(); atlas != mpAtlasVectorArray[i].end(); ++atlas)
             {
-                // Texture was successfully added into an existing atlas
-                break;
+                if ((*atlas)->Insert(*texIter, margin))
+                {
+                    // Texture was successfully added into an existing atlas
+                    break;
+                }
             }
         }
 
@@ -91,7 +108,7 @@ void AtlasContainer::Insert(int i, TTexture2DPtrVector const &textureVector, LON
             }
             else
             {
-                Atlas2D *    p2DAtlas = new Atlas2D(*mpOptions, *texIter, totalNumAtlases);
+                Atlas2D *    p2DAtlas = new Atlas2D(*mpOptions, *texIter, margin, totalNumAtlases, pPackerName);
                 mpAtlasVectorArray[i].push_back(p2DAtlas);
                 ++totalNumAtlases;
             }
@@ -99,22 +116,103 @@ void AtlasContainer::Insert(int i, TTexture2DPtrVector const &textureVector, LON
     }
 }
 
+//-----------------------------------------------------------------------------
+// Name: NumberAtlases()
+// Desc: Gives all atlases their final ids, and thus filenames: they are 
+//       numbered through all atlas vectors, in the order of the vectors and 
+//       then in the order the atlases were created.  The numbers thus do not
+//       depend on which vector was filled first, and atlases of different 
+//       formats do not end up w/ the same filename.
+//-----------------------------------------------------------------------------
+void AtlasContainer::NumberAtlases()
+{
+    int id = 0;
+    TAtlasVector::iterator    atlas;
+    for (int i = 0; i < mNumFormats; ++i)
+        for (atlas = mpAtlasVectorArray[i].begin(); atlas != mpAtlasVectorArray[i].end(); ++atlas)
+            (*atlas)->SetId(*mpOptions, id++);
+}
+
+//-----------------------------------------------------------------------------
+// Name: PrintStatistics()
+// Desc: Reports how the packing went, atlas by atlas
+//-----------------------------------------------------------------------------
+void AtlasContainer::PrintStatistics() const
+{
+    TAtlasVector::const_iterator    atlas;
+    for (int i = 0; i < mNumFormats; ++i)
+        for (atlas = mpAtlasVectorArray[i].begin(); atlas != mpAtlasVectorArray[i].end(); ++atlas)
+            (*atlas)->PrintStatistics();
+}
+
+//-----------------------------------------------------------------------------
+// Name: InsertBestFit()
+// Desc: -bestfit: looks up a spot for the texture in every 2D atlas of 
+//       format i and inserts it into the best one (see 
+//       Packer2D::IsBetterFit()).  Returns the atlas it went into, or the 
+//       end of the atlas vector if it fits nowhere.
+//-----------------------------------------------------------------------------
+TAtlasVector::iterator AtlasContainer::InsertBestFit(int i, Texture2D *pTexture, LONG margin)
+{
+    TAtlasVector::iterator  best = mpAtlasVectorArray[i].end();
+    Placement               bestPlacement;
+
+    TAtlasVector::iterator  atlas;
+    for (atlas = mpAtlasVectorArray[i].begin(); atlas != mpAtlasVectorArray[i].end(); ++atlas)
+    {
+        assert((*atlas)->GetType() == TextureObject::TEXTYPE_ATLAS2D);
+
+        Placement placement;
+        if (   static_cast<Atlas2D *>(*atlas)->FindPlacement(pTexture, margin, placement)
+            && ((best == mpAtlasVectorArray[i].end()) || Packer2D::IsBetterFit(placement, bestPlacement)))
+        {
+            best          = atlas;
+            bestPlacement = placement;
+        }
+    }
+
+    if (best != mpAtlasVectorArray[i].end())
+        static_cast<Atlas2D *>(*best)->InsertAt(pTexture, bestPlacement);
+    return best;
+}
+
 //-----------------------------------------------------------------------------
 // Name: Shrink()
 // Desc: Go through all allocated atlases and attempt to reduce their size
 //       w/o losing data.  If possible, createa new texture corresponding 
 //       to the new size, copy bits over and free the old one.
+//       The atlas vectors are shrunk concurrently, each one a task of its own
+//       w/ its share of the cores, see GetThreadsPerVector().
 //-----------------------------------------------------------------------------
 void AtlasContainer::Shrink() 
 {
-    TAtlasVector::iterator    atlas;
-    for (int i = 0; i < mNumFormats; ++i)
+    int const kThreadsPerVector = GetThreadsPerVector();
+
+    ThreadPool pool((std::min)(mNumFormats, ThreadPool::GetDefaultNumThreads()));
+    pool.Run(mNumFormats, [this, kThreadsPerVector](int i)
     {
+        ThreadPool atlasPool(kThreadsPerVector);
+
+        TAtlasVector::iterator    atlas;
         for (atlas = mpAtlasVectorArray[i].begin(); atlas != mpAtlasVectorArray[i].end(); ++atlas)
         {
-            (*atlas)->Shrink();
+            (*atlas)->Shrink(atlasPool);
         }
-    }
+    });
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetThreadsPerVector()
+// Desc: The threads each atlas vector copies, filters and compresses its 
+//       atlases w/ when all vectors are shrunk at once: the cores split 
+//       evenly among them, so the vectors do not start a full set of 
+//       threads each.  ThreadPool::Run() cannot be nested, so every vector 
+//       gets a pool of its own.
+//-----------------------------------------------------------------------------
+int AtlasContainer::GetThreadsPerVector() const
+{
+    int const kNumThreads = ThreadPool::GetDefaultNumThreads();
+    return (std::max)(1, kNumThreads / (std::min)((std::max)(mNumFormats, 1), kNumThreads));
 }
 
 //-----------------------------------------------------------------------------
@@ -130,3 +228,44 @@ void AtlasContainer::WriteToDisk() const
             (*atlas)->WriteToDisk();
 }
 
+//-----------------------------------------------------------------------------
+// Name: ShrinkAndWriteToDisk()
+// Desc: Shrink() each atlas and hand it straight to an AtlasWriter, which 
+//       writes and frees it while the next atlases are filled, so the output
+//       I/O overlaps the copying.  The atlas vectors are filled concurrently
+//       as in Shrink(); oneAtATime fills them one atlas after the other and 
+//       lets only one atlas wait to be written, so at most two atlases are 
+//       in memory (-stream).
+//-----------------------------------------------------------------------------
+void AtlasContainer::ShrinkAndWriteToDisk(bool oneAtATime)
+{
+    AtlasWriter writer(oneAtATime ? 1 : 0);
+
+    int const kThreadsPerVector = oneAtATime ? 0 : GetThreadsPerVector();
+
+    auto const ShrinkAndWrite = [this, &writer, kThreadsPerVector](int i)
+    {
+        ThreadPool atlasPool(kThreadsPerVector);
+
+        TAtlasVector::iterator    atlas;
+        for (atlas = mpAtlasVectorArray[i].begin(); atlas != mpAtlasVectorArray[i].end(); ++atlas)
+        {
+            (*atlas)->Shrink(atlasPool);
+            writer.Write(*atlas);
+        }
+    };
+
+    if (oneAtATime)
+    {
+        for (int i = 0; i < mNumFormats; ++i)
+            ShrinkAndWrite(i);
+    }
+    else
+    {
+        ThreadPool pool((std::min)(mNumFormats, ThreadPool::GetDefaultNumThreads()));
+        pool.Run(mNumFormats, ShrinkAndWrite);
+    }
+
+    writer.Finish();
+    writer.PrintStatistics();
+}
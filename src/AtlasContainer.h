@@ -35,9 +35,16 @@ public:
     AtlasContainer(CmdLineOptionCollection const &options, int numFormats);
     ~AtlasContainer();
 
-    void Insert(int i, TTexture2DPtrVector const &textureVector, LONG margin);
+    void Insert(int i, TTexture2DPtrVector const &textureVector, LONG margin, char const *pPackerName = nullptr);
+    void NumberAtlases();
+    void PrintStatistics() const;
     void Shrink();
     void WriteToDisk() const;
+    void ShrinkAndWriteToDisk(bool oneAtATime = false);
+
+private:
+    TAtlasVector::iterator InsertBestFit(int i, Texture2D *pTexture, LONG margin);
+    int                    GetThreadsPerVector() const;
 
 private:
     CmdLineOptionCollection const * mpOptions;
@@ -46,4 +53,4 @@ private:
 };
 
 
-#endif TEXTUREOBJECT_H
+#endif // ATLASCONTAINER_H
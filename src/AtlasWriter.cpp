@@ -0,0 +1,147 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: AtlasWriter.cpp
+// Desc: Implementation of the AtlasWriter class
+//-----------------------------------------------------------------------------
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "AtlasWriter.h"
+#include "TextureObject.h"
+#include "ThreadPool.h"
+
+//-----------------------------------------------------------------------------
+// Name: AtlasWriter()
+// Desc: Constructor: maxPending <= 0 lets as many atlases be pending as
+//       there are cores, but at least two, so one can be written while the
+//       next one is filled.  There is a worker per pending atlas, but no
+//       more than there are cores.
+//-----------------------------------------------------------------------------
+AtlasWriter::AtlasWriter(int maxPending)
+    : mMaxPending((maxPending > 0) ? maxPending : (std::max)(ThreadPool::GetDefaultNumThreads(), 2))
+    , mNumPending(0)
+    , mbQuit(false)
+    , mNumWritten(0)
+    , mNumFailed(0)
+    , mBytesWritten(0)
+{
+    int const kNumWorkers = (std::min)(mMaxPending, ThreadPool::GetDefaultNumThreads());
+    for (int i = 0; i < kNumWorkers; ++i)
+        mWorkers.push_back(std::thread(&AtlasWriter::WorkerMain, this));
+}
+
+//-----------------------------------------------------------------------------
+// Name: ~AtlasWriter()
+// Desc: Destructor: writes what is still pending, then joins the workers
+//-----------------------------------------------------------------------------
+AtlasWriter::~AtlasWriter()
+{
+    Finish();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mbQuit = true;
+    }
+    mWorkAvailable.notify_all();
+
+    std::vector<std::thread>::iterator iterWorker;
+    for (iterWorker = mWorkers.begin(); iterWorker != mWorkers.end(); ++iterWorker)
+        iterWorker->join();
+}
+
+//-----------------------------------------------------------------------------
+// Name: Write()
+// Desc: Hands a filled atlas over to be written and freed; waits while
+//       maxPending atlases are already pending
+//-----------------------------------------------------------------------------
+void AtlasWriter::Write(AtlasObject *pAtlas)
+{
+    assert(pAtlas != nullptr);
+
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mRoomAvailable.wait(lock, [this] { return mNumPending < mMaxPending; });
+        mQueue.push_back(pAtlas);
+        ++mNumPending;
+    }
+    mWorkAvailable.notify_one();
+}
+
+//-----------------------------------------------------------------------------
+// Name: Finish()
+// Desc: Waits until all atlases handed over are written
+//-----------------------------------------------------------------------------
+void AtlasWriter::Finish()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mRoomAvailable.wait(lock, [this] { return mNumPending == 0; });
+}
+
+//-----------------------------------------------------------------------------
+// Name: PrintStatistics()
+// Desc: Prints how much was written, and how fast: the bytes over the time
+//       from the start of the first write to the end of the last one,
+//       which includes the time the writes overlapped w/ filling atlases.
+//       Atlases that could not be written are reported on their own.
+//-----------------------------------------------------------------------------
+void AtlasWriter::PrintStatistics() const
+{
+    if (mNumFailed > 0)
+        fprintf( stderr, "Failed to write %d atlases\n", mNumFailed );
+
+    if (mNumWritten == 0)
+        return;
+
+    double const kSeconds   = std::chrono::duration<double>(mLastEnd - mFirstStart).count();
+    double const kMegabytes = static_cast<double>(mBytesWritten) / (1024.0 * 1024.0);
+    if (kSeconds > 0.0)
+        fprintf( stderr, "Wrote %d atlases, %lld bytes (%.1f MB) in %.2f s: %.1f MB/s\n",
+                 mNumWritten, mBytesWritten, kMegabytes, kSeconds, kMegabytes / kSeconds );
+    else
+        fprintf( stderr, "Wrote %d atlases, %lld bytes (%.1f MB)\n", mNumWritten, mBytesWritten, kMegabytes );
+}
+
+//-----------------------------------------------------------------------------
+// Name: WorkerMain()
+// Desc: What each worker thread runs: write and free the atlases in the
+//       order they were handed over
+//-----------------------------------------------------------------------------
+void AtlasWriter::WorkerMain()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        mWorkAvailable.wait(lock, [this] { return mbQuit || ! mQueue.empty(); });
+        if (mQueue.empty())
+            return;
+
+        AtlasObject *pAtlas = mQueue.front();
+        mQueue.pop_front();
+
+        lock.unlock();
+
+        TClock::time_point const kStart = TClock::now();
+        size_t const kBytes = pAtlas->WriteToDisk();
+        TClock::time_point const kEnd = TClock::now();
+        pAtlas->ReleaseImage();
+
+        lock.lock();
+        if (kBytes > 0)
+        {
+            if ((mNumWritten == 0) || (kStart < mFirstStart))
+                mFirstStart = kStart;
+            mLastEnd = (std::max)(mLastEnd, kEnd);
+            mBytesWritten += static_cast<long long>(kBytes);
+            ++mNumWritten;
+        }
+        else
+            ++mNumFailed;
+        --mNumPending;
+        mRoomAvailable.notify_all();
+    }
+}
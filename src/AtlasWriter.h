@@ -0,0 +1,67 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: AtlasWriter.h
+// Desc: Header file for AtlasWriter class
+//-----------------------------------------------------------------------------
+
+#ifndef ATLASWRITER_H
+#define ATLASWRITER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "TATypes.h"
+
+//-----------------------------------------------------------------------------
+// Name: AtlasWriter
+// Desc: Writes finished atlases to disk on worker threads, so the next
+//       atlases can be filled in the meantime.  Write() hands an atlas over:
+//       it is written, and its texels freed, as soon as a worker is free.
+//       At most maxPending atlases are handed over and not yet written;
+//       Write() waits for room, which bounds the memory the atlases take.
+//       Write() may be called from several threads at once.  Finish()
+//       waits until all atlases are written.
+//-----------------------------------------------------------------------------
+class AtlasWriter
+{
+public:
+    AtlasWriter(int maxPending = 0);
+    ~AtlasWriter();
+
+    void Write(AtlasObject *pAtlas);
+    void Finish();
+    void PrintStatistics() const;
+
+private:
+    typedef std::chrono::steady_clock   TClock;
+
+    void WorkerMain();
+
+private:
+    int                         mMaxPending;
+    std::vector<std::thread>    mWorkers;
+    std::mutex                  mMutex;
+    std::condition_variable     mWorkAvailable;     // for the workers
+    std::condition_variable     mRoomAvailable;     // for Write() and Finish()
+
+    std::deque<AtlasObject *>   mQueue;
+    int                         mNumPending;        // queued or being written
+    bool                        mbQuit;
+
+    // what was written, and from when the first write started to when the
+    // last one ended; atlases that could not be written only count as failed
+    int                         mNumWritten;
+    int                         mNumFailed;
+    long long                   mBytesWritten;
+    TClock::time_point          mFirstStart;
+    TClock::time_point          mLastEnd;
+};
+
+#endif // ATLASWRITER_H
@@ -21,7 +21,11 @@
 #include <assert.h>
 
 #include "CmdLineOptions.h"
+#include "DXTCompressor.h"
+#include "MipGenerator.h"
+#include "FormatConverter.h"
 #include "TATypes.h"
+#include "Packer.h"
 
 //-----------------------------------------------------------------------------
 // Name: CmdLineOptionCollection()
@@ -238,6 +242,132 @@ bool    CmdLineOptionCollection::Check() const
     if (mCurrent[CLO_DEPTH].present && mCurrent[CLO_VOLUME].present && (! IsArgPowerOf2(CLO_DEPTH)))
         return false;
 
+    // check that -margin is given a number of texels or auto
+    int margin = 0;
+    if (   mCurrent[CLO_MARGIN].present
+        && (_strcmpi(mCurrent[CLO_MARGIN].pStartArgs[0], "auto") != 0)
+        && ((sscanf_s(mCurrent[CLO_MARGIN].pStartArgs[0], "%i", &margin) != 1) || (margin < 0)))
+    {
+        sprintf_s(string, "%s option requires argument to be an integer of at least 0, or auto.", kShortDescription[CLO_MARGIN]);
+        return PrintError(string);
+    }
+
+
+    // check that the -packer argument names a known packer, 
+    // and warn that volume atlases do not use it
+    if (mCurrent[CLO_PACKER].present && (! Packer2D::IsValidPackerName(mCurrent[CLO_PACKER].pStartArgs[0])))
+    {
+        sprintf_s(string, "%s option requires argument to be one of the packers listed below.", 
+                kShortDescription[CLO_PACKER]);
+        return PrintError(string);
+    }
+    if (mCurrent[CLO_PACKER].present && mCurrent[CLO_VOLUME].present)
+    {
+        sprintf_s(string, "%s fills volume slices one texture at a time and thus ignores %s", 
+                kShortDescription[CLO_VOLUME], kShortDescription[CLO_PACKER]);
+        PrintWarning(string);
+    }
+    // check that -minsize names a size search mode
+    if (   mCurrent[CLO_MINSIZE].present 
+        && (_strcmpi(mCurrent[CLO_MINSIZE].pStartArgs[0], "pow2") != 0) 
+        && (_strcmpi(mCurrent[CLO_MINSIZE].pStartArgs[0], "npot") != 0))
+    {
+        sprintf_s(string, "%s option requires argument to be pow2 or npot.", kShortDescription[CLO_MINSIZE]);
+        return PrintError(string);
+    }
+    if (mCurrent[CLO_BESTOF].present && mCurrent[CLO_PACKER].present)
+    {
+        sprintf_s(string, "%s picks the packer itself and thus ignores %s", 
+                kShortDescription[CLO_BESTOF], kShortDescription[CLO_PACKER]);
+        PrintWarning(string);
+    }
+    if (mCurrent[CLO_BESTOF].present && mCurrent[CLO_VOLUME].present)
+    {
+        sprintf_s(string, "%s fills volume slices one texture at a time and thus ignores %s", 
+                kShortDescription[CLO_VOLUME], kShortDescription[CLO_BESTOF]);
+        PrintWarning(string);
+    }
+    if (mCurrent[CLO_ROTATE].present && mCurrent[CLO_VOLUME].present)
+    {
+        sprintf_s(string, "%s fills volume slices one texture at a time and thus ignores %s", 
+                kShortDescription[CLO_VOLUME], kShortDescription[CLO_ROTATE]);
+        PrintWarning(string);
+    }
+    if (mCurrent[CLO_MINSIZE].present && mCurrent[CLO_VOLUME].present)
+    {
+        sprintf_s(string, "%s atlases are not shrunk and thus ignore %s", 
+                kShortDescription[CLO_VOLUME], kShortDescription[CLO_MINSIZE]);
+        PrintWarning(string);
+    }
+    if (mCurrent[CLO_BESTFIT].present && mCurrent[CLO_VOLUME].present)
+    {
+        sprintf_s(string, "%s fills volume slices one texture at a time and thus ignores %s", 
+                kShortDescription[CLO_VOLUME], kShortDescription[CLO_BESTFIT]);
+        PrintWarning(string);
+    }
+    // check that -stream is given a window of at least 1 image
+    int window = 0;
+    if (   mCurrent[CLO_STREAM].present 
+        && ((sscanf_s(mCurrent[CLO_STREAM].pStartArgs[0], "%i", &window) != 1) || (window < 1)))
+    {
+        sprintf_s(string, "%s option requires argument to be an integer greater than 0.", kShortDescription[CLO_STREAM]);
+        return PrintError(string);
+    }
+    if (mCurrent[CLO_STREAM].present && mCurrent[CLO_VOLUME].present)
+    {
+        sprintf_s(string, "%s atlases are filled one texture at a time and thus ignore %s", 
+                kShortDescription[CLO_VOLUME], kShortDescription[CLO_STREAM]);
+        PrintWarning(string);
+    }
+    if (mCurrent[CLO_TAIONLY].present && mCurrent[CLO_VOLUME].present)
+    {
+        sprintf_s(string, "%s atlases are filled one texture at a time and thus ignore %s", 
+                kShortDescription[CLO_VOLUME], kShortDescription[CLO_TAIONLY]);
+        PrintWarning(string);
+    }
+    // check that -format names formats images can be converted to
+    D3DFORMAT format;
+    D3DFORMAT blockFormat;
+    if (   mCurrent[CLO_FORMAT].present 
+        && ! FormatConverter::ParseFormats(mCurrent[CLO_FORMAT].pStartArgs[0], &format, &blockFormat))
+    {
+        sprintf_s(string, "%s option requires argument to be one of %s", kShortDescription[CLO_FORMAT], 
+                "a8r8g8b8, x8r8g8b8, r8g8b8, r5g6b5, a1r5g5b5, x1r5g5b5, a4r4g4b4 or x4r4g4b4, "
+                "one of dxt2, dxt3, dxt4 or dxt5, or one of each separated by a comma.");
+        return PrintError(string);
+    }
+    // check that -compress names a block format and quality
+    D3DFORMAT               compressFormat;
+    DXTCompressor::eQuality compressQuality;
+    if (   mCurrent[CLO_COMPRESS].present 
+        && ! DXTCompressor::ParseTarget(mCurrent[CLO_COMPRESS].pStartArgs[0], &compressFormat, &compressQuality))
+    {
+        sprintf_s(string, "%s option requires argument to be dxt1, dxt5, ati1 or ati2, optionally followed by :fast, :normal or :best.", 
+                kShortDescription[CLO_COMPRESS]);
+        return PrintError(string);
+    }
+    if (mCurrent[CLO_COMPRESS].present && mCurrent[CLO_VOLUME].present)
+    {
+        sprintf_s(string, "%s atlases are not compressed and thus ignore %s", 
+                kShortDescription[CLO_VOLUME], kShortDescription[CLO_COMPRESS]);
+        PrintWarning(string);
+    }
+    // check that -mipfilter names a filter, and that there are mip-maps to make
+    MipGenerator::eFilter   mipFilter;
+    bool                    mipGamma;
+    if (   mCurrent[CLO_MIPFILTER].present 
+        && ! MipGenerator::ParseFilter(mCurrent[CLO_MIPFILTER].pStartArgs[0], &mipFilter, &mipGamma))
+    {
+        sprintf_s(string, "%s option requires argument to be box, kaiser or lanczos, optionally followed by :linear.", 
+                kShortDescription[CLO_MIPFILTER]);
+        return PrintError(string);
+    }
+    if (mCurrent[CLO_MIPFILTER].present && mCurrent[CLO_NOMIPMAP].present)
+    {
+        sprintf_s(string, "%s makes no mip-maps and thus ignores %s", 
+                kShortDescription[CLO_NOMIPMAP], kShortDescription[CLO_MIPFILTER]);
+        PrintWarning(string);
+    }
 
     // Make sure that if -volume is given -nomipmap is also on
     if (mCurrent[CLO_VOLUME].present && !mCurrent[CLO_NOMIPMAP].present)
@@ -41,6 +41,16 @@ enum eCmdLineOptionType
     CLO_WIDTH,
     CLO_HEIGHT,
     CLO_DEPTH,
+    CLO_PACKER,
+    CLO_ROTATE,
+    CLO_BESTOF,
+    CLO_MINSIZE,
+    CLO_BESTFIT,
+    CLO_TAIONLY,
+    CLO_STREAM,
+    CLO_FORMAT,
+    CLO_COMPRESS,
+    CLO_MIPFILTER,
     CLO_OUTFILE,
     CLO_NUM,
 };
@@ -58,6 +68,16 @@ const char kParseString[CLO_NUM][MAX_PARSESTRING_LENGTH] =
     "-width",
     "-height",
     "-depth",
+    "-packer",
+    "-rotate",
+    "-bestof",
+    "-minsize",
+    "-bestfit",
+    "-taionly",
+    "-stream",
+    "-format",
+    "-compress",
+    "-mipfilter",
     "-o",
 };
 
@@ -74,6 +94,16 @@ const char kShortDescription[CLO_NUM][MAX_SHORTDESCRIPTION_LENGTH] =
     "-width <w>",
     "-height <h>",
     "-depth <d>",
+    "-packer <p>",
+    "-rotate",
+    "-bestof",
+    "-minsize <m>",
+    "-bestfit",
+    "-taionly",
+    "-stream <n>",
+    "-format <f>",
+    "-compress <c>",
+    "-mipfilter <f>",
     "-o <filename>",
 };
 
@@ -86,10 +116,20 @@ const char kDescription[CLO_NUM][MAX_DESCRIPTION_LENGTH] =
     "only valid w/ -nomipmap; make atlases volume textures",
     "adds a half-texel offset to the generated texture coordinates",
     "offsets as integer values in TAI atlas dictionary file nstead of 0.0-1.0 normalized float coordinates",
-    "adds a margin of m pixels between images within the atlas texture. The default is 0",
+    "adds a margin of m pixels between images within the atlas texture. The default is 0; auto gives each image one texel (DXTn: block) on each of its mip-levels",
     "limits texture atlases to a maximum width of w texels",
     "limits texture atlases to a maximum height of h texels",
     "limits texture atlases to a maximum depth of d slices",
+    "selects the 2D packing algorithm p: grid (default), maxrects[:bssf|:baf|:bl|:cp], skyline[:waste], guillotine[:baf|:bssf][:sas|:las][:merge] or bitmap",
+    "lets the 2D packers store images rotated by 90 degrees (transposed) where that fits better; adds a <rotated> column to the TAI file",
+    "lays out each format w/ several packers and texture orders in parallel and keeps the layout w/ the fewest atlases, then the fewest texels",
+    "shrinks 2D atlases to the size w/ the fewest bytes (mip-maps included) by repacking: m is pow2 or npot (multiples of 4)",
+    "puts each image into the spot, among all 2D atlases of its format, that grows the used area the least instead of into the first atlas it fits",
+    "only writes the TAI file; PNG, JPEG, GIF and DDS images are laid out from their file headers w/o decoding them",
+    "decodes each image only to copy it into its atlas, up to n images ahead on worker threads, and fills one atlas at a time",
+    "converts uncompressed images to format f so they share atlases: a8r8g8b8 (8888), x8r8g8b8 (x888), r8g8b8 (888), r5g6b5 (565), a1r5g5b5 (1555), x1r5g5b5 (x555), a4r4g4b4 (4444) or x4r4g4b4 (x444), and/or DXTn ones to dxt2-5 where exact",
+    "compresses uncompressed 2D atlases, all mip-maps, to c before writing them: dxt1, dxt5, ati1 (bc4) or ati2 (bc5), optionally followed by :fast, :normal (default) or :best",
+    "makes the mip-maps of 2D atlases from their base level, only w/in each image: box, kaiser or lanczos filter f, in linear space unless followed by :linear",
     "mandatory option that specifies output filename (default.tai, default0.dds)",
 };
 
@@ -107,6 +147,16 @@ const int kNumArguments[CLO_NUM] =
     1,
     1,
     1,
+    0,
+    0,
+    1,
+    0,
+    0,
+    1,
+    1,
+    1,
+    1,
+    1,
 };
 
 //-----------------------------------------------------------------------------
@@ -157,4 +207,4 @@ private:
     char * const *  mpFilenames;
 };
 
-#endif CMDLINEOPTIONS_H
+#endif // CMDLINEOPTIONS_H
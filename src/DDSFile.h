@@ -0,0 +1,162 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: DDSFile.h
+// Desc: DDS file layout (see "DDS_HEADER structure" in the DirectX 
+//       documentation), shared by ImageBuffer::WriteDDS() and ImageProbe
+//-----------------------------------------------------------------------------
+
+#ifndef DDSFILE_H
+#define DDSFILE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ImageBuffer.h"
+
+enum
+{
+    kDDSMagic               = 0x20534444,   // "DDS "
+
+    kDDSD_CAPS              = 0x00000001,
+    kDDSD_HEIGHT            = 0x00000002,
+    kDDSD_WIDTH             = 0x00000004,
+    kDDSD_PITCH             = 0x00000008,
+    kDDSD_PIXELFORMAT       = 0x00001000,
+    kDDSD_MIPMAPCOUNT       = 0x00020000,
+    kDDSD_LINEARSIZE        = 0x00080000,
+    kDDSD_DEPTH             = 0x00800000,
+
+    kDDPF_ALPHAPIXELS       = 0x00000001,
+    kDDPF_ALPHA             = 0x00000002,
+    kDDPF_FOURCC            = 0x00000004,
+    kDDPF_RGB               = 0x00000040,
+    kDDPF_LUMINANCE         = 0x00020000,
+    kDDPF_BUMPDUDV          = 0x00080000,
+
+    kDDSCAPS_COMPLEX        = 0x00000008,
+    kDDSCAPS_TEXTURE        = 0x00001000,
+    kDDSCAPS_MIPMAP         = 0x00400000,
+    kDDSCAPS2_CUBEMAP       = 0x00000200,
+    kDDSCAPS2_VOLUME        = 0x00200000,
+};
+
+struct DDSPixelFormat
+{
+    uint32_t    size;
+    uint32_t    flags;
+    uint32_t    fourCC;
+    uint32_t    rgbBitCount;
+    uint32_t    rBitMask;
+    uint32_t    gBitMask;
+    uint32_t    bBitMask;
+    uint32_t    aBitMask;
+};
+
+struct DDSHeader
+{
+    uint32_t        size;
+    uint32_t        flags;
+    uint32_t        height;
+    uint32_t        width;
+    uint32_t        pitchOrLinearSize;
+    uint32_t        depth;
+    uint32_t        mipMapCount;
+    uint32_t        reserved1[11];
+    DDSPixelFormat  pixelFormat;
+    uint32_t        caps;
+    uint32_t        caps2;
+    uint32_t        caps3;
+    uint32_t        caps4;
+    uint32_t        reserved2;
+};
+
+//-----------------------------------------------------------------------------
+// Name: GetDDSPixelFormat()
+// Desc: Fills in the DDS pixel format of the given D3D format.  Formats
+//       that do not have a mask based description are written w/ their
+//       D3DFORMAT value as the FourCC code, which is what D3DX does too.
+//-----------------------------------------------------------------------------
+inline void GetDDSPixelFormat(D3DFORMAT format, int bitsPerTexel, DDSPixelFormat &pf)
+{
+    memset(&pf, 0, sizeof(pf));
+    pf.size        = sizeof(pf);
+    pf.rgbBitCount = bitsPerTexel;
+
+    switch (format)
+    {
+        case D3DFMT_A8R8G8B8:     pf.flags = kDDPF_RGB | kDDPF_ALPHAPIXELS; pf.rBitMask = 0x00ff0000; pf.gBitMask = 0x0000ff00; pf.bBitMask = 0x000000ff; pf.aBitMask = 0xff000000; break;
+        case D3DFMT_X8R8G8B8:     pf.flags = kDDPF_RGB;                     pf.rBitMask = 0x00ff0000; pf.gBitMask = 0x0000ff00; pf.bBitMask = 0x000000ff; break;
+        case D3DFMT_R8G8B8:       pf.flags = kDDPF_RGB;                     pf.rBitMask = 0x00ff0000; pf.gBitMask = 0x0000ff00; pf.bBitMask = 0x000000ff; break;
+        case D3DFMT_R5G6B5:       pf.flags = kDDPF_RGB;                     pf.rBitMask = 0x0000f800; pf.gBitMask = 0x000007e0; pf.bBitMask = 0x0000001f; break;
+        case D3DFMT_X1R5G5B5:     pf.flags = kDDPF_RGB;                     pf.rBitMask = 0x00007c00; pf.gBitMask = 0x000003e0; pf.bBitMask = 0x0000001f; break;
+        case D3DFMT_A1R5G5B5:     pf.flags = kDDPF_RGB | kDDPF_ALPHAPIXELS; pf.rBitMask = 0x00007c00; pf.gBitMask = 0x000003e0; pf.bBitMask = 0x0000001f; pf.aBitMask = 0x00008000; break;
+        case D3DFMT_A4R4G4B4:     pf.flags = kDDPF_RGB | kDDPF_ALPHAPIXELS; pf.rBitMask = 0x00000f00; pf.gBitMask = 0x000000f0; pf.bBitMask = 0x0000000f; pf.aBitMask = 0x0000f000; break;
+        case D3DFMT_X4R4G4B4:     pf.flags = kDDPF_RGB;                     pf.rBitMask = 0x00000f00; pf.gBitMask = 0x000000f0; pf.bBitMask = 0x0000000f; break;
+        case D3DFMT_R3G3B2:       pf.flags = kDDPF_RGB;                     pf.rBitMask = 0x000000e0; pf.gBitMask = 0x0000001c; pf.bBitMask = 0x00000003; break;
+        case D3DFMT_A8R3G3B2:     pf.flags = kDDPF_RGB | kDDPF_ALPHAPIXELS; pf.rBitMask = 0x000000e0; pf.gBitMask = 0x0000001c; pf.bBitMask = 0x00000003; pf.aBitMask = 0x0000ff00; break;
+        case D3DFMT_A2B10G10R10:  pf.flags = kDDPF_RGB | kDDPF_ALPHAPIXELS; pf.rBitMask = 0x000003ff; pf.gBitMask = 0x000ffc00; pf.bBitMask = 0x3ff00000; pf.aBitMask = 0xc0000000; break;
+        case D3DFMT_A2R10G10B10:  pf.flags = kDDPF_RGB | kDDPF_ALPHAPIXELS; pf.rBitMask = 0x3ff00000; pf.gBitMask = 0x000ffc00; pf.bBitMask = 0x000003ff; pf.aBitMask = 0xc0000000; break;
+        case D3DFMT_A8B8G8R8:     pf.flags = kDDPF_RGB | kDDPF_ALPHAPIXELS; pf.rBitMask = 0x000000ff; pf.gBitMask = 0x0000ff00; pf.bBitMask = 0x00ff0000; pf.aBitMask = 0xff000000; break;
+        case D3DFMT_X8B8G8R8:     pf.flags = kDDPF_RGB;                     pf.rBitMask = 0x000000ff; pf.gBitMask = 0x0000ff00; pf.bBitMask = 0x00ff0000; break;
+        case D3DFMT_G16R16:       pf.flags = kDDPF_RGB;                     pf.rBitMask = 0x0000ffff; pf.gBitMask = 0xffff0000; break;
+        case D3DFMT_A8:           pf.flags = kDDPF_ALPHA;                   pf.aBitMask = 0x000000ff; break;
+        case D3DFMT_L8:           pf.flags = kDDPF_LUMINANCE;               pf.rBitMask = 0x000000ff; break;
+        case D3DFMT_L16:          pf.flags = kDDPF_LUMINANCE;               pf.rBitMask = 0x0000ffff; break;
+        case D3DFMT_A8L8:         pf.flags = kDDPF_LUMINANCE | kDDPF_ALPHAPIXELS; pf.rBitMask = 0x000000ff; pf.aBitMask = 0x0000ff00; break;
+        case D3DFMT_A4L4:         pf.flags = kDDPF_LUMINANCE | kDDPF_ALPHAPIXELS; pf.rBitMask = 0x0000000f; pf.aBitMask = 0x000000f0; break;
+        case D3DFMT_V8U8:         pf.flags = kDDPF_BUMPDUDV;                pf.rBitMask = 0x000000ff; pf.gBitMask = 0x0000ff00; break;
+        case D3DFMT_V16U16:       pf.flags = kDDPF_BUMPDUDV;                pf.rBitMask = 0x0000ffff; pf.gBitMask = 0xffff0000; break;
+        case D3DFMT_Q8W8V8U8:     pf.flags = kDDPF_BUMPDUDV;                pf.rBitMask = 0x000000ff; pf.gBitMask = 0x0000ff00; pf.bBitMask = 0x00ff0000; pf.aBitMask = 0xff000000; break;
+        default:
+            pf.flags       = kDDPF_FOURCC;
+            pf.fourCC      = static_cast<uint32_t>(format);
+            pf.rgbBitCount = 0;
+            break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetD3DFormat()
+// Desc: The reverse of GetDDSPixelFormat(): returns the D3D format the DDS
+//       pixel format describes, D3DFMT_UNKNOWN if it is none this tool 
+//       knows about
+//-----------------------------------------------------------------------------
+inline D3DFORMAT GetD3DFormat(DDSPixelFormat const &pf)
+{
+    if (pf.flags & kDDPF_FOURCC)
+    {
+        D3DFORMAT const kFormat = static_cast<D3DFORMAT>(pf.fourCC);
+        return (ImageBuffer::SizeOfTexel(kFormat) != 0) ? kFormat : D3DFMT_UNKNOWN;
+    }
+
+    static D3DFORMAT const kMaskFormats[] = 
+    {
+        D3DFMT_A8R8G8B8,    D3DFMT_X8R8G8B8,    D3DFMT_R8G8B8,      D3DFMT_R5G6B5,
+        D3DFMT_X1R5G5B5,    D3DFMT_A1R5G5B5,    D3DFMT_A4R4G4B4,    D3DFMT_X4R4G4B4,
+        D3DFMT_R3G3B2,      D3DFMT_A8R3G3B2,    D3DFMT_A2B10G10R10, D3DFMT_A2R10G10B10,
+        D3DFMT_A8B8G8R8,    D3DFMT_X8B8G8R8,    D3DFMT_G16R16,      D3DFMT_A8,
+        D3DFMT_L8,          D3DFMT_L16,         D3DFMT_A8L8,        D3DFMT_A4L4,
+        D3DFMT_V8U8,        D3DFMT_V16U16,      D3DFMT_Q8W8V8U8,
+    };
+
+    uint32_t const kKindFlags = kDDPF_ALPHAPIXELS | kDDPF_ALPHA | kDDPF_RGB | kDDPF_LUMINANCE | kDDPF_BUMPDUDV;
+    for (size_t i = 0; i < sizeof(kMaskFormats) / sizeof(kMaskFormats[0]); ++i)
+    {
+        DDSPixelFormat candidate;
+        GetDDSPixelFormat(kMaskFormats[i], ImageBuffer::SizeOfTexel(kMaskFormats[i]), candidate);
+
+        if (   ((pf.flags & kKindFlags) == candidate.flags)
+            && (pf.rgbBitCount == candidate.rgbBitCount)
+            && (pf.rBitMask    == candidate.rBitMask)
+            && (pf.gBitMask    == candidate.gBitMask)
+            && (pf.bBitMask    == candidate.bBitMask)
+            && (pf.aBitMask    == candidate.aBitMask))
+            return kMaskFormats[i];
+    }
+    return D3DFMT_UNKNOWN;
+}
+
+#endif // DDSFILE_H
@@ -0,0 +1,785 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: DXTCompressor.cpp
+// Desc: Implementation of the DXTCompressor block encoders
+//-----------------------------------------------------------------------------
+
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(__SSE2__)
+#define DXTCOMPRESSOR_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "DXTCompressor.h"
+#include "CmdLineOptions.h"
+#include "FormatConverter.h"
+#include "ImageBuffer.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name: Color / Vector3
+    // Desc: An 8 bit per channel color, and one w/ float channels for the
+    //       endpoint search
+    //-------------------------------------------------------------------------
+    struct Color
+    {
+        int r, g, b;
+    };
+
+    struct Vector3
+    {
+        float r, g, b;
+    };
+
+    //-------------------------------------------------------------------------
+    // Name: Pack565() / Unpack565()
+    // Desc: Color <-> R5G6B5, rounded and widened as FormatConverter does
+    //-------------------------------------------------------------------------
+    inline int Narrow(float value, int bits)
+    {
+        int const kValue = static_cast<int>((std::min)((std::max)(value, 0.0f), 255.0f) + 0.5f);
+        int const x      = kValue * ((1 << bits) - 1) + 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    inline uint16_t Pack565(Vector3 const &color)
+    {
+        return static_cast<uint16_t>((Narrow(color.r, 5) << 11) | (Narrow(color.g, 6) << 5) | Narrow(color.b, 5));
+    }
+
+    inline Color Unpack565(uint16_t value)
+    {
+        int const r = value >> 11;
+        int const g = (value >> 5) & 0x3F;
+        int const b = value & 0x1F;
+        Color const kColor = { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+        return kColor;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: ColorBlock
+    // Desc: The texels of a block split into channels, and which of them
+    //       count: transparent ones (DXT1 only) do not.  rg and b0 hold the
+    //       channels as pairs of 16 bit lanes for the SSE2 distances.
+    //-------------------------------------------------------------------------
+    struct ColorBlock
+    {
+        int     r[16];
+        int     g[16];
+        int     b[16];
+        bool    transparent[16];
+        int     numOpaque;
+#ifdef DXTCOMPRESSOR_SSE2
+        __m128i rg[4];
+        __m128i b0[4];
+#endif
+    };
+
+    //-------------------------------------------------------------------------
+    // Name: Gather()
+    // Desc: Fills a ColorBlock from 16 A8R8G8B8 texels
+    //-------------------------------------------------------------------------
+    void Gather(uint32_t const texels[16], bool allowTransparent, ColorBlock &block)
+    {
+        block.numOpaque = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            block.r[i] = (texels[i] >> 16) & 0xFF;
+            block.g[i] = (texels[i] >>  8) & 0xFF;
+            block.b[i] =  texels[i]        & 0xFF;
+            block.transparent[i] = allowTransparent && ((texels[i] >> 24) < 128);
+            if (! block.transparent[i])
+                ++block.numOpaque;
+        }
+#ifdef DXTCOMPRESSOR_SSE2
+        for (int q = 0; q < 4; ++q)
+        {
+            int const i = 4 * q;
+            block.rg[q] = _mm_setr_epi16(static_cast<short>(block.r[i]),     static_cast<short>(block.g[i]),
+                                         static_cast<short>(block.r[i + 1]), static_cast<short>(block.g[i + 1]),
+                                         static_cast<short>(block.r[i + 2]), static_cast<short>(block.g[i + 2]),
+                                         static_cast<short>(block.r[i + 3]), static_cast<short>(block.g[i + 3]));
+            block.b0[q] = _mm_setr_epi32(block.b[i], block.b[i + 1], block.b[i + 2], block.b[i + 3]);
+        }
+#endif
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: FindIndices()
+    // Desc: Gives each opaque texel the nearest of the first numColors
+    //       palette colors (squared RGB distance, the lower index on ties)
+    //       and transparent ones index 3.  Returns the summed distances.
+    //-------------------------------------------------------------------------
+    long FindIndices(ColorBlock const &block, Color const palette[4], int numColors, uint32_t *pIndices)
+    {
+        int distances[16];
+        int indices[16];
+
+#ifdef DXTCOMPRESSOR_SSE2
+        for (int q = 0; q < 4; ++q)
+        {
+            __m128i best      = _mm_set1_epi32(INT_MAX);
+            __m128i bestIndex = _mm_setzero_si128();
+            for (int k = 0; k < numColors; ++k)
+            {
+                __m128i const kRG = _mm_sub_epi16(block.rg[q], _mm_set1_epi32((palette[k].g << 16) | palette[k].r));
+                __m128i const kB  = _mm_sub_epi16(block.b0[q], _mm_set1_epi32(palette[k].b));
+                __m128i const kD  = _mm_add_epi32(_mm_madd_epi16(kRG, kRG), _mm_madd_epi16(kB, kB));
+                __m128i const kLess = _mm_cmplt_epi32(kD, best);
+                best      = _mm_or_si128(_mm_and_si128(kLess, kD), _mm_andnot_si128(kLess, best));
+                bestIndex = _mm_or_si128(_mm_and_si128(kLess, _mm_set1_epi32(k)), _mm_andnot_si128(kLess, bestIndex));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(distances + 4 * q), best);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(indices   + 4 * q), bestIndex);
+        }
+#else
+        for (int i = 0; i < 16; ++i)
+        {
+            distances[i] = INT_MAX;
+            indices[i]   = 0;
+            for (int k = 0; k < numColors; ++k)
+            {
+                int const dr = block.r[i] - palette[k].r;
+                int const dg = block.g[i] - palette[k].g;
+                int const db = block.b[i] - palette[k].b;
+                int const d  = dr * dr + dg * dg + db * db;
+                if (d < distances[i])
+                {
+                    distances[i] = d;
+                    indices[i]   = k;
+                }
+            }
+        }
+#endif
+
+        long     error = 0;
+        uint32_t bits  = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            if (block.transparent[i])
+                indices[i] = 3;
+            else
+                error += distances[i];
+            bits |= static_cast<uint32_t>(indices[i]) << (2 * i);
+        }
+        *pIndices = bits;
+        return error;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: ColorFit
+    // Desc: A candidate color block: its endpoints, indices and error
+    //-------------------------------------------------------------------------
+    struct ColorFit
+    {
+        uint16_t    color0;
+        uint16_t    color1;
+        uint32_t    indices;
+        long        error;
+    };
+
+    //-------------------------------------------------------------------------
+    // Name: Evaluate()
+    // Desc: Quantizes the endpoints, orders them for the 4 color mode
+    //       (color0 > color1) or the 3 color one (color0 <= color1), and
+    //       picks the indices
+    //-------------------------------------------------------------------------
+    ColorFit Evaluate(ColorBlock const &block, Vector3 const &end0, Vector3 const &end1, bool threeColor)
+    {
+        ColorFit fit;
+        fit.color0 = Pack565(end0);
+        fit.color1 = Pack565(end1);
+        if ((fit.color0 < fit.color1) != threeColor)
+            std::swap(fit.color0, fit.color1);
+
+        Color palette[4];
+        palette[0] = Unpack565(fit.color0);
+        palette[1] = Unpack565(fit.color1);
+
+        int numColors = 4;
+        if (fit.color0 == fit.color1)
+        {
+            // every texel gets color0, in either mode
+            numColors = 1;
+        }
+        else if (threeColor)
+        {
+            palette[2].r = (palette[0].r + palette[1].r) / 2;
+            palette[2].g = (palette[0].g + palette[1].g) / 2;
+            palette[2].b = (palette[0].b + palette[1].b) / 2;
+            numColors = 3;
+        }
+        else
+        {
+            palette[2].r = (2 * palette[0].r + palette[1].r + 1) / 3;
+            palette[2].g = (2 * palette[0].g + palette[1].g + 1) / 3;
+            palette[2].b = (2 * palette[0].b + palette[1].b + 1) / 3;
+            palette[3].r = (palette[0].r + 2 * palette[1].r + 1) / 3;
+            palette[3].g = (palette[0].g + 2 * palette[1].g + 1) / 3;
+            palette[3].b = (palette[0].b + 2 * palette[1].b + 1) / 3;
+        }
+
+        fit.error = FindIndices(block, palette, numColors, &fit.indices);
+        return fit;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: BoundingBoxEndpoints()
+    // Desc: QUALITY_FAST: the corners of the bounding box of the opaque
+    //       texels, inset by 1/16 of its size, along the diagonal that
+    //       follows the sign of the covariance w/ the widest channel
+    //-------------------------------------------------------------------------
+    void BoundingBoxEndpoints(ColorBlock const &block, Vector3 &end0, Vector3 &end1)
+    {
+        int const * const kChannels[3] = { block.r, block.g, block.b };
+
+        float low[3];
+        float high[3];
+        float mean[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            int minimum = 255;
+            int maximum = 0;
+            int sum     = 0;
+            for (int i = 0; i < 16; ++i)
+            {
+                if (block.transparent[i])
+                    continue;
+                minimum = (std::min)(minimum, kChannels[c][i]);
+                maximum = (std::max)(maximum, kChannels[c][i]);
+                sum    += kChannels[c][i];
+            }
+            float const kInset = (maximum - minimum) / 16.0f;
+            low[c]  = minimum + kInset;
+            high[c] = maximum - kInset;
+            mean[c] = static_cast<float>(sum) / block.numOpaque;
+        }
+
+        int widest = 0;
+        for (int c = 1; c < 3; ++c)
+            if (high[c] - low[c] > high[widest] - low[widest])
+                widest = c;
+
+        for (int c = 0; c < 3; ++c)
+        {
+            float covariance = 0.0f;
+            for (int i = 0; i < 16; ++i)
+                if (! block.transparent[i])
+                    covariance += (kChannels[widest][i] - mean[widest]) * (kChannels[c][i] - mean[c]);
+            if (covariance < 0.0f)
+                std::swap(low[c], high[c]);
+        }
+
+        end0.r = high[0];   end0.g = high[1];   end0.b = high[2];
+        end1.r = low[0];    end1.g = low[1];    end1.b = low[2];
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: PrincipalAxisEndpoints()
+    // Desc: QUALITY_NORMAL and _BEST: the opaque texels furthest apart along
+    //       the principal axis of their covariance (by power iteration)
+    //-------------------------------------------------------------------------
+    void PrincipalAxisEndpoints(ColorBlock const &block, Vector3 &end0, Vector3 &end1)
+    {
+        Vector3 mean = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; ++i)
+        {
+            if (block.transparent[i])
+                continue;
+            mean.r += block.r[i];
+            mean.g += block.g[i];
+            mean.b += block.b[i];
+        }
+        mean.r /= block.numOpaque;
+        mean.g /= block.numOpaque;
+        mean.b /= block.numOpaque;
+
+        float rr = 0.0f, rg = 0.0f, rb = 0.0f, gg = 0.0f, gb = 0.0f, bb = 0.0f;
+        for (int i = 0; i < 16; ++i)
+        {
+            if (block.transparent[i])
+                continue;
+            float const r = block.r[i] - mean.r;
+            float const g = block.g[i] - mean.g;
+            float const b = block.b[i] - mean.b;
+            rr += r * r;    rg += r * g;    rb += r * b;
+            gg += g * g;    gb += g * b;    bb += b * b;
+        }
+
+        Vector3 axis = { 1.0f, 1.0f, 1.0f };
+        for (int iteration = 0; iteration < 8; ++iteration)
+        {
+            Vector3 const kNext = { rr * axis.r + rg * axis.g + rb * axis.b,
+                                    rg * axis.r + gg * axis.g + gb * axis.b,
+                                    rb * axis.r + gb * axis.g + bb * axis.b };
+            float const kLength = (std::max)((std::max)(fabsf(kNext.r), fabsf(kNext.g)), fabsf(kNext.b));
+            if (kLength < 1e-6f)
+                break;
+            axis.r = kNext.r / kLength;
+            axis.g = kNext.g / kLength;
+            axis.b = kNext.b / kLength;
+        }
+
+        int   lowest  = -1, highest = -1;
+        float minimum = 0.0f, maximum = 0.0f;
+        for (int i = 0; i < 16; ++i)
+        {
+            if (block.transparent[i])
+                continue;
+            float const t = block.r[i] * axis.r + block.g[i] * axis.g + block.b[i] * axis.b;
+            if ((lowest < 0) || (t < minimum))
+            {
+                lowest  = i;
+                minimum = t;
+            }
+            if ((highest < 0) || (t > maximum))
+            {
+                highest = i;
+                maximum = t;
+            }
+        }
+
+        end0.r = static_cast<float>(block.r[highest]);
+        end0.g = static_cast<float>(block.g[highest]);
+        end0.b = static_cast<float>(block.b[highest]);
+        end1.r = static_cast<float>(block.r[lowest]);
+        end1.g = static_cast<float>(block.g[lowest]);
+        end1.b = static_cast<float>(block.b[lowest]);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: RefineEndpoints()
+    // Desc: The endpoints that fit the texels best (least squares) for the
+    //       indices of the passed in fit.  Returns false if the indices do
+    //       not determine them, e.g., all texels share one index.
+    //-------------------------------------------------------------------------
+    bool RefineEndpoints(ColorBlock const &block, ColorFit const &fit, bool threeColor, Vector3 &end0, Vector3 &end1)
+    {
+        // the weight of color0 for each index (1 - weight of color1)
+        static float const kWeights4[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        static float const kWeights3[4] = { 1.0f, 0.0f, 0.5f,        0.0f };
+        float const * const kWeights = threeColor ? kWeights3 : kWeights4;
+
+        float   aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        Vector3 ax = { 0.0f, 0.0f, 0.0f };
+        Vector3 bx = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; ++i)
+        {
+            if (block.transparent[i])
+                continue;
+            float const a = kWeights[(fit.indices >> (2 * i)) & 3];
+            float const b = 1.0f - a;
+            aa += a * a;    ab += a * b;    bb += b * b;
+            ax.r += a * block.r[i];     ax.g += a * block.g[i];     ax.b += a * block.b[i];
+            bx.r += b * block.r[i];     bx.g += b * block.g[i];     bx.b += b * block.b[i];
+        }
+
+        float const kDeterminant = aa * bb - ab * ab;
+        if (fabsf(kDeterminant) < 1e-6f)
+            return false;
+
+        float const kInverse = 1.0f / kDeterminant;
+        end0.r = (bb * ax.r - ab * bx.r) * kInverse;
+        end0.g = (bb * ax.g - ab * bx.g) * kInverse;
+        end0.b = (bb * ax.b - ab * bx.b) * kInverse;
+        end1.r = (aa * bx.r - ab * ax.r) * kInverse;
+        end1.g = (aa * bx.g - ab * ax.g) * kInverse;
+        end1.b = (aa * bx.b - ab * ax.b) * kInverse;
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: CompressColorBlock()
+    // Desc: Writes the 8 byte color block of DXT1/DXT5
+    //-------------------------------------------------------------------------
+    void CompressColorBlock(uint32_t const texels[16], DXTCompressor::eQuality quality, bool allowTransparent, UCHAR block[8])
+    {
+        ColorBlock colors;
+        Gather(texels, allowTransparent, colors);
+
+        ColorFit best;
+        if (colors.numOpaque == 0)
+        {
+            // all transparent: 3 color mode (color0 <= color1), all index 3
+            best.color0  = 0;
+            best.color1  = 0;
+            best.indices = 0xFFFFFFFF;
+        }
+        else
+        {
+            bool const kThreeColor = (colors.numOpaque < 16);
+
+            Vector3 end0, end1;
+            if (quality == DXTCompressor::QUALITY_FAST)
+                BoundingBoxEndpoints(colors, end0, end1);
+            else
+                PrincipalAxisEndpoints(colors, end0, end1);
+            best = Evaluate(colors, end0, end1, kThreeColor);
+
+            int const kNumRefinements = (quality == DXTCompressor::QUALITY_BEST)   ? 8
+                                      : (quality == DXTCompressor::QUALITY_NORMAL) ? 1 : 0;
+            for (int i = 0; (i < kNumRefinements) && (best.error > 0); ++i)
+            {
+                if (! RefineEndpoints(colors, best, kThreeColor, end0, end1))
+                    break;
+                ColorFit const kFit = Evaluate(colors, end0, end1, kThreeColor);
+                if (kFit.error >= best.error)
+                    break;
+                best = kFit;
+            }
+        }
+
+        block[0] = static_cast<UCHAR>(best.color0);
+        block[1] = static_cast<UCHAR>(best.color0 >> 8);
+        block[2] = static_cast<UCHAR>(best.color1);
+        block[3] = static_cast<UCHAR>(best.color1 >> 8);
+        for (int i = 0; i < 4; ++i)
+            block[4 + i] = static_cast<UCHAR>(best.indices >> (8 * i));
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: FitAlpha()
+    // Desc: Picks the nearest of the 8 palette values for each value (the
+    //       lower index on ties) and packs the indices (3 bits each) into 
+    //       bits.  Returns the summed squared differences.
+    //-------------------------------------------------------------------------
+    long FitAlpha(UCHAR const values[16], int const palette[8], uint64_t &bits)
+    {
+        int distances[16];
+        int indices[16];
+
+#ifdef DXTCOMPRESSOR_SSE2
+        __m128i const kZero   = _mm_setzero_si128();
+        __m128i const kValues = _mm_loadu_si128(reinterpret_cast<__m128i const *>(values));
+        __m128i const kHalves[2] = { _mm_unpacklo_epi8(kValues, kZero), _mm_unpackhi_epi8(kValues, kZero) };
+        for (int h = 0; h < 2; ++h)
+        {
+            __m128i best      = _mm_set1_epi16(SHRT_MAX);
+            __m128i bestIndex = kZero;
+            for (int k = 0; k < 8; ++k)
+            {
+                __m128i const kDifference = _mm_sub_epi16(kHalves[h], _mm_set1_epi16(static_cast<short>(palette[k])));
+                __m128i const kDistance   = _mm_max_epi16(kDifference, _mm_sub_epi16(kZero, kDifference));
+                __m128i const kLess       = _mm_cmplt_epi16(kDistance, best);
+                best      = _mm_or_si128(_mm_and_si128(kLess, kDistance), _mm_andnot_si128(kLess, best));
+                bestIndex = _mm_or_si128(_mm_and_si128(kLess, _mm_set1_epi16(static_cast<short>(k))), _mm_andnot_si128(kLess, bestIndex));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(distances + 8 * h),     _mm_unpacklo_epi16(best, kZero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(distances + 8 * h + 4), _mm_unpackhi_epi16(best, kZero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(indices   + 8 * h),     _mm_unpacklo_epi16(bestIndex, kZero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(indices   + 8 * h + 4), _mm_unpackhi_epi16(bestIndex, kZero));
+        }
+#else
+        for (int i = 0; i < 16; ++i)
+        {
+            distances[i] = INT_MAX;
+            indices[i]   = 0;
+            for (int k = 0; k < 8; ++k)
+            {
+                int const d = abs(values[i] - palette[k]);
+                if (d < distances[i])
+                {
+                    distances[i] = d;
+                    indices[i]   = k;
+                }
+            }
+        }
+#endif
+
+        long error = 0;
+        bits = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            error += distances[i] * distances[i];
+            bits  |= static_cast<uint64_t>(indices[i]) << (3 * i);
+        }
+        return error;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: ParseTarget()
+// Desc: Reads the -compress argument: dxt1, dxt5, ati1 (bc4) or ati2 (bc5),
+//       optionally followed by :fast, :normal (default) or :best.  Returns
+//       false if it is none of these.
+//-----------------------------------------------------------------------------
+bool DXTCompressor::ParseTarget(char const *pName, D3DFORMAT *pFormat, eQuality *pQuality)
+{
+    char format[16];
+    char const *pColon = strchr(pName, ':');
+    size_t const kLength = (pColon != nullptr) ? static_cast<size_t>(pColon - pName) : strlen(pName);
+    if (kLength >= sizeof(format))
+        return false;
+    memcpy(format, pName, kLength);
+    format[kLength] = '\0';
+
+    if (_strcmpi(format, "dxt1") == 0)
+        *pFormat = D3DFMT_DXT1;
+    else if (_strcmpi(format, "dxt5") == 0)
+        *pFormat = D3DFMT_DXT5;
+    else if ((_strcmpi(format, "ati1") == 0) || (_strcmpi(format, "bc4") == 0))
+        *pFormat = D3DFMT_ATI1;
+    else if ((_strcmpi(format, "ati2") == 0) || (_strcmpi(format, "bc5") == 0))
+        *pFormat = D3DFMT_ATI2;
+    else
+        return false;
+
+    if ((pColon == nullptr) || (_strcmpi(pColon + 1, "normal") == 0))
+        *pQuality = QUALITY_NORMAL;
+    else if (_strcmpi(pColon + 1, "fast") == 0)
+        *pQuality = QUALITY_FAST;
+    else if (_strcmpi(pColon + 1, "best") == 0)
+        *pQuality = QUALITY_BEST;
+    else
+        return false;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetTarget()
+// Desc: Returns false if -compress is not set, otherwise the format and
+//       quality it asks for
+//-----------------------------------------------------------------------------
+bool DXTCompressor::GetTarget(CmdLineOptionCollection const &options, D3DFORMAT *pFormat, eQuality *pQuality)
+{
+    return options.IsSet(CLO_COMPRESS) && ParseTarget(options.GetArgument(CLO_COMPRESS, 0), pFormat, pQuality);
+}
+
+//-----------------------------------------------------------------------------
+// Name: CanCompress()
+// Desc: Returns true if the image is of an uncompressed format and a
+//       multiple of 4 texels wide and high, as DXTn textures have to be
+//-----------------------------------------------------------------------------
+bool DXTCompressor::CanCompress(ImageBuffer const &image)
+{
+    return    image.IsCreated() && FormatConverter::CanConvertFrom(image.GetFormat())
+           && ((image.GetWidth() % 4) == 0) && ((image.GetHeight() % 4) == 0);
+}
+
+//-----------------------------------------------------------------------------
+// Name: Compress()
+// Desc: Creates target in the given DXTn format, w/ the size and levels of
+//       source, and compresses all levels of source into it.  Returns false
+//       if memory ran out.
+//-----------------------------------------------------------------------------
+bool DXTCompressor::Compress(ImageBuffer const &source, D3DFORMAT format, eQuality quality,
+                             ImageBuffer &target, ThreadPool &pool)
+{
+    assert(CanCompress(source));
+    assert(   (format == D3DFMT_DXT1) || (format == D3DFMT_DXT5)
+           || (format == D3DFMT_ATI1) || (format == D3DFMT_ATI2));
+
+    if (! target.Create(format, source.GetWidth(), source.GetHeight(), 1, source.GetLevelCount()))
+        return false;
+
+    struct Task
+    {
+        int     level;
+        long    firstRow;
+        long    endRow;
+    };
+    std::vector<Task> tasks;
+    for (int level = 0; level < target.GetLevelCount(); ++level)
+    {
+        for (long row = 0; row < target.GetNumRows(level); row += kTaskBlockRows)
+        {
+            Task const kTask = { level, row, (std::min)(row + static_cast<long>(kTaskBlockRows), target.GetNumRows(level)) };
+            tasks.push_back(kTask);
+        }
+    }
+
+    pool.Run(static_cast<int>(tasks.size()), [&](int i)
+    {
+        CompressBlockRows(source, target, quality, tasks[i].level, tasks[i].firstRow, tasks[i].endRow);
+    });
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: CompressBlockDXT1()
+// Desc: Compresses 16 A8R8G8B8 texels (row by row) into a DXT1 block;
+//       texels w/ alpha below 128 become transparent
+//-----------------------------------------------------------------------------
+void DXTCompressor::CompressBlockDXT1(uint32_t const texels[16], eQuality quality, UCHAR block[8])
+{
+    CompressColorBlock(texels, quality, true, block);
+}
+
+//-----------------------------------------------------------------------------
+// Name: CompressBlockDXT5()
+// Desc: Compresses 16 A8R8G8B8 texels (row by row) into a DXT5 block: the
+//       alpha block followed by a 4 color mode color block
+//-----------------------------------------------------------------------------
+void DXTCompressor::CompressBlockDXT5(uint32_t const texels[16], eQuality quality, UCHAR block[16])
+{
+    UCHAR alpha[16];
+    for (int i = 0; i < 16; ++i)
+        alpha[i] = static_cast<UCHAR>(texels[i] >> 24);
+
+    CompressAlphaBlock(alpha, quality, block);
+    CompressColorBlock(texels, quality, false, block + 8);
+}
+
+//-----------------------------------------------------------------------------
+// Name: CompressBlockATI1()
+// Desc: Compresses 16 values of one channel (row by row) into an ATI1 block,
+//       which is a DXT5 alpha block
+//-----------------------------------------------------------------------------
+void DXTCompressor::CompressBlockATI1(UCHAR const values[16], eQuality quality, UCHAR block[8])
+{
+    CompressAlphaBlock(values, quality, block);
+}
+
+//-----------------------------------------------------------------------------
+// Name: CompressBlockATI2()
+// Desc: Compresses 16 values of two channels (row by row) into an ATI2 
+//       block: the block of the first (x, red) channel followed by the one
+//       of the second (y, green) channel
+//-----------------------------------------------------------------------------
+void DXTCompressor::CompressBlockATI2(UCHAR const x[16], UCHAR const y[16], eQuality quality, UCHAR block[16])
+{
+    CompressAlphaBlock(x, quality, block);
+    CompressAlphaBlock(y, quality, block + 8);
+}
+
+//-----------------------------------------------------------------------------
+// Name: CompressAlphaBlock()
+// Desc: Compresses 16 8 bit values into a DXT5 alpha block
+//-----------------------------------------------------------------------------
+void DXTCompressor::CompressAlphaBlock(UCHAR const values[16], eQuality quality, UCHAR block[8])
+{
+    int minimum = 255;
+    int maximum = 0;
+    int innerMinimum = 255;     // w/o 0 and 255
+    int innerMaximum = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        minimum = (std::min)(minimum, static_cast<int>(values[i]));
+        maximum = (std::max)(maximum, static_cast<int>(values[i]));
+        if ((values[i] > 0) && (values[i] < 255))
+        {
+            innerMinimum = (std::min)(innerMinimum, static_cast<int>(values[i]));
+            innerMaximum = (std::max)(innerMaximum, static_cast<int>(values[i]));
+        }
+    }
+
+    // 8 value mode (alpha0 > alpha1), unless all values are the same: then
+    // the 6 value mode's alpha0 is exact
+    int palette[8];
+    palette[0] = maximum;
+    palette[1] = minimum;
+    for (int k = 1; k < 7; ++k)
+        palette[k + 1] = ((7 - k) * maximum + k * minimum + 3) / 7;
+
+    uint64_t bits;
+    long     error = FitAlpha(values, palette, bits);
+    int      alpha0 = maximum;
+    int      alpha1 = minimum;
+
+    // 6 value mode (alpha0 <= alpha1) over the values other than 0 and 255
+    if ((quality == QUALITY_BEST) && (error > 0) && (innerMinimum <= innerMaximum))
+    {
+        int palette6[8];
+        palette6[0] = innerMinimum;
+        palette6[1] = innerMaximum;
+        for (int k = 1; k < 5; ++k)
+            palette6[k + 1] = ((5 - k) * innerMinimum + k * innerMaximum + 2) / 5;
+        palette6[6] = 0;
+        palette6[7] = 255;
+
+        uint64_t bits6;
+        long const kError6 = FitAlpha(values, palette6, bits6);
+        if (kError6 < error)
+        {
+            bits   = bits6;
+            alpha0 = innerMinimum;
+            alpha1 = innerMaximum;
+        }
+    }
+
+    block[0] = static_cast<UCHAR>(alpha0);
+    block[1] = static_cast<UCHAR>(alpha1);
+    for (int i = 0; i < 6; ++i)
+        block[2 + i] = static_cast<UCHAR>(bits >> (8 * i));
+}
+
+//-----------------------------------------------------------------------------
+// Name: CompressBlockRows()
+// Desc: Compresses block rows [firstRow, endRow) of the given level.  The
+//       texels are converted to A8R8G8B8 4 rows at a time; blocks reaching
+//       past the edge of small levels repeat the last row and column.
+//       ATI1 keeps the red channel and ATI2 red and green, except that of
+//       A8 sources ATI1 keeps alpha, and of A8L8 ones ATI2 keeps luminance
+//       and alpha.
+//-----------------------------------------------------------------------------
+void DXTCompressor::CompressBlockRows(ImageBuffer const &source, ImageBuffer &target, eQuality quality,
+                                      int level, long firstRow, long endRow)
+{
+    long const      kWidth       = source.GetWidth(level);
+    long const      kHeight      = source.GetHeight(level);
+    D3DFORMAT const kFormat      = target.GetFormat();
+    int const       kBlockBytes  = ((kFormat == D3DFMT_DXT1) || (kFormat == D3DFMT_ATI1)) ? 8 : 16;
+
+    // the A8R8G8B8 bytes ATI1/ATI2 keep: red (and green), alpha for A8
+    // (and for the second channel of A8L8)
+    int const kShiftX = (source.GetFormat() == D3DFMT_A8)   ? 24 : 16;
+    int const kShiftY = (source.GetFormat() == D3DFMT_A8L8) ? 24 : 8;
+
+    std::vector<uint32_t> rows(4 * static_cast<size_t>(kWidth));
+    for (long row = firstRow; row < endRow; ++row)
+    {
+        for (long y = 0; y < 4; ++y)
+            FormatConverter::ConvertRow(source.GetFormat(), source.GetRow(level, (std::min)(4 * row + y, kHeight - 1)),
+                                        D3DFMT_A8R8G8B8, reinterpret_cast<UCHAR *>(&rows[y * kWidth]), kWidth);
+
+        UCHAR *pBlock = target.GetRow(level, row);
+        for (long column = 0; column < (kWidth + 3) / 4; ++column, pBlock += kBlockBytes)
+        {
+            uint32_t texels[16];
+            for (long y = 0; y < 4; ++y)
+                for (long x = 0; x < 4; ++x)
+                    texels[4 * y + x] = rows[y * kWidth + (std::min)(4 * column + x, kWidth - 1)];
+
+            UCHAR channelX[16];
+            UCHAR channelY[16];
+            switch (static_cast<DWORD>(kFormat))
+            {
+                case D3DFMT_DXT1:
+                    CompressBlockDXT1(texels, quality, pBlock);
+                    break;
+                case D3DFMT_DXT5:
+                    CompressBlockDXT5(texels, quality, pBlock);
+                    break;
+                case D3DFMT_ATI1:
+                    for (int i = 0; i < 16; ++i)
+                        channelX[i] = static_cast<UCHAR>(texels[i] >> kShiftX);
+                    CompressBlockATI1(channelX, quality, pBlock);
+                    break;
+                case D3DFMT_ATI2:
+                    for (int i = 0; i < 16; ++i)
+                    {
+                        channelX[i] = static_cast<UCHAR>(texels[i] >> 16);
+                        channelY[i] = static_cast<UCHAR>(texels[i] >> kShiftY);
+                    }
+                    CompressBlockATI2(channelX, channelY, quality, pBlock);
+                    break;
+                default:
+                    assert(false);
+                    break;
+            }
+        }
+    }
+}
@@ -0,0 +1,75 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: DXTCompressor.h
+// Desc: Header file for DXTCompressor class
+//-----------------------------------------------------------------------------
+
+#ifndef DXTCOMPRESSOR_H
+#define DXTCOMPRESSOR_H
+
+#include <stdint.h>
+
+#include "HeadlessTypes.h"
+
+class CmdLineOptionCollection;
+class ImageBuffer;
+class ThreadPool;
+
+//-----------------------------------------------------------------------------
+// Name: DXTCompressor
+// Desc: Compresses uncompressed atlases to DXT1 (BC1), DXT5 (BC3), ATI1 
+//       (BC4, one channel) or ATI2 (BC5, two channels), all mip-levels,
+//       before they are written (-compress).  The block rows of all levels
+//       are compressed in bands on a ThreadPool.
+//
+//       The color endpoints are found from the opaque texels of a block:
+//       QUALITY_FAST takes the corners of their bounding box,
+//       QUALITY_NORMAL the extremes along their principal axis, refined
+//       once by least squares, and QUALITY_BEST keeps refining while the
+//       error drops.  Each texel then gets the nearest of the 4 palette
+//       colors; the distances are computed 4 texels at a time w/ SSE2 where
+//       the compiler targets it, w/ the same integer results as the scalar
+//       code.  DXT1 blocks w/ texels whose alpha is below 128 use the 3
+//       color mode, those texels become transparent.  DXT5 alpha blocks,
+//       and the channel blocks of ATI1/ATI2, which are made the same way,
+//       use the 8 value mode over the range of the values; QUALITY_BEST
+//       also tries the 6 value mode, which has exact 0 and 255.  Their
+//       indices are picked 8 values at a time w/ SSE2.
+//-----------------------------------------------------------------------------
+class DXTCompressor
+{
+public:
+    enum eQuality
+    {
+        QUALITY_FAST = 0,
+        QUALITY_NORMAL,
+        QUALITY_BEST,
+    };
+
+public:
+    static bool ParseTarget(char const *pName, D3DFORMAT *pFormat, eQuality *pQuality);
+    static bool GetTarget(CmdLineOptionCollection const &options, D3DFORMAT *pFormat, eQuality *pQuality);
+    static bool CanCompress(ImageBuffer const &image);
+    static bool Compress(ImageBuffer const &source, D3DFORMAT format, eQuality quality,
+                         ImageBuffer &target, ThreadPool &pool);
+
+    static void CompressBlockDXT1(uint32_t const texels[16], eQuality quality, UCHAR block[8]);
+    static void CompressBlockDXT5(uint32_t const texels[16], eQuality quality, UCHAR block[16]);
+    static void CompressBlockATI1(UCHAR const values[16], eQuality quality, UCHAR block[8]);
+    static void CompressBlockATI2(UCHAR const x[16], UCHAR const y[16], eQuality quality, UCHAR block[16]);
+    static void CompressAlphaBlock(UCHAR const values[16], eQuality quality, UCHAR block[8]);
+
+private:
+    enum
+    {
+        kTaskBlockRows = 16,            // rows of 4x4 blocks each task compresses
+    };
+
+    static void CompressBlockRows(ImageBuffer const &source, ImageBuffer &target, eQuality quality,
+                                  int level, long firstRow, long endRow);
+};
+
+#endif // DXTCOMPRESSOR_H
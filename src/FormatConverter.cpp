@@ -0,0 +1,744 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: FormatConverter.cpp
+// Desc: Implementation of the FormatConverter row converters
+//-----------------------------------------------------------------------------
+
+#include <assert.h>
+#include <string.h>
+
+#include <utility>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(__SSE2__)
+#define FORMATCONVERTER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "FormatConverter.h"
+#include "CmdLineOptions.h"
+#include "ImageBuffer.h"
+
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name: Layout16
+    // Desc: Where the channels of a 16 bit format are: shift and width of
+    //       blue, green, red and alpha (0 bits: not stored), and the bits
+    //       written as ones (X channel)
+    //-------------------------------------------------------------------------
+    struct Layout16
+    {
+        int         shift[4];
+        int         bits[4];
+        uint16_t    fill;
+    };
+
+    Layout16 const kLayoutR5G6B5   = { { 0, 5, 11,  0 }, { 5, 6, 5, 0 }, 0x0000 };
+    Layout16 const kLayoutX1R5G5B5 = { { 0, 5, 10,  0 }, { 5, 5, 5, 0 }, 0x8000 };
+    Layout16 const kLayoutA1R5G5B5 = { { 0, 5, 10, 15 }, { 5, 5, 5, 1 }, 0x0000 };
+    Layout16 const kLayoutA4R4G4B4 = { { 0, 4,  8, 12 }, { 4, 4, 4, 4 }, 0x0000 };
+    Layout16 const kLayoutX4R4G4B4 = { { 0, 4,  8,  0 }, { 4, 4, 4, 0 }, 0xF000 };
+
+    uint32_t const kOpaque = 0xFF000000;
+
+    //-------------------------------------------------------------------------
+    // Name: GetLayout16()
+    // Desc: The channel layout of a 16 bit RGB format, nullptr for others
+    //-------------------------------------------------------------------------
+    Layout16 const * GetLayout16(D3DFORMAT format)
+    {
+        switch (format)
+        {
+            case D3DFMT_R5G6B5:     return &kLayoutR5G6B5;
+            case D3DFMT_X1R5G5B5:   return &kLayoutX1R5G5B5;
+            case D3DFMT_A1R5G5B5:   return &kLayoutA1R5G5B5;
+            case D3DFMT_A4R4G4B4:   return &kLayoutA4R4G4B4;
+            case D3DFMT_X4R4G4B4:   return &kLayoutX4R4G4B4;
+            default:                return nullptr;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: Widen()
+    // Desc: Widens a channel of 1 or 4 to 7 bits to 8 bits by replicating
+    //       its high bits, so 0 stays 0 and all ones become 255
+    //-------------------------------------------------------------------------
+    inline uint32_t Widen(uint32_t value, int bits)
+    {
+        assert((bits == 1) || ((bits >= 4) && (bits <= 7)));
+        return (bits == 1) ? value * 255 : (value << (8 - bits)) | (value >> (2 * bits - 8));
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: Narrow()
+    // Desc: Narrows an 8 bit channel to the given number of bits, rounding
+    //       value * (2^bits - 1) / 255 to nearest w/o a division
+    //-------------------------------------------------------------------------
+    inline uint32_t Narrow(uint32_t value, int bits)
+    {
+        uint32_t const x = value * ((1u << bits) - 1) + 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: Load32() / Store32()
+    // Desc: Unaligned little endian access to the texels of R8G8B8 rows
+    //-------------------------------------------------------------------------
+    inline uint32_t Load32(UCHAR const *pBytes)
+    {
+        uint32_t value;
+        memcpy(&value, pBytes, sizeof(value));
+        return value;
+    }
+
+    inline void Store32(UCHAR *pBytes, uint32_t value)
+    {
+        memcpy(pBytes, &value, sizeof(value));
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: SwapRB()
+    // Desc: A8R8G8B8 <-> A8B8G8R8
+    //-------------------------------------------------------------------------
+    inline uint32_t SwapRB(uint32_t texel)
+    {
+        return (texel & 0xFF00FF00) | ((texel >> 16) & 0xFF) | ((texel & 0xFF) << 16);
+    }
+
+#ifdef FORMATCONVERTER_SSE2
+    //-------------------------------------------------------------------------
+    // Name: Channel16() / Widen16() / Narrow16()
+    // Desc: The SSE2 versions of the above, for 8 channels in 16 bit lanes
+    //-------------------------------------------------------------------------
+    inline __m128i Channel16(__m128i texels, int shift, int bits)
+    {
+        return _mm_and_si128(_mm_srl_epi16(texels, _mm_cvtsi32_si128(shift)), _mm_set1_epi16(static_cast<short>((1 << bits) - 1)));
+    }
+
+    inline __m128i Widen16(__m128i value, int bits)
+    {
+        if (bits == 1)
+            return _mm_mullo_epi16(value, _mm_set1_epi16(255));
+        return _mm_or_si128(_mm_sll_epi16(value, _mm_cvtsi32_si128(8 - bits)),
+                            _mm_srl_epi16(value, _mm_cvtsi32_si128(2 * bits - 8)));
+    }
+
+    inline __m128i Narrow16(__m128i value, int bits)
+    {
+        __m128i const x = _mm_add_epi16(_mm_mullo_epi16(value, _mm_set1_epi16(static_cast<short>((1 << bits) - 1))),
+                                        _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: Byte32()
+    // Desc: The byte-th byte of 8 A8R8G8B8 texels, in 16 bit lanes
+    //-------------------------------------------------------------------------
+    inline __m128i Byte32(__m128i first, __m128i second, int byte)
+    {
+        __m128i const kShift = _mm_cvtsi32_si128(8 * byte);
+        __m128i const kMask  = _mm_set1_epi32(0xFF);
+        return _mm_packs_epi32(_mm_and_si128(_mm_srl_epi32(first,  kShift), kMask),
+                               _mm_and_si128(_mm_srl_epi32(second, kShift), kMask));
+    }
+#endif
+
+    //-------------------------------------------------------------------------
+    // Name: Decode16()
+    // Desc: 16 bit RGB texels -> A8R8G8B8
+    //-------------------------------------------------------------------------
+    void Decode16(Layout16 const &layout, uint16_t const *pSource, uint32_t *pTarget, long numTexels)
+    {
+        long i = 0;
+#ifdef FORMATCONVERTER_SSE2
+        for (; i + 8 <= numTexels; i += 8)
+        {
+            __m128i const kTexels = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pSource + i));
+
+            __m128i const b = Widen16(Channel16(kTexels, layout.shift[0], layout.bits[0]), layout.bits[0]);
+            __m128i const g = Widen16(Channel16(kTexels, layout.shift[1], layout.bits[1]), layout.bits[1]);
+            __m128i const r = Widen16(Channel16(kTexels, layout.shift[2], layout.bits[2]), layout.bits[2]);
+            __m128i const a = (layout.bits[3] > 0)
+                                ? Widen16(Channel16(kTexels, layout.shift[3], layout.bits[3]), layout.bits[3])
+                                : _mm_set1_epi16(255);
+
+            __m128i const gb = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+            __m128i const ar = _mm_or_si128(r, _mm_slli_epi16(a, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pTarget + i),     _mm_unpacklo_epi16(gb, ar));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pTarget + i + 4), _mm_unpackhi_epi16(gb, ar));
+        }
+#endif
+        for (; i < numTexels; ++i)
+        {
+            uint32_t const kTexel = pSource[i];
+            uint32_t       argb   = (layout.bits[3] > 0)
+                                    ? Widen((kTexel >> layout.shift[3]) & ((1u << layout.bits[3]) - 1), layout.bits[3]) << 24
+                                    : kOpaque;
+            for (int c = 0; c < 3; ++c)
+                argb |= Widen((kTexel >> layout.shift[c]) & ((1u << layout.bits[c]) - 1), layout.bits[c]) << (8 * c);
+            pTarget[i] = argb;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: Encode16()
+    // Desc: A8R8G8B8 -> 16 bit RGB texels
+    //-------------------------------------------------------------------------
+    void Encode16(Layout16 const &layout, uint32_t const *pSource, uint16_t *pTarget, long numTexels)
+    {
+        long i = 0;
+#ifdef FORMATCONVERTER_SSE2
+        for (; i + 8 <= numTexels; i += 8)
+        {
+            __m128i const kFirst  = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pSource + i));
+            __m128i const kSecond = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pSource + i + 4));
+
+            __m128i texels = _mm_set1_epi16(static_cast<short>(layout.fill));
+            for (int c = 0; c < 4; ++c)
+            {
+                if (layout.bits[c] > 0)
+                    texels = _mm_or_si128(texels, _mm_sll_epi16(Narrow16(Byte32(kFirst, kSecond, c), layout.bits[c]),
+                                                                _mm_cvtsi32_si128(layout.shift[c])));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pTarget + i), texels);
+        }
+#endif
+        for (; i < numTexels; ++i)
+        {
+            uint32_t texel = layout.fill;
+            for (int c = 0; c < 4; ++c)
+            {
+                if (layout.bits[c] > 0)
+                    texel |= Narrow((pSource[i] >> (8 * c)) & 0xFF, layout.bits[c]) << layout.shift[c];
+            }
+            pTarget[i] = static_cast<uint16_t>(texel);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: Convert32()
+    // Desc: 32 bit RGB texels <-> A8R8G8B8: the same for both directions,
+    //       R and B swapped if swap, alpha set where it is an X channel
+    //-------------------------------------------------------------------------
+    void Convert32(uint32_t const *pSource, uint32_t *pTarget, long numTexels, bool swap, uint32_t fill)
+    {
+        long i = 0;
+#ifdef FORMATCONVERTER_SSE2
+        __m128i const kFill  = _mm_set1_epi32(static_cast<int>(fill));
+        __m128i const kKeep  = _mm_set1_epi32(swap ? static_cast<int>(0xFF00FF00) : -1);
+        __m128i const kLow   = _mm_set1_epi32(0xFF);
+        for (; i + 4 <= numTexels; i += 4)
+        {
+            __m128i const kTexels = _mm_loadu_si128(reinterpret_cast<__m128i const *>(pSource + i));
+            __m128i       texels  = _mm_or_si128(_mm_and_si128(kTexels, kKeep), kFill);
+            if (swap)
+                texels = _mm_or_si128(texels, _mm_or_si128(_mm_and_si128(_mm_srli_epi32(kTexels, 16), kLow),
+                                                           _mm_slli_epi32(_mm_and_si128(kTexels, kLow), 16)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pTarget + i), texels);
+        }
+#endif
+        for (; i < numTexels; ++i)
+            pTarget[i] = (swap ? SwapRB(pSource[i]) : pSource[i]) | fill;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: DecodeR8G8B8() / EncodeR8G8B8()
+    // Desc: R8G8B8 <-> A8R8G8B8, 4 texels (3 words) at a time
+    //-------------------------------------------------------------------------
+    void DecodeR8G8B8(UCHAR const *pSource, uint32_t *pTarget, long numTexels)
+    {
+        long i = 0;
+        for (; i + 4 <= numTexels; i += 4, pSource += 12)
+        {
+            uint32_t const w0 = Load32(pSource);
+            uint32_t const w1 = Load32(pSource + 4);
+            uint32_t const w2 = Load32(pSource + 8);
+            pTarget[i]     = kOpaque | ( w0 & 0xFFFFFF);
+            pTarget[i + 1] = kOpaque | ((w0 >> 24) | ((w1 & 0xFFFF) << 8));
+            pTarget[i + 2] = kOpaque | ((w1 >> 16) | ((w2 & 0xFF) << 16));
+            pTarget[i + 3] = kOpaque | ( w2 >> 8);
+        }
+        for (; i < numTexels; ++i, pSource += 3)
+            pTarget[i] = kOpaque | pSource[0] | (pSource[1] << 8) | (pSource[2] << 16);
+    }
+
+    void EncodeR8G8B8(uint32_t const *pSource, UCHAR *pTarget, long numTexels)
+    {
+        long i = 0;
+        for (; i + 4 <= numTexels; i += 4, pTarget += 12)
+        {
+            Store32(pTarget,     ( pSource[i]     & 0xFFFFFF)        | (pSource[i + 1] << 24));
+            Store32(pTarget + 4, ((pSource[i + 1] >> 8) & 0xFFFF)    | (pSource[i + 2] << 16));
+            Store32(pTarget + 8, ((pSource[i + 2] >> 16) & 0xFF)     | (pSource[i + 3] << 8));
+        }
+        for (; i < numTexels; ++i, pTarget += 3)
+        {
+            pTarget[0] = static_cast<UCHAR>(pSource[i]);
+            pTarget[1] = static_cast<UCHAR>(pSource[i] >> 8);
+            pTarget[2] = static_cast<UCHAR>(pSource[i] >> 16);
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: kTargetFormats
+    // Desc: What -format accepts: the D3DFORMAT name w/o D3DFMT_, or the
+    //       short name of its channel widths
+    //-------------------------------------------------------------------------
+    struct TargetFormat
+    {
+        char const *    pName;
+        char const *    pShortName;
+        D3DFORMAT       format;
+    };
+
+    TargetFormat const kTargetFormats[] =
+    {
+        { "a8r8g8b8", "8888", D3DFMT_A8R8G8B8 },
+        { "x8r8g8b8", "x888", D3DFMT_X8R8G8B8 },
+        { "r8g8b8",   "888",  D3DFMT_R8G8B8   },
+        { "r5g6b5",   "565",  D3DFMT_R5G6B5   },
+        { "a1r5g5b5", "1555", D3DFMT_A1R5G5B5 },
+        { "x1r5g5b5", "x555", D3DFMT_X1R5G5B5 },
+        { "a4r4g4b4", "4444", D3DFMT_A4R4G4B4 },
+        { "x4r4g4b4", "x444", D3DFMT_X4R4G4B4 },
+    };
+
+    //-------------------------------------------------------------------------
+    // Name: kBlockTargetFormats
+    // Desc: The DXTn formats -format accepts, which DXTn blocks of other
+    //       formats are transcoded to; they have no short names
+    //-------------------------------------------------------------------------
+    TargetFormat const kBlockTargetFormats[] =
+    {
+        { "dxt2", "dxt2", D3DFMT_DXT2 },
+        { "dxt3", "dxt3", D3DFMT_DXT3 },
+        { "dxt4", "dxt4", D3DFMT_DXT4 },
+        { "dxt5", "dxt5", D3DFMT_DXT5 },
+    };
+
+    //-------------------------------------------------------------------------
+    // Name: Load64() / Store64()
+    // Desc: Unaligned little endian access to the index fields of blocks
+    //-------------------------------------------------------------------------
+    inline uint64_t Load64(UCHAR const *pBytes)
+    {
+        uint64_t value;
+        memcpy(&value, pBytes, sizeof(value));
+        return value;
+    }
+
+    inline void Store64(UCHAR *pBytes, uint64_t value)
+    {
+        memcpy(pBytes, &value, sizeof(value));
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: StoreAlphaBlock()
+    // Desc: Stores 16 alphas as a DXT4/5 alpha block in its 6 value mode,
+    //       whose exact 0 and 255 leave the two end-points for at most two
+    //       other values.  Returns false if there are more.
+    //-------------------------------------------------------------------------
+    bool StoreAlphaBlock(UCHAR const alphas[16], UCHAR block[8])
+    {
+        int endPoints[2] = { -1, -1 };
+        for (int i = 0; i < 16; ++i)
+        {
+            int const kAlpha = alphas[i];
+            if ((kAlpha == 0) || (kAlpha == 255) || (kAlpha == endPoints[0]) || (kAlpha == endPoints[1]))
+                continue;
+            if (endPoints[0] < 0)
+                endPoints[0] = kAlpha;
+            else if (endPoints[1] < 0)
+                endPoints[1] = kAlpha;
+            else
+                return false;
+        }
+        if (endPoints[0] < 0)
+            endPoints[0] = 0;
+        if (endPoints[1] < 0)
+            endPoints[1] = endPoints[0];
+        if (endPoints[0] > endPoints[1])
+            std::swap(endPoints[0], endPoints[1]);
+
+        // a0 <= a1 selects the 6 value mode: index 6 is 0, index 7 is 255
+        uint64_t indices = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            uint64_t index = 1;
+            if (alphas[i] == 0)
+                index = 6;
+            else if (alphas[i] == 255)
+                index = 7;
+            else if (alphas[i] == endPoints[0])
+                index = 0;
+            indices |= index << (3 * i);
+        }
+        block[0] = static_cast<UCHAR>(endPoints[0]);
+        block[1] = static_cast<UCHAR>(endPoints[1]);
+        for (int i = 0; i < 6; ++i)
+            block[2 + i] = static_cast<UCHAR>(indices >> (8 * i));
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: TranscodeBlock()
+    // Desc: Writes a DXTn block as a block of the target format if that
+    //       decodes to exactly the same texels; returns false otherwise.
+    //       The color part of DXT2-5 blocks always uses the 4 color mode, 
+    //       which keeps the colors of indices 0 and 1 of a DXT1 block, and 
+    //       those of all its indices if it is in the 4 color mode as well.
+    //       Of a DXT1 block in the 3 color mode (color0 <= color1) the 
+    //       midpoint (index 2) is only exact if both end-points are the 
+    //       same, and the transparent black (index 3) only if one of them 
+    //       is black, which then takes its index and gets alpha 0.  The 4
+    //       bit alphas of DXT2/3 blocks become a DXT4/5 alpha block if there
+    //       are no more than two of them besides 0 and 255 (0x0 and 0xF).
+    //-------------------------------------------------------------------------
+    bool TranscodeBlock(D3DFORMAT sourceFormat, UCHAR const *pSource, D3DFORMAT targetFormat, UCHAR *pTarget)
+    {
+        UCHAR       alphas[16];
+        UCHAR const *pSourceColor = pSource;
+        UCHAR       color[8];
+        if (sourceFormat == D3DFMT_DXT1)
+        {
+            uint16_t const kColor0  = static_cast<uint16_t>(pSource[0] | (pSource[1] << 8));
+            uint16_t const kColor1  = static_cast<uint16_t>(pSource[2] | (pSource[3] << 8));
+            uint32_t       indices  = Load32(pSource + 4);
+            for (int i = 0; i < 16; ++i)
+            {
+                uint32_t const kIndex = (indices >> (2 * i)) & 3;
+                alphas[i] = 255;
+                if ((kColor0 > kColor1) || (kIndex < 2))
+                    continue;
+                if ((kIndex == 2) && (kColor0 != kColor1))
+                    return false;
+                if (kIndex == 3)
+                {
+                    if ((kColor0 != 0) && (kColor1 != 0))
+                        return false;
+                    indices  &= ~(3u << (2 * i));
+                    indices  |= ((kColor0 == 0) ? 0u : 1u) << (2 * i);
+                    alphas[i] = 0;
+                }
+            }
+            memcpy(color, pSource, 4);
+            Store32(color + 4, indices);
+            pSourceColor = color;
+        }
+        else
+        {
+            uint64_t const kAlphas = Load64(pSource);
+            for (int i = 0; i < 16; ++i)
+                alphas[i] = static_cast<UCHAR>(((kAlphas >> (4 * i)) & 0xF) * 17);
+            pSourceColor = pSource + 8;
+        }
+
+        if ((targetFormat == D3DFMT_DXT2) || (targetFormat == D3DFMT_DXT3))
+        {
+            uint64_t explicitAlphas = 0;
+            for (int i = 0; i < 16; ++i)
+                explicitAlphas |= static_cast<uint64_t>(alphas[i] / 17) << (4 * i);
+            Store64(pTarget, explicitAlphas);
+        }
+        else if (! StoreAlphaBlock(alphas, pTarget))
+            return false;
+
+        memcpy(pTarget + 8, pSourceColor, 8);
+        return true;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: CanConvertFrom()
+// Desc: Returns true if texels of the given format can be converted
+//-----------------------------------------------------------------------------
+bool FormatConverter::CanConvertFrom(D3DFORMAT format)
+{
+    switch (format)
+    {
+        case D3DFMT_A8R8G8B8:
+        case D3DFMT_X8R8G8B8:
+        case D3DFMT_A8B8G8R8:
+        case D3DFMT_X8B8G8R8:
+        case D3DFMT_R8G8B8:
+        case D3DFMT_L8:
+        case D3DFMT_A8L8:
+        case D3DFMT_A8:
+            return true;
+        default:
+            return GetLayout16(format) != nullptr;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: CanConvertTo()
+// Desc: Returns true if texels can be converted to the given format
+//-----------------------------------------------------------------------------
+bool FormatConverter::CanConvertTo(D3DFORMAT format)
+{
+    for (size_t i = 0; i < sizeof(kTargetFormats) / sizeof(kTargetFormats[0]); ++i)
+        if (kTargetFormats[i].format == format)
+            return true;
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name: CanTranscode()
+// Desc: Returns true if DXTn blocks of sourceFormat may be transcoded to 
+//       targetFormat: DXT1 to any of DXT2-5, and the explicit alphas of
+//       DXT2 and DXT3 to the interpolated ones of DXT4 and DXT5, 
+//       respectively (premultiplied stays premultiplied).  Each block can 
+//       still turn out not to be exact, see TranscodeRow().
+//-----------------------------------------------------------------------------
+bool FormatConverter::CanTranscode(D3DFORMAT sourceFormat, D3DFORMAT targetFormat)
+{
+    switch (sourceFormat)
+    {
+        case D3DFMT_DXT1:
+            return    (targetFormat == D3DFMT_DXT2) || (targetFormat == D3DFMT_DXT3)
+                   || (targetFormat == D3DFMT_DXT4) || (targetFormat == D3DFMT_DXT5);
+        case D3DFMT_DXT2:
+            return targetFormat == D3DFMT_DXT4;
+        case D3DFMT_DXT3:
+            return targetFormat == D3DFMT_DXT5;
+        default:
+            return false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: ParseFormat()
+// Desc: Returns the uncompressed format pName names, D3DFMT_UNKNOWN if 
+//       there is none
+//-----------------------------------------------------------------------------
+D3DFORMAT FormatConverter::ParseFormat(char const *pName)
+{
+    for (size_t i = 0; i < sizeof(kTargetFormats) / sizeof(kTargetFormats[0]); ++i)
+    {
+        if (   (_strcmpi(pName, kTargetFormats[i].pName) == 0)
+            || (_strcmpi(pName, kTargetFormats[i].pShortName) == 0))
+            return kTargetFormats[i].format;
+    }
+    return D3DFMT_UNKNOWN;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ParseFormats()
+// Desc: Reads the -format argument: an uncompressed format, a DXTn one, or
+//       one of each separated by a comma.  The ones not named are 
+//       D3DFMT_UNKNOWN.  Returns false if the argument is none of these.
+//-----------------------------------------------------------------------------
+bool FormatConverter::ParseFormats(char const *pArgument, D3DFORMAT *pFormat, D3DFORMAT *pBlockFormat)
+{
+    *pFormat      = D3DFMT_UNKNOWN;
+    *pBlockFormat = D3DFMT_UNKNOWN;
+
+    char const *pName = pArgument;
+    for (;;)
+    {
+        char const *pEnd   = strchr(pName, ',');
+        size_t const kLength = (pEnd != nullptr) ? static_cast<size_t>(pEnd - pName) : strlen(pName);
+
+        char name[16];
+        if (kLength >= sizeof(name))
+            return false;
+        memcpy(name, pName, kLength);
+        name[kLength] = '\0';
+
+        D3DFORMAT const kFormat = ParseFormat(name);
+        D3DFORMAT       blockFormat = D3DFMT_UNKNOWN;
+        for (size_t i = 0; i < sizeof(kBlockTargetFormats) / sizeof(kBlockTargetFormats[0]); ++i)
+        {
+            if (   (_strcmpi(name, kBlockTargetFormats[i].pName) == 0)
+                || (_strcmpi(name, kBlockTargetFormats[i].pShortName) == 0))
+                blockFormat = kBlockTargetFormats[i].format;
+        }
+
+        if ((kFormat != D3DFMT_UNKNOWN) && (*pFormat == D3DFMT_UNKNOWN))
+            *pFormat = kFormat;
+        else if ((blockFormat != D3DFMT_UNKNOWN) && (*pBlockFormat == D3DFMT_UNKNOWN))
+            *pBlockFormat = blockFormat;
+        else
+            return false;
+
+        if (pEnd == nullptr)
+            return true;
+        pName = pEnd + 1;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetTargetFormat()
+// Desc: Returns the uncompressed format -format converts to, D3DFMT_UNKNOWN
+//       if none
+//-----------------------------------------------------------------------------
+D3DFORMAT FormatConverter::GetTargetFormat(CmdLineOptionCollection const &options)
+{
+    D3DFORMAT format      = D3DFMT_UNKNOWN;
+    D3DFORMAT blockFormat = D3DFMT_UNKNOWN;
+    if (options.IsSet(CLO_FORMAT))
+        ParseFormats(options.GetArgument(CLO_FORMAT, 0), &format, &blockFormat);
+    return format;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetBlockTargetFormat()
+// Desc: Returns the DXTn format -format transcodes to, D3DFMT_UNKNOWN if 
+//       none
+//-----------------------------------------------------------------------------
+D3DFORMAT FormatConverter::GetBlockTargetFormat(CmdLineOptionCollection const &options)
+{
+    D3DFORMAT format      = D3DFMT_UNKNOWN;
+    D3DFORMAT blockFormat = D3DFMT_UNKNOWN;
+    if (options.IsSet(CLO_FORMAT))
+        ParseFormats(options.GetArgument(CLO_FORMAT, 0), &format, &blockFormat);
+    return blockFormat;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetConvertedFormat()
+// Desc: Returns the format texels of the given format end up in: the
+//       uncompressed -format one if they can be converted, the DXTn one
+//       if their blocks can be transcoded (and turn out to be exact, see
+//       Texture2D::LoadTexture()), their own otherwise
+//-----------------------------------------------------------------------------
+D3DFORMAT FormatConverter::GetConvertedFormat(CmdLineOptionCollection const &options, D3DFORMAT format)
+{
+    D3DFORMAT const kTargetFormat = GetTargetFormat(options);
+    if ((kTargetFormat != D3DFMT_UNKNOWN) && CanConvertFrom(format))
+        return kTargetFormat;
+
+    D3DFORMAT const kBlockTargetFormat = GetBlockTargetFormat(options);
+    if (CanTranscode(format, kBlockTargetFormat))
+        return kBlockTargetFormat;
+    return format;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ConvertRow()
+// Desc: Converts numTexels texels of sourceFormat into targetFormat.
+//       Texels of neither format are A8R8G8B8 go through a small buffer on
+//       the stack, so rows of any length can be converted.
+//-----------------------------------------------------------------------------
+void FormatConverter::ConvertRow(D3DFORMAT sourceFormat, UCHAR const *pSource,
+                                 D3DFORMAT targetFormat, UCHAR *pTarget, long numTexels)
+{
+    assert(CanConvertFrom(sourceFormat) || (sourceFormat == targetFormat));
+    assert(CanConvertTo(targetFormat)   || (sourceFormat == targetFormat));
+
+    if (sourceFormat == targetFormat)
+    {
+        memcpy(pTarget, pSource, static_cast<size_t>(numTexels) * ImageBuffer::SizeOfTexel(sourceFormat) / 8);
+        return;
+    }
+    if (targetFormat == D3DFMT_A8R8G8B8)
+    {
+        DecodeRow(sourceFormat, pSource, reinterpret_cast<uint32_t *>(pTarget), numTexels);
+        return;
+    }
+    if (sourceFormat == D3DFMT_A8R8G8B8)
+    {
+        EncodeRow(targetFormat, reinterpret_cast<uint32_t const *>(pSource), pTarget, numTexels);
+        return;
+    }
+
+    enum { kChunkTexels = 256 };
+    uint32_t    buffer[kChunkTexels];
+    int const   kSourceBytes = ImageBuffer::SizeOfTexel(sourceFormat) / 8;
+    int const   kTargetBytes = ImageBuffer::SizeOfTexel(targetFormat) / 8;
+    for (long i = 0; i < numTexels; i += kChunkTexels)
+    {
+        long const kNumTexels = (numTexels - i < kChunkTexels) ? (numTexels - i) : long(kChunkTexels);
+        DecodeRow(sourceFormat, pSource + i * kSourceBytes, buffer, kNumTexels);
+        EncodeRow(targetFormat, buffer, pTarget + i * kTargetBytes, kNumTexels);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: DecodeRow()
+// Desc: Converts numTexels texels of the given format to A8R8G8B8
+//-----------------------------------------------------------------------------
+void FormatConverter::DecodeRow(D3DFORMAT format, UCHAR const *pSource, uint32_t *pTarget, long numTexels)
+{
+    Layout16 const *pLayout = GetLayout16(format);
+    if (pLayout != nullptr)
+    {
+        Decode16(*pLayout, reinterpret_cast<uint16_t const *>(pSource), pTarget, numTexels);
+        return;
+    }
+
+    uint32_t const *pSource32 = reinterpret_cast<uint32_t const *>(pSource);
+    switch (format)
+    {
+        case D3DFMT_A8R8G8B8:   memcpy(pTarget, pSource, static_cast<size_t>(numTexels) * 4);   break;
+        case D3DFMT_X8R8G8B8:   Convert32(pSource32, pTarget, numTexels, false, kOpaque);       break;
+        case D3DFMT_A8B8G8R8:   Convert32(pSource32, pTarget, numTexels, true,  0);             break;
+        case D3DFMT_X8B8G8R8:   Convert32(pSource32, pTarget, numTexels, true,  kOpaque);       break;
+        case D3DFMT_R8G8B8:     DecodeR8G8B8(pSource, pTarget, numTexels);                      break;
+        case D3DFMT_L8:
+            for (long i = 0; i < numTexels; ++i)
+                pTarget[i] = kOpaque | (pSource[i] * 0x010101u);
+            break;
+        case D3DFMT_A8L8:
+            for (long i = 0; i < numTexels; ++i)
+                pTarget[i] = (pSource[2 * i + 1] << 24) | (pSource[2 * i] * 0x010101u);
+            break;
+        case D3DFMT_A8:
+            for (long i = 0; i < numTexels; ++i)
+                pTarget[i] = static_cast<uint32_t>(pSource[i]) << 24;
+            break;
+        default:
+            assert(false);
+            break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: EncodeRow()
+// Desc: Converts numTexels A8R8G8B8 texels to the given format
+//-----------------------------------------------------------------------------
+void FormatConverter::EncodeRow(D3DFORMAT format, uint32_t const *pSource, UCHAR *pTarget, long numTexels)
+{
+    Layout16 const *pLayout = GetLayout16(format);
+    if (pLayout != nullptr)
+    {
+        Encode16(*pLayout, pSource, reinterpret_cast<uint16_t *>(pTarget), numTexels);
+        return;
+    }
+
+    uint32_t *pTarget32 = reinterpret_cast<uint32_t *>(pTarget);
+    switch (format)
+    {
+        case D3DFMT_A8R8G8B8:   memcpy(pTarget, pSource, static_cast<size_t>(numTexels) * 4);   break;
+        case D3DFMT_X8R8G8B8:   Convert32(pSource, pTarget32, numTexels, false, kOpaque);       break;
+        case D3DFMT_R8G8B8:     EncodeR8G8B8(pSource, pTarget, numTexels);                      break;
+        default:
+            assert(false);
+            break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: TranscodeRow()
+// Desc: Transcodes a row of numBlocks DXTn blocks of sourceFormat into 
+//       targetFormat w/o decoding them, see CanTranscode().  Returns false 
+//       if a block cannot be transcoded exactly, see TranscodeBlock(); 
+//       w/ pTarget nullptr the blocks are only checked.
+//-----------------------------------------------------------------------------
+bool FormatConverter::TranscodeRow(D3DFORMAT sourceFormat, UCHAR const *pSource,
+                                   D3DFORMAT targetFormat, UCHAR *pTarget, long numBlocks)
+{
+    assert(CanTranscode(sourceFormat, targetFormat));
+
+    int const   kSourceBytes = 2 * ImageBuffer::SizeOfTexel(sourceFormat);
+    UCHAR       block[16];
+    for (long i = 0; i < numBlocks; ++i, pSource += kSourceBytes)
+    {
+        if (! TranscodeBlock(sourceFormat, pSource, targetFormat, (pTarget != nullptr) ? pTarget + 16 * i : block))
+            return false;
+    }
+    return true;
+}
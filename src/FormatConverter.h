@@ -0,0 +1,56 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: FormatConverter.h
+// Desc: Header file for FormatConverter class
+//-----------------------------------------------------------------------------
+
+#ifndef FORMATCONVERTER_H
+#define FORMATCONVERTER_H
+
+#include <stdint.h>
+
+#include "HeadlessTypes.h"
+
+class CmdLineOptionCollection;
+
+//-----------------------------------------------------------------------------
+// Name: FormatConverter
+// Desc: Converts rows of texels between the uncompressed RGB formats, so
+//       images of different formats can share one atlas family (-format).
+//       Every conversion goes through A8R8G8B8: the channels are widened
+//       by replicating their high bits and narrowed w/ rounding, so a
+//       texel converted to A8R8G8B8 and back is unchanged.  Missing alpha
+//       reads as opaque, and X channels are written as all ones.
+//       The 16 bit formats are converted 8 texels at a time, the 32 bit 
+//       ones 4 at a time, w/ SSE2 where the compiler targets it; the results
+//       are the same as those of the scalar code.
+//       DXTn blocks are not decoded but transcoded: DXT1 ones get an alpha
+//       part to become DXT2-5 blocks, and DXT2/3 ones a DXT4/5 alpha block,
+//       wherever that is exact, so DXTn images can share one atlas family.
+//-----------------------------------------------------------------------------
+class FormatConverter
+{
+public:
+    static bool         CanConvertFrom(D3DFORMAT format);
+    static bool         CanConvertTo(D3DFORMAT format);
+    static bool         CanTranscode(D3DFORMAT sourceFormat, D3DFORMAT targetFormat);
+    static D3DFORMAT    ParseFormat(char const *pName);
+    static bool         ParseFormats(char const *pArgument, D3DFORMAT *pFormat, D3DFORMAT *pBlockFormat);
+    static D3DFORMAT    GetTargetFormat(CmdLineOptionCollection const &options);
+    static D3DFORMAT    GetBlockTargetFormat(CmdLineOptionCollection const &options);
+    static D3DFORMAT    GetConvertedFormat(CmdLineOptionCollection const &options, D3DFORMAT format);
+
+    static void         ConvertRow(D3DFORMAT sourceFormat, UCHAR const *pSource,
+                                   D3DFORMAT targetFormat, UCHAR *pTarget, long numTexels);
+    static bool         TranscodeRow(D3DFORMAT sourceFormat, UCHAR const *pSource,
+                                     D3DFORMAT targetFormat, UCHAR *pTarget, long numBlocks);
+
+private:
+    static void         DecodeRow(D3DFORMAT format, UCHAR const *pSource, uint32_t *pTarget, long numTexels);
+    static void         EncodeRow(D3DFORMAT format, uint32_t const *pSource, UCHAR *pTarget, long numTexels);
+};
+
+#endif // FORMATCONVERTER_H
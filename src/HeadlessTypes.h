@@ -0,0 +1,142 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: HeadlessTypes.h
+// Desc: The few Windows/D3D9 types used by the device independent atlas core
+//       (ImageBuffer, packers). On Windows these come from the real SDK
+//       headers. On other platforms minimal stand-ins with identical values
+//       are declared here so that the core compiles without any Direct3D
+//       or Windows SDK headers (ie. headless Linux builds and unit tests).
+//-----------------------------------------------------------------------------
+
+#ifndef HEADLESSTYPES_H
+#define HEADLESSTYPES_H
+
+#ifdef _WIN32
+
+#include <d3d9.h>
+
+#else  // _WIN32
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+
+typedef long            LONG;
+typedef long            HRESULT;
+typedef unsigned char   UCHAR;
+typedef unsigned long   DWORD;
+
+#define S_OK            ((HRESULT)0L)
+#define E_FAIL          ((HRESULT)0x80004005L)
+#define D3D_OK          S_OK
+#define FAILED(hr)      (((HRESULT)(hr)) < 0)
+
+#define UNREFERENCED_PARAMETER(P)   (void)(P)
+
+struct IDirect3DDevice9;
+struct IDirect3DTexture9;
+
+#ifndef MAKEFOURCC
+    #define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
+                ((DWORD)(unsigned char)(ch0) | ((DWORD)(unsigned char)(ch1) << 8) |   \
+                ((DWORD)(unsigned char)(ch2) << 16) | ((DWORD)(unsigned char)(ch3) << 24 ))
+#endif
+
+// Same values as in d3d9types.h (only the texture formats this tool knows about)
+typedef enum _D3DFORMAT
+{
+    D3DFMT_UNKNOWN              =  0,
+
+    D3DFMT_R8G8B8               = 20,
+    D3DFMT_A8R8G8B8             = 21,
+    D3DFMT_X8R8G8B8             = 22,
+    D3DFMT_R5G6B5               = 23,
+    D3DFMT_X1R5G5B5             = 24,
+    D3DFMT_A1R5G5B5             = 25,
+    D3DFMT_A4R4G4B4             = 26,
+    D3DFMT_R3G3B2               = 27,
+    D3DFMT_A8                   = 28,
+    D3DFMT_A8R3G3B2             = 29,
+    D3DFMT_X4R4G4B4             = 30,
+    D3DFMT_A2B10G10R10          = 31,
+    D3DFMT_A8B8G8R8             = 32,
+    D3DFMT_X8B8G8R8             = 33,
+    D3DFMT_G16R16               = 34,
+    D3DFMT_A2R10G10B10          = 35,
+    D3DFMT_A16B16G16R16         = 36,
+
+    D3DFMT_A8P8                 = 40,
+    D3DFMT_P8                   = 41,
+
+    D3DFMT_L8                   = 50,
+    D3DFMT_A8L8                 = 51,
+    D3DFMT_A4L4                 = 52,
+
+    D3DFMT_V8U8                 = 60,
+    D3DFMT_L6V5U5               = 61,
+    D3DFMT_X8L8V8U8             = 62,
+    D3DFMT_Q8W8V8U8             = 63,
+    D3DFMT_V16U16               = 64,
+    D3DFMT_A2W10V10U10          = 67,
+
+    D3DFMT_UYVY                 = MAKEFOURCC('U', 'Y', 'V', 'Y'),
+    D3DFMT_R8G8_B8G8            = MAKEFOURCC('R', 'G', 'B', 'G'),
+    D3DFMT_YUY2                 = MAKEFOURCC('Y', 'U', 'Y', '2'),
+    D3DFMT_G8R8_G8B8            = MAKEFOURCC('G', 'R', 'G', 'B'),
+    D3DFMT_DXT1                 = MAKEFOURCC('D', 'X', 'T', '1'),
+    D3DFMT_DXT2                 = MAKEFOURCC('D', 'X', 'T', '2'),
+    D3DFMT_DXT3                 = MAKEFOURCC('D', 'X', 'T', '3'),
+    D3DFMT_DXT4                 = MAKEFOURCC('D', 'X', 'T', '4'),
+    D3DFMT_DXT5                 = MAKEFOURCC('D', 'X', 'T', '5'),
+
+    D3DFMT_L16                  = 81,
+    D3DFMT_Q16W16V16U16         = 110,
+
+    D3DFMT_R16F                 = 111,
+    D3DFMT_G16R16F              = 112,
+    D3DFMT_A16B16G16R16F        = 113,
+
+    D3DFMT_R32F                 = 114,
+    D3DFMT_G32R32F              = 115,
+    D3DFMT_A32B32G32R32F        = 116,
+
+    D3DFMT_CxV8U8               = 117,
+
+    D3DFMT_FORCE_DWORD          = 0x7fffffff
+} D3DFORMAT;
+
+// MSVC secure CRT functions used by the core sources
+inline int fopen_s(FILE **ppFile, char const *pFilename, char const *pMode)
+{
+    *ppFile = fopen(pFilename, pMode);
+    return (*ppFile == nullptr) ? -1 : 0;
+}
+
+template <size_t size>
+inline int sprintf_s(char (&buffer)[size], char const *pFormat, ...)
+{
+    va_list args;
+    va_start(args, pFormat);
+    int const kResult = vsnprintf(buffer, size, pFormat, args);
+    va_end(args);
+    return kResult;
+}
+
+#define sscanf_s    sscanf
+#define fprintf_s   fprintf
+#define _strcmpi    strcasecmp
+
+#endif // _WIN32
+
+// Vendor FourCC formats d3d9types.h has no names for: the block compressed
+// one and two channel formats (BC4 and BC5 in Direct3D 10 terms).  They are
+// no D3DFORMAT enumerators, so switches that list them switch on the format
+// as a DWORD
+#define D3DFMT_ATI1     static_cast<D3DFORMAT>(MAKEFOURCC('A', 'T', 'I', '1'))
+#define D3DFMT_ATI2     static_cast<D3DFORMAT>(MAKEFOURCC('A', 'T', 'I', '2'))
+
+#endif // HEADLESSTYPES_H
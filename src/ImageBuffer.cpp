@@ -0,0 +1,492 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: ImageBuffer.cpp
+// Desc: ImageBuffer class implementation.
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <new>
+
+#include "ImageBuffer.h"
+#include "DDSFile.h"
+
+//-----------------------------------------------------------------------------
+// Name: ImageBuffer()
+// Desc: Constructor
+//-----------------------------------------------------------------------------
+ImageBuffer::ImageBuffer()
+    : mFormat(D3DFMT_UNKNOWN)
+    , mAllocatedBytes(0)
+    , mpZeroRow(nullptr)
+{
+    ;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ~ImageBuffer()
+// Desc: Destructor
+//-----------------------------------------------------------------------------
+ImageBuffer::~ImageBuffer()
+{
+    Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name: Create()
+// Desc: Allocates (zero-initialized) storage for a texture of the given
+//       format and dimensions.  levels == 0 creates the full mip chain.
+//       A lazy image allocates its rows only once they are written to, see
+//       GetRow().  Returns false if the format is unknown or memory ran out.
+//-----------------------------------------------------------------------------
+bool ImageBuffer::Create(D3DFORMAT format, long width, long height, long depth, int levels, bool lazy)
+{
+    Release();
+
+    int const kBitsPerTexel = SizeOfTexel(format);
+    if ((kBitsPerTexel == 0) || (width < 1) || (height < 1) || (depth < 1))
+        return false;
+
+    int const kMaxLevels = GetMaxMipLevels(width, height);
+    if ((levels <= 0) || (levels > kMaxLevels))
+        levels = kMaxLevels;
+
+    int const kBlockFactor = IsDXTnFormat(format) ? 4 : 1;
+
+    mFormat = format;
+    mLevels.resize(levels);
+    for (int level = 0; level < levels; ++level)
+    {
+        MipLevel &mip = mLevels[level];
+        mip.width    = (width  >> level) > 0 ? (width  >> level) : 1;
+        mip.height   = (height >> level) > 0 ? (height >> level) : 1;
+        mip.depth    = (depth  >> level) > 0 ? (depth  >> level) : 1;
+
+        long const kColumns = (mip.width + kBlockFactor - 1) / kBlockFactor;
+        mip.numRows  = (mip.height + kBlockFactor - 1) / kBlockFactor;
+        mip.rowBytes = (kColumns * kBlockFactor * kBlockFactor * kBitsPerTexel + 7) / 8;
+        mip.rowPitch = (mip.rowBytes + kRowAlignment - 1) & ~static_cast<long>(kRowAlignment - 1);
+
+        // the rows of all slices are numbered through: slice * numRows + row
+        size_t const kNumBands = (static_cast<size_t>(mip.numRows) * mip.depth + kBandRows - 1) / kBandRows;
+        mip.memory.resize(kNumBands, nullptr);
+        mip.bands.resize(kNumBands, nullptr);
+
+        for (size_t band = 0; (! lazy) && (band < kNumBands); ++band)
+        {
+            if (! AllocateBand(mip, band))
+            {
+                Release();
+                return false;
+            }
+        }
+    }
+
+    if (lazy)
+    {
+        mZeroRow.resize(static_cast<size_t>(mLevels[0].rowPitch) + kRowAlignment, 0);
+        mpZeroRow = reinterpret_cast<UCHAR const *>((reinterpret_cast<uintptr_t>(mZeroRow.data()) + kRowAlignment - 1)
+                                                    & ~static_cast<uintptr_t>(kRowAlignment - 1));
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: AllocateBand()
+// Desc: Allocates (zero-initialized) storage for the passed in band of rows.
+//       Returns false if memory ran out.
+//-----------------------------------------------------------------------------
+bool ImageBuffer::AllocateBand(MipLevel &mip, size_t band)
+{
+    assert(mip.memory[band] == nullptr);
+
+    size_t const kBandBytes = static_cast<size_t>(mip.rowPitch) * kBandRows;
+
+    mip.memory[band] = new (std::nothrow) UCHAR[kBandBytes + kRowAlignment]();
+    if (mip.memory[band] == nullptr)
+        return false;
+
+    mip.bands[band] = reinterpret_cast<UCHAR *>((reinterpret_cast<uintptr_t>(mip.memory[band]) + kRowAlignment - 1)
+                                                & ~static_cast<uintptr_t>(kRowAlignment - 1));
+    mAllocatedBytes += kBandBytes + kRowAlignment;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: Release()
+// Desc: Frees all storage
+//-----------------------------------------------------------------------------
+void ImageBuffer::Release()
+{
+    std::vector<MipLevel>::iterator iterLevel;
+    for (iterLevel = mLevels.begin(); iterLevel != mLevels.end(); ++iterLevel)
+    {
+        std::vector<UCHAR *>::iterator iterMemory;
+        for (iterMemory = iterLevel->memory.begin(); iterMemory != iterLevel->memory.end(); ++iterMemory)
+            delete [] *iterMemory;
+    }
+
+    mLevels.clear();
+    mZeroRow.clear();
+    mpZeroRow = nullptr;
+    mAllocatedBytes = 0;
+    mFormat = D3DFMT_UNKNOWN;
+}
+
+//-----------------------------------------------------------------------------
+// Name: IsCreated()
+// Desc: returns true if storage has been allocated
+//-----------------------------------------------------------------------------
+bool ImageBuffer::IsCreated() const
+{
+    return !mLevels.empty();
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetFormat()
+// Desc: returns the texel format
+//-----------------------------------------------------------------------------
+D3DFORMAT ImageBuffer::GetFormat() const
+{
+    return mFormat;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetLevelCount()
+// Desc: returns the number of mip-levels stored
+//-----------------------------------------------------------------------------
+int ImageBuffer::GetLevelCount() const
+{
+    return static_cast<int>(mLevels.size());
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetWidth()
+// Desc: returns the width (in texels) of the given mip-level
+//-----------------------------------------------------------------------------
+long ImageBuffer::GetWidth(int level) const
+{
+    assert(level < GetLevelCount());
+    return mLevels[level].width;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetHeight()
+// Desc: returns the height (in texels) of the given mip-level
+//-----------------------------------------------------------------------------
+long ImageBuffer::GetHeight(int level) const
+{
+    assert(level < GetLevelCount());
+    return mLevels[level].height;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetDepth()
+// Desc: returns the depth (in slices) of the given mip-level
+//-----------------------------------------------------------------------------
+long ImageBuffer::GetDepth(int level) const
+{
+    assert(level < GetLevelCount());
+    return mLevels[level].depth;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetNumRows()
+// Desc: returns the number of rows (rows of 4x4 blocks for DXTn) of a level
+//-----------------------------------------------------------------------------
+long ImageBuffer::GetNumRows(int level) const
+{
+    assert(level < GetLevelCount());
+    return mLevels[level].numRows;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetRowBytes()
+// Desc: returns the number of bytes of actual data in one row of a level
+//-----------------------------------------------------------------------------
+long ImageBuffer::GetRowBytes(int level) const
+{
+    assert(level < GetLevelCount());
+    return mLevels[level].rowBytes;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetRowPitch()
+// Desc: returns the distance in bytes between two rows of a level
+//-----------------------------------------------------------------------------
+long ImageBuffer::GetRowPitch(int level) const
+{
+    assert(level < GetLevelCount());
+    return mLevels[level].rowPitch;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetSizeInBytes()
+// Desc: returns the size of the texel data as it is written to a DDS file,
+//       ie without any row alignment padding.
+//-----------------------------------------------------------------------------
+size_t ImageBuffer::GetSizeInBytes() const
+{
+    size_t size = 0;
+
+    std::vector<MipLevel>::const_iterator iterLevel;
+    for (iterLevel = mLevels.begin(); iterLevel != mLevels.end(); ++iterLevel)
+        size += static_cast<size_t>(iterLevel->rowBytes) * iterLevel->numRows * iterLevel->depth;
+
+    return size;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetAllocatedBytes()
+// Desc: returns how much memory the texel data takes up so far, padding
+//       included
+//-----------------------------------------------------------------------------
+size_t ImageBuffer::GetAllocatedBytes() const
+{
+    return mAllocatedBytes;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetSizeInBytes()
+// Desc: returns what GetSizeInBytes() would return for a 2D image created
+//       w/ the passed in arguments, w/o creating it
+//-----------------------------------------------------------------------------
+size_t ImageBuffer::GetSizeInBytes(D3DFORMAT format, long width, long height, int levels)
+{
+    int const kMaxLevels = GetMaxMipLevels(width, height);
+    if ((levels <= 0) || (levels > kMaxLevels))
+        levels = kMaxLevels;
+
+    int const kBitsPerTexel = SizeOfTexel(format);
+    int const kBlockFactor  = IsDXTnFormat(format) ? 4 : 1;
+    size_t    size          = 0;
+
+    for (int level = 0; level < levels; ++level)
+    {
+        long const kWidth   = (width  >> level) > 0 ? (width  >> level) : 1;
+        long const kHeight  = (height >> level) > 0 ? (height >> level) : 1;
+        long const kColumns = (kWidth  + kBlockFactor - 1) / kBlockFactor;
+        long const kRows    = (kHeight + kBlockFactor - 1) / kBlockFactor;
+
+        size += static_cast<size_t>((kColumns * kBlockFactor * kBlockFactor * kBitsPerTexel + 7) / 8) * kRows;
+    }
+    return size;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetRow()
+// Desc: returns a pointer to the first byte of the given row and slice, for
+//       writing: in a lazy image the band the row is in gets allocated.
+//       Memory running out there is fatal, as it would be for any other
+//       allocation the tool makes.
+//-----------------------------------------------------------------------------
+UCHAR * ImageBuffer::GetRow(int level, long row, long slice)
+{
+    assert(level < GetLevelCount());
+    assert(row   < mLevels[level].numRows);
+    assert(slice < mLevels[level].depth);
+
+    MipLevel     &mip    = mLevels[level];
+    size_t const  kIndex = static_cast<size_t>(slice) * mip.numRows + row;
+    size_t const  kBand  = kIndex / kBandRows;
+
+    if ((mip.bands[kBand] == nullptr) && ! AllocateBand(mip, kBand))
+        throw std::bad_alloc();
+
+    return mip.bands[kBand] + (kIndex % kBandRows) * mip.rowPitch;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetRow()
+// Desc: returns a pointer to the first byte of the given row and slice, for
+//       reading: rows of lazy bands that were never written to are zeros
+//-----------------------------------------------------------------------------
+UCHAR const * ImageBuffer::GetRow(int level, long row, long slice) const
+{
+    assert(level < GetLevelCount());
+    assert(row   < mLevels[level].numRows);
+    assert(slice < mLevels[level].depth);
+
+    MipLevel const &mip    = mLevels[level];
+    size_t const    kIndex = static_cast<size_t>(slice) * mip.numRows + row;
+    size_t const    kBand  = kIndex / kBandRows;
+
+    if (mip.bands[kBand] == nullptr)
+        return mpZeroRow;
+
+    return mip.bands[kBand] + (kIndex % kBandRows) * mip.rowPitch;
+}
+
+//-----------------------------------------------------------------------------
+// Name: WriteDDS()
+// Desc: Saves the image into a DDS file.  Volumes are written as volume
+//       textures unless they only have a single slice (same as D3DX does).
+//       Returns the size of the file, header included, or 0 if it could not
+//       be written.
+//-----------------------------------------------------------------------------
+size_t ImageBuffer::WriteDDS(char const *pFilename) const
+{
+    if (!IsCreated())
+        return 0;
+
+    FILE *fp = nullptr;
+    fopen_s(&fp, pFilename, "wb");
+    if (fp == nullptr)
+        return 0;
+
+    bool const kIsVolume = (GetDepth() > 1);
+
+    DDSHeader header;
+    memset(&header, 0, sizeof(header));
+    header.size        = sizeof(header);
+    header.flags       = kDDSD_CAPS | kDDSD_HEIGHT | kDDSD_WIDTH | kDDSD_PIXELFORMAT;
+    header.height      = static_cast<uint32_t>(GetHeight());
+    header.width       = static_cast<uint32_t>(GetWidth());
+    header.caps        = kDDSCAPS_TEXTURE;
+
+    if (IsDXTnFormat(mFormat))
+    {
+        header.flags            |= kDDSD_LINEARSIZE;
+        header.pitchOrLinearSize = static_cast<uint32_t>(GetRowBytes(0) * GetNumRows(0));
+    }
+    else
+    {
+        header.flags            |= kDDSD_PITCH;
+        header.pitchOrLinearSize = static_cast<uint32_t>(GetRowBytes(0));
+    }
+
+    if (GetLevelCount() > 1)
+    {
+        header.flags       |= kDDSD_MIPMAPCOUNT;
+        header.mipMapCount  = static_cast<uint32_t>(GetLevelCount());
+        header.caps        |= kDDSCAPS_COMPLEX | kDDSCAPS_MIPMAP;
+    }
+
+    if (kIsVolume)
+    {
+        header.flags |= kDDSD_DEPTH;
+        header.depth  = static_cast<uint32_t>(GetDepth());
+        header.caps  |= kDDSCAPS_COMPLEX;
+        header.caps2 |= kDDSCAPS2_VOLUME;
+    }
+
+    GetDDSPixelFormat(mFormat, SizeOfTexel(mFormat), header.pixelFormat);
+
+    uint32_t const kMagic = kDDSMagic;
+    bool bSuccess =    (fwrite(&kMagic, sizeof(kMagic), 1, fp) == 1)
+                    && (fwrite(&header, sizeof(header), 1, fp) == 1);
+
+    for (int level = 0; bSuccess && (level < GetLevelCount()); ++level)
+        for (long slice = 0; bSuccess && (slice < GetDepth(level)); ++slice)
+            for (long row = 0; bSuccess && (row < GetNumRows(level)); ++row)
+                bSuccess = (fwrite(GetRow(level, row, slice), GetRowBytes(level), 1, fp) == 1);
+
+    // buffered data may only fail to be written when the file is closed
+    bSuccess = (fclose(fp) == 0) && bSuccess;
+    return bSuccess ? (sizeof(kMagic) + sizeof(header) + GetSizeInBytes()) : 0;
+}
+
+//-----------------------------------------------------------------------------
+// Name: SizeOfTexel()
+// Desc: Returns the size (in bits) of the given texel format, 0 if unknown
+//-----------------------------------------------------------------------------
+int ImageBuffer::SizeOfTexel( D3DFORMAT format )
+{
+	switch( static_cast<DWORD>(format) )
+	{
+		case D3DFMT_R8G8B8:			return 3*8;
+		case D3DFMT_A8R8G8B8:		return 4*8;
+		case D3DFMT_X8R8G8B8:		return 4*8;
+		case D3DFMT_R5G6B5:			return 2*8;
+		case D3DFMT_X1R5G5B5:		return 2*8;
+		case D3DFMT_A1R5G5B5:		return 2*8;
+		case D3DFMT_A4R4G4B4:		return 2*8;
+		case D3DFMT_R3G3B2:			return 8;
+		case D3DFMT_A8:				return 8;
+		case D3DFMT_A8R3G3B2:		return 2*8;
+		case D3DFMT_X4R4G4B4:		return 2*8;
+		case D3DFMT_A2B10G10R10:	return 4*8;
+		case D3DFMT_A8B8G8R8:		return 4*8;
+		case D3DFMT_X8B8G8R8:		return 4*8;
+		case D3DFMT_G16R16:			return 4*8;
+		case D3DFMT_A2R10G10B10:	return 4*8;
+		case D3DFMT_A16B16G16R16:	return 8*8;
+		case D3DFMT_A8P8:			return 8;
+		case D3DFMT_P8:				return 8;
+		case D3DFMT_L8:				return 8;
+		case D3DFMT_L16:			return 2*8;
+		case D3DFMT_A8L8:			return 2*8;
+		case D3DFMT_A4L4:			return 8;
+		case D3DFMT_V8U8:			return 2*8;
+		case D3DFMT_Q8W8V8U8:		return 4*8;
+		case D3DFMT_V16U16:			return 4*8;
+		case D3DFMT_Q16W16V16U16:	return 8*8;
+		case D3DFMT_CxV8U8:			return 2*8;
+		case D3DFMT_L6V5U5:			return 2*8;
+		case D3DFMT_X8L8V8U8:		return 4*8;
+		case D3DFMT_A2W10V10U10:	return 4*8;
+		case D3DFMT_G8R8_G8B8:		return 2*8;
+		case D3DFMT_R8G8_B8G8:		return 2*8;
+		case D3DFMT_DXT1:			return 4;
+		case D3DFMT_DXT2:			return 8;
+		case D3DFMT_DXT3:			return 8;
+		case D3DFMT_DXT4:			return 8;
+		case D3DFMT_DXT5:			return 8;
+		case D3DFMT_ATI1:			return 4;
+		case D3DFMT_ATI2:			return 8;
+		case D3DFMT_UYVY:			return 2*8;
+		case D3DFMT_YUY2:			return 2*8;
+		case D3DFMT_R16F:			return 2*8;
+		case D3DFMT_G16R16F:		return 4*8;
+		case D3DFMT_A16B16G16R16F:	return 8*8;
+		case D3DFMT_R32F:			return 4*8;
+		case D3DFMT_G32R32F:		return 8*8;
+		case D3DFMT_A32B32G32R32F:	return 16*8;
+		default:
+			return 0;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name: IsDXTnFormat()
+// Desc: Returns true if the given format is a DXT format, or ATI1/ATI2 
+//       which are made of the same 4x4 blocks, false otherwise
+//-----------------------------------------------------------------------------
+bool ImageBuffer::IsDXTnFormat( D3DFORMAT format )
+{
+	switch( static_cast<DWORD>(format) )
+	{
+		case D3DFMT_DXT1:
+		case D3DFMT_DXT2:
+		case D3DFMT_DXT3:
+		case D3DFMT_DXT4:
+		case D3DFMT_DXT5:
+		case D3DFMT_ATI1:
+		case D3DFMT_ATI2:
+			return true;
+		default:
+			return false;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetMaxMipLevels()
+// Desc: Returns the length of a full mip chain for the given dimensions
+//-----------------------------------------------------------------------------
+int ImageBuffer::GetMaxMipLevels(long width, long height)
+{
+    long    size   = (width > height) ? width : height;
+    int     levels = 1;
+
+    while (size > 1)
+    {
+        size >>= 1;
+        ++levels;
+    }
+    return levels;
+}
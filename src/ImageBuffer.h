@@ -0,0 +1,100 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: ImageBuffer.h
+// Desc: Header file for ImageBuffer class
+//-----------------------------------------------------------------------------
+
+#ifndef IMAGEBUFFER_H
+#define IMAGEBUFFER_H
+
+#include <stddef.h>
+#include <vector>
+
+#include "HeadlessTypes.h"
+
+//-----------------------------------------------------------------------------
+// Name: ImageBuffer
+// Desc: Device independent, CPU side storage of a 2D or volume texture with
+//       a full (or partial) mip chain.  Replaces the system memory
+//       IDirect3DTexture9/IDirect3DVolumeTexture9 objects the atlases used
+//       to be made of, so packing, blitting and writing the DDS atlas files
+//       does not require a Direct3D device.
+//
+//       Each mip-level is stored row by row.  For DXTn formats a "row" is a
+//       row of 4x4 blocks.  Row pitches are aligned to kRowAlignment bytes
+//       so SIMD code can use aligned loads on row starts.
+//       The rows are allocated in bands of kBandRows rows.  A lazy image 
+//       only allocates a band when one of its rows is first asked for to be
+//       written to; until then the band reads as zeros.  Volume atlases are
+//       created at the largest depth the device supports, but only the 
+//       slices filled take memory.
+//-----------------------------------------------------------------------------
+class ImageBuffer
+{
+public:
+    enum
+    {
+        kRowAlignment = 16,
+        kBandRows     = 16,
+    };
+
+public:
+    ImageBuffer();
+    ~ImageBuffer();
+
+    bool            Create(D3DFORMAT format, long width, long height, long depth, int levels, bool lazy = false);
+    void            Release();
+
+    bool            IsCreated()                 const;
+    D3DFORMAT       GetFormat()                 const;
+    int             GetLevelCount()             const;
+    long            GetWidth (int level = 0)    const;
+    long            GetHeight(int level = 0)    const;
+    long            GetDepth (int level = 0)    const;
+    long            GetNumRows(int level)       const;
+    long            GetRowBytes(int level)      const;
+    long            GetRowPitch(int level)      const;
+    size_t          GetSizeInBytes()            const;
+    size_t          GetAllocatedBytes()         const;
+
+    UCHAR *         GetRow(int level, long row, long slice = 0);
+    UCHAR const *   GetRow(int level, long row, long slice = 0) const;
+
+    size_t          WriteDDS(char const *pFilename) const;
+
+    static int      SizeOfTexel (D3DFORMAT format);
+    static bool     IsDXTnFormat(D3DFORMAT format);
+    static int      GetMaxMipLevels(long width, long height);
+    static size_t   GetSizeInBytes(D3DFORMAT format, long width, long height, int levels);
+
+private:
+    ImageBuffer(ImageBuffer const &);               // not copyable
+    ImageBuffer & operator=(ImageBuffer const &);
+
+private:
+    struct MipLevel
+    {
+        long                    width;
+        long                    height;
+        long                    depth;
+        long                    numRows;
+        long                    rowBytes;
+        long                    rowPitch;
+        std::vector<UCHAR *>    memory;     // band allocations (unaligned), nullptr if not allocated yet
+        std::vector<UCHAR *>    bands;      // first row of each band (aligned)
+    };
+
+    bool            AllocateBand(MipLevel &mip, size_t band);
+
+private:
+    D3DFORMAT               mFormat;
+    std::vector<MipLevel>   mLevels;
+    size_t                  mAllocatedBytes;
+    std::vector<UCHAR>      mZeroRow;       // what rows of lazy bands not allocated yet read as
+    UCHAR const *           mpZeroRow;      // (aligned)
+};
+
+#endif // IMAGEBUFFER_H
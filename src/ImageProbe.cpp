@@ -0,0 +1,254 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: ImageProbe.cpp
+// Desc: Implementation of the ImageProbe header readers
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ImageProbe.h"
+#include "DDSFile.h"
+
+namespace
+{
+    //-------------------------------------------------------------------------
+    // Name: ReadBytes()
+    // Desc: Reads exactly numBytes bytes, returns false at the end of file
+    //-------------------------------------------------------------------------
+    inline bool ReadBytes(FILE *fp, UCHAR *pBytes, size_t numBytes)
+    {
+        return fread(pBytes, 1, numBytes, fp) == numBytes;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: BigEndian16() / BigEndian32() / LittleEndian16()
+    // Desc: Assemble integers from the bytes of a file header
+    //-------------------------------------------------------------------------
+    inline uint32_t BigEndian16(UCHAR const *p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 8) | p[1];
+    }
+
+    inline uint32_t BigEndian32(UCHAR const *p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+             | (static_cast<uint32_t>(p[2]) <<  8) | p[3];
+    }
+
+    inline uint32_t LittleEndian16(UCHAR const *p)
+    {
+        return (static_cast<uint32_t>(p[1]) << 8) | p[0];
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: Probe()
+// Desc: Fills in info from the header of the passed in file.  Returns false
+//       if the file cannot be read, or is not of a type that can be probed.
+//-----------------------------------------------------------------------------
+bool ImageProbe::Probe(char const *pFilename, ImageInfo &info)
+{
+    FILE *fp = nullptr;
+    fopen_s(&fp, pFilename, "rb");
+    if (fp == nullptr)
+        return false;
+
+    // tell the file types apart by their signatures
+    UCHAR       signature[4];
+    bool        bProbed = false;
+    if (ReadBytes(fp, signature, sizeof(signature)))
+    {
+        fseek(fp, 0, SEEK_SET);
+        if ((signature[0] == 0x89) && (memcmp(signature + 1, "PNG", 3) == 0))
+            bProbed = ProbePNG(fp, info);
+        else if ((signature[0] == 0xff) && (signature[1] == 0xd8))
+            bProbed = ProbeJPEG(fp, info);
+        else if (memcmp(signature, "GIF8", 4) == 0)
+            bProbed = ProbeGIF(fp, info);
+        else if (memcmp(signature, "DDS ", 4) == 0)
+            bProbed = ProbeDDS(fp, info);
+    }
+    fclose(fp);
+
+    return bProbed && (info.width > 0) && (info.height > 0) && (info.levels > 0);
+}
+
+//-----------------------------------------------------------------------------
+// Name: ProbePNG()
+// Desc: The IHDR chunk comes first and has the size, bit depth and color
+//       type.  The chunks up to the image data are looked at for a tRNS
+//       chunk, as transparency adds an alpha channel.
+//-----------------------------------------------------------------------------
+bool ImageProbe::ProbePNG(FILE *fp, ImageInfo &info)
+{
+    enum
+    {
+        kGray       = 0,
+        kRGB        = 2,
+        kPalette    = 3,
+        kGrayAlpha  = 4,
+        kRGBA       = 6,
+    };
+
+    UCHAR header[8 + 8 + 13];      // signature, IHDR length and type, IHDR data
+    if (   ! ReadBytes(fp, header, sizeof(header))
+        || (memcmp(header + 12, "IHDR", 4) != 0))
+        return false;
+
+    UCHAR const *pIHDR     = header + 16;
+    int const    kBitDepth = pIHDR[8];
+    int const    kColor    = pIHDR[9];
+
+    // skip the IHDR CRC, then walk the chunks up to IDAT
+    bool bTransparency = false;
+    if (fseek(fp, 4, SEEK_CUR) != 0)
+        return false;
+
+    UCHAR chunk[8];
+    while (ReadBytes(fp, chunk, sizeof(chunk)) && (memcmp(chunk + 4, "IDAT", 4) != 0))
+    {
+        if (memcmp(chunk + 4, "tRNS", 4) == 0)
+        {
+            bTransparency = true;
+            break;
+        }
+        if (fseek(fp, static_cast<long>(BigEndian32(chunk)) + 4, SEEK_CUR) != 0)
+            break;
+    }
+
+    switch (kColor)
+    {
+        case kGray:
+            info.format = bTransparency ? D3DFMT_A8L8 : ((kBitDepth == 16) ? D3DFMT_L16 : D3DFMT_L8);
+            break;
+        case kGrayAlpha:
+            info.format = (kBitDepth == 16) ? D3DFMT_A16B16G16R16 : D3DFMT_A8L8;
+            break;
+        case kRGB:
+            info.format = (kBitDepth == 16) ? D3DFMT_A16B16G16R16
+                                            : (bTransparency ? D3DFMT_A8R8G8B8 : D3DFMT_X8R8G8B8);
+            break;
+        case kRGBA:
+            info.format = (kBitDepth == 16) ? D3DFMT_A16B16G16R16 : D3DFMT_A8R8G8B8;
+            break;
+        case kPalette:
+            info.format = D3DFMT_P8;
+            break;
+        default:
+            return false;
+    }
+
+    info.width  = static_cast<long>(BigEndian32(pIHDR));
+    info.height = static_cast<long>(BigEndian32(pIHDR + 4));
+    info.levels = 1;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ProbeJPEG()
+// Desc: Walks the marker segments up to the first start of frame (SOFn)
+//       marker, which has the size and the number of components
+//-----------------------------------------------------------------------------
+bool ImageProbe::ProbeJPEG(FILE *fp, ImageInfo &info)
+{
+    UCHAR marker[2];
+    if (! ReadBytes(fp, marker, sizeof(marker)))        // SOI
+        return false;
+
+    for (;;)
+    {
+        // markers may be padded w/ any number of 0xff bytes
+        int byte = fgetc(fp);
+        if (byte != 0xff)
+            return false;
+        while (byte == 0xff)
+            byte = fgetc(fp);
+        if (byte == EOF)
+            return false;
+
+        // stand-alone markers w/o a segment
+        if ((byte == 0x01) || ((byte >= 0xd0) && (byte <= 0xd7)))
+            continue;
+
+        UCHAR length[2];
+        if (! ReadBytes(fp, length, sizeof(length)))
+            return false;
+
+        // SOF0-SOF15, except DHT (c4), JPG (c8) and DAC (cc)
+        if ((byte >= 0xc0) && (byte <= 0xcf) && (byte != 0xc4) && (byte != 0xc8) && (byte != 0xcc))
+        {
+            UCHAR frame[6];     // precision, height, width, components
+            if (! ReadBytes(fp, frame, sizeof(frame)))
+                return false;
+
+            switch (frame[5])
+            {
+                case 1:  info.format = D3DFMT_L8;       break;
+                case 3:  info.format = D3DFMT_X8R8G8B8; break;
+                default: return false;                  // e.g., CMYK
+            }
+            info.height = static_cast<long>(BigEndian16(frame + 1));
+            info.width  = static_cast<long>(BigEndian16(frame + 3));
+            info.levels = 1;
+            return true;
+        }
+
+        // start of scan: the frame header should have come already
+        if ((byte == 0xda) || (byte == 0xd9))
+            return false;
+
+        if (fseek(fp, static_cast<long>(BigEndian16(length)) - 2, SEEK_CUR) != 0)
+            return false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: ProbeGIF()
+// Desc: The logical screen descriptor follows the signature.  GIF images
+//       are always palettized.
+//-----------------------------------------------------------------------------
+bool ImageProbe::ProbeGIF(FILE *fp, ImageInfo &info)
+{
+    UCHAR header[6 + 4];        // signature and version, width, height
+    if (! ReadBytes(fp, header, sizeof(header)))
+        return false;
+
+    info.width  = static_cast<long>(LittleEndian16(header + 6));
+    info.height = static_cast<long>(LittleEndian16(header + 8));
+    info.levels = 1;
+    info.format = D3DFMT_P8;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ProbeDDS()
+// Desc: DDS_HEADER has it all, mip-levels included.  Only 2D textures are
+//       probed; the loader turns down volumes and cube maps anyway.
+//-----------------------------------------------------------------------------
+bool ImageProbe::ProbeDDS(FILE *fp, ImageInfo &info)
+{
+    uint32_t    magic;
+    DDSHeader   header;
+    if (   (fread(&magic,  sizeof(magic),  1, fp) != 1)
+        || (fread(&header, sizeof(header), 1, fp) != 1)
+        || (magic != kDDSMagic) || (header.size != sizeof(header)))
+        return false;
+
+    if (header.caps2 & (kDDSCAPS2_CUBEMAP | kDDSCAPS2_VOLUME))
+        return false;
+
+    info.format = GetD3DFormat(header.pixelFormat);
+    if (info.format == D3DFMT_UNKNOWN)
+        return false;
+
+    info.width  = static_cast<long>(header.width);
+    info.height = static_cast<long>(header.height);
+    info.levels = ((header.flags & kDDSD_MIPMAPCOUNT) && (header.mipMapCount > 0))
+                      ? static_cast<int>(header.mipMapCount) : 1;
+    return true;
+}
@@ -0,0 +1,49 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: ImageProbe.h
+// Desc: Header file for ImageProbe class
+//-----------------------------------------------------------------------------
+
+#ifndef IMAGEPROBE_H
+#define IMAGEPROBE_H
+
+#include <stdio.h>
+
+#include "HeadlessTypes.h"
+
+//-----------------------------------------------------------------------------
+// Name: ImageInfo
+// Desc: What the header of an image file tells about its texels
+//-----------------------------------------------------------------------------
+struct ImageInfo
+{
+    long        width;
+    long        height;
+    int         levels;         // mip-levels stored in the file
+    D3DFORMAT   format;         // of the texels in the file, as D3DX reports it
+};
+
+//-----------------------------------------------------------------------------
+// Name: ImageProbe
+// Desc: Reads the size and format of PNG (IHDR chunk), JPEG (SOFn marker),
+//       GIF (logical screen descriptor) and DDS (DDS_HEADER) files from
+//       their headers only, w/o decoding any texels.  Other file types, and
+//       DDS files w/ volumes, cube maps or formats this tool does not know,
+//       are not probed: they have to be decoded to find out.
+//-----------------------------------------------------------------------------
+class ImageProbe
+{
+public:
+    static bool Probe(char const *pFilename, ImageInfo &info);
+
+private:
+    static bool ProbePNG (FILE *fp, ImageInfo &info);
+    static bool ProbeJPEG(FILE *fp, ImageInfo &info);
+    static bool ProbeGIF (FILE *fp, ImageInfo &info);
+    static bool ProbeDDS (FILE *fp, ImageInfo &info);
+};
+
+#endif // IMAGEPROBE_H
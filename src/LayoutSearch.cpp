@@ -0,0 +1,240 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: LayoutSearch.cpp
+// Desc: Implementation of the LayoutSearch class (-bestof)
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <assert.h>
+
+#include <algorithm>
+
+#include "LayoutSearch.h"
+#include "CmdLineOptions.h"
+#include "TextureObject.h"
+#include "Packer.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    // the packers tried: every one of them w/ every sort order
+    char const * const kPackerNames[] =
+    {
+        "grid",
+        "maxrects:bssf",
+        "maxrects:baf",
+        "maxrects:bl",
+        "maxrects:cp",
+        "skyline:waste",
+        "guillotine:merge",
+        "guillotine:bssf:merge",
+        "bitmap",
+    };
+    int const kNumPackers = sizeof(kPackerNames) / sizeof(kPackerNames[0]);
+
+    char const * const kSortOrderNames[LayoutSearch::SORT_NUM] =
+    {
+        "area",
+        "max side",
+        "perimeter",
+    };
+}
+
+//-----------------------------------------------------------------------------
+// Name: LayoutSearch()
+// Desc: Constructor: atlasWidth x atlasHeight is the size new atlases are 
+//       created w/, see Atlas2D::GetMaxSize()
+//-----------------------------------------------------------------------------
+LayoutSearch::LayoutSearch(CmdLineOptionCollection const &options, LONG margin, long atlasWidth, long atlasHeight)
+    : mpOptions(&options)
+    , mMargin(margin)
+    , mAtlasWidth(atlasWidth)
+    , mAtlasHeight(atlasHeight)
+    , mpPackerName(kPackerNames[0])
+    , mSortOrder(SORT_AREA)
+{
+    ;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ~LayoutSearch()
+// Desc: Destructor
+//-----------------------------------------------------------------------------
+LayoutSearch::~LayoutSearch()
+{
+    ;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetPackerName()
+// Desc: returns the name of the packer the last Run() picked
+//-----------------------------------------------------------------------------
+char const * LayoutSearch::GetPackerName() const
+{
+    return mpPackerName;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetSortOrder()
+// Desc: returns the texture order the last Run() picked
+//-----------------------------------------------------------------------------
+LayoutSearch::eSortOrder LayoutSearch::GetSortOrder() const
+{
+    return mSortOrder;
+}
+
+//-----------------------------------------------------------------------------
+// Name: Sort()
+// Desc: Sorts the textures in the passed in order.  Textures that compare 
+//       equal keep their relative order.
+//-----------------------------------------------------------------------------
+void LayoutSearch::Sort(TTexture2DPtrVector &textureVector, eSortOrder order)
+{
+    switch (order)
+    {
+        case SORT_MAXSIDE:
+            std::stable_sort(textureVector.begin(), textureVector.end(), Texture2DMaxSideGreater());
+            break;
+        case SORT_PERIMETER:
+            std::stable_sort(textureVector.begin(), textureVector.end(), Texture2DPerimeterGreater());
+            break;
+        case SORT_AREA:
+        default:
+            std::stable_sort(textureVector.begin(), textureVector.end(), Texture2DGreater());
+            break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: Run()
+// Desc: Lays out the textures w/ every packer and sort order combination, 
+//       remembers the best one and leaves textureVector sorted in its order,
+//       ready for AtlasContainer::Insert().
+//-----------------------------------------------------------------------------
+void LayoutSearch::Run(TTexture2DPtrVector &textureVector, ThreadPool &pool)
+{
+    int const kNumLayouts = kNumPackers * SORT_NUM;
+
+    std::vector<TTexture2DPtrVector> sortedVectors(SORT_NUM, textureVector);
+    for (int order = 0; order < SORT_NUM; ++order)
+        Sort(sortedVectors[order], static_cast<eSortOrder>(order));
+
+    std::vector<Layout> layouts(kNumLayouts);
+    pool.Run(kNumLayouts, [&](int i) 
+    {
+        Evaluate(kPackerNames[i % kNumPackers], sortedVectors[i / kNumPackers], layouts[i]);
+    });
+
+    int best = 0;
+    for (int i = 1; i < kNumLayouts; ++i)
+        if (IsBetter(layouts[i], layouts[best]))
+            best = i;
+
+    mpPackerName  = kPackerNames[best % kNumPackers];
+    mSortOrder    = static_cast<eSortOrder>(best / kNumPackers);
+    textureVector = sortedVectors[mSortOrder];
+
+    fprintf( stderr, "Best of %d layouts: %s w/ %s order, %d atlases, %lld texels\n",
+             kNumLayouts, mpPackerName, kSortOrderNames[mSortOrder], 
+             layouts[best].numAtlases, layouts[best].numTexels );
+}
+
+//-----------------------------------------------------------------------------
+// Name: Evaluate()
+// Desc: Does what AtlasContainer::Insert() and Shrink() would do w/ the 
+//       textures in the passed in order and packer, but w/ layout-only
+//       packers, and returns the resulting counts in layout.
+//-----------------------------------------------------------------------------
+void LayoutSearch::Evaluate(char const *pPackerName, TTexture2DPtrVector const &textureVector,
+                            Layout &layout) const
+{
+    layout.numOrphans = 0;
+    layout.numAtlases = 0;
+    layout.numTexels  = 0;
+    if (textureVector.empty())
+        return;
+
+    AtlasDesc desc;
+    desc.width  = mAtlasWidth;
+    desc.height = mAtlasHeight;
+    desc.format = textureVector.front()->GetFormat();
+    desc.mipMaps = ! mpOptions->IsSet(CLO_NOMIPMAP);
+
+    bool const kAllowRotation = mpOptions->IsSet(CLO_ROTATE);
+    bool const kBestFit       = mpOptions->IsSet(CLO_BESTFIT);
+
+    std::vector<Packer2D *> packers;
+    TTexture2DPtrVector::const_iterator texIter;
+    for (texIter = textureVector.begin(); texIter != textureVector.end(); ++texIter)
+    {
+        long const  kWidth  = (*texIter)->GetWidth();
+        long const  kHeight = (*texIter)->GetHeight();
+        Region      placed;
+        bool        rotated;
+
+        size_t i;
+        if (kBestFit)
+        {
+            // see AtlasContainer::InsertBestFit()
+            Placement bestPlacement;
+            size_t    best = packers.size();
+            for (i = 0; i < packers.size(); ++i)
+            {
+                Placement placement;
+                if (   packers[i]->FindPlacement(kWidth, kHeight, mMargin, placement)
+                    && ((best == packers.size()) || Packer2D::IsBetterFit(placement, bestPlacement)))
+                {
+                    best          = i;
+                    bestPlacement = placement;
+                }
+            }
+            if (best < packers.size())
+                packers[best]->CommitPlacement(kWidth, kHeight, bestPlacement);
+            i = best;
+        }
+        else
+        {
+            for (i = 0; i < packers.size(); ++i)
+                if (packers[i]->Place(kWidth, kHeight, mMargin, placed, rotated))
+                    break;
+        }
+
+        if (i == packers.size())
+        {
+            // a new atlas: just like Atlas2D() it takes its first texture
+            // w/o margin, unless the margin is kAutoMargin
+            Packer2D *pPacker = Packer2D::Create(pPackerName, kAllowRotation, desc);
+            packers.push_back(pPacker);
+            if (! pPacker->Place(kWidth, kHeight, (mMargin == kAutoMargin) ? kAutoMargin : 0, placed, rotated))
+                ++layout.numOrphans;
+        }
+    }
+
+    layout.numAtlases = static_cast<int>(packers.size());
+    for (size_t i = 0; i < packers.size(); ++i)
+    {
+        long width  = desc.width;
+        long height = desc.height;
+        packers[i]->GetShrunkSize(width, height);
+        layout.numTexels += static_cast<long long>(width) * height;
+
+        delete packers[i];
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: IsBetter()
+// Desc: returns true if candidate has fewer orphans, or as many and fewer 
+//       atlases, or as many of both and fewer texels than current
+//-----------------------------------------------------------------------------
+bool LayoutSearch::IsBetter(Layout const &candidate, Layout const &current)
+{
+    if (candidate.numOrphans != current.numOrphans)
+        return candidate.numOrphans < current.numOrphans;
+    if (candidate.numAtlases != current.numAtlases)
+        return candidate.numAtlases < current.numAtlases;
+    return candidate.numTexels < current.numTexels;
+}
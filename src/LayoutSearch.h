@@ -0,0 +1,74 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: LayoutSearch.h
+// Desc: Header file for LayoutSearch class
+//-----------------------------------------------------------------------------
+
+#ifndef LAYOUTSEARCH_H
+#define LAYOUTSEARCH_H
+
+#include "TATypes.h"
+
+class CmdLineOptionCollection;
+class ThreadPool;
+
+//-----------------------------------------------------------------------------
+// Name: LayoutSearch
+// Desc: Picks the packer and texture order for a format group (-bestof).
+//       Every combination of a few packers and sort orders lays out the 
+//       group the same way AtlasContainer::Insert() would, but on the 
+//       texture sizes alone: w/ layout-only packers (see Packer2D::Place()),
+//       so no atlas memory is allocated and no texel is copied.  The 
+//       combinations run in parallel on a thread pool.  The winner is the 
+//       layout w/ the fewest orphaned textures, then the fewest atlases, 
+//       then the fewest texels after shrinking; ties go to the combination
+//       listed first, so the result does not depend on thread timing.
+//-----------------------------------------------------------------------------
+class LayoutSearch
+{
+public:
+    enum eSortOrder
+    {
+        SORT_AREA = 0,              // Texture2DGreater
+        SORT_MAXSIDE,               // Texture2DMaxSideGreater
+        SORT_PERIMETER,             // Texture2DPerimeterGreater
+        SORT_NUM,
+    };
+
+public:
+    LayoutSearch(CmdLineOptionCollection const &options, LONG margin, long atlasWidth, long atlasHeight);
+    ~LayoutSearch();
+
+    void            Run(TTexture2DPtrVector &textureVector, ThreadPool &pool);
+
+    char const *    GetPackerName() const;
+    eSortOrder      GetSortOrder()  const;
+
+    static void     Sort(TTexture2DPtrVector &textureVector, eSortOrder order);
+
+private:
+    struct Layout
+    {
+        int         numOrphans;
+        int         numAtlases;
+        long long   numTexels;
+    };
+
+    void            Evaluate(char const *pPackerName, TTexture2DPtrVector const &textureVector,
+                             Layout &layout) const;
+    static bool     IsBetter(Layout const &candidate, Layout const &current);
+
+private:
+    CmdLineOptionCollection const * mpOptions;
+    LONG                            mMargin;
+    long                            mAtlasWidth;
+    long                            mAtlasHeight;
+
+    char const *                    mpPackerName;
+    eSortOrder                      mSortOrder;
+};
+
+#endif // LAYOUTSEARCH_H
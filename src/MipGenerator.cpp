@@ -0,0 +1,441 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: MipGenerator.cpp
+// Desc: Implementation of the MipGenerator filters
+//-----------------------------------------------------------------------------
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(__SSE2__)
+#define MIPGENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "MipGenerator.h"
+#include "CmdLineOptions.h"
+#include "FormatConverter.h"
+#include "ImageBuffer.h"
+#include "Packer.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    double const kPi            = 3.14159265358979323846;
+    double const kRadius        = 3.0;      // of the sinc filters, in target texels
+    double const kKaiserAlpha   = 4.0;
+
+    //-------------------------------------------------------------------------
+    // Name: Taps
+    // Desc: The source texels each target texel of a row (column) is made
+    //       of, and their weights: those of target texel x are first[x] up
+    //       to (not including) first[x + 1]
+    //-------------------------------------------------------------------------
+    struct Taps
+    {
+        std::vector<size_t> first;
+        std::vector<long>   index;
+        std::vector<float>  weight;
+    };
+
+    //-------------------------------------------------------------------------
+    // Name: Sinc() / BesselI0()
+    // Desc: sin(pi x) / (pi x), and the modified Bessel function of order 0
+    //       the Kaiser window is made of
+    //-------------------------------------------------------------------------
+    double Sinc(double x)
+    {
+        double const kX = kPi * x;
+        return (fabs(kX) < 1.0e-9) ? 1.0 : sin(kX) / kX;
+    }
+
+    double BesselI0(double x)
+    {
+        double sum  = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x * x) / (4.0 * k * k);
+            sum  += term;
+            if (term < sum * 1.0e-12)
+                break;
+        }
+        return sum;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: Kernel()
+    // Desc: The windowed sinc filters at t target texels from the center
+    //-------------------------------------------------------------------------
+    double Kernel(MipGenerator::eFilter filter, double t)
+    {
+        if (fabs(t) >= kRadius)
+            return 0.0;
+        if (filter == MipGenerator::FILTER_LANCZOS)
+            return Sinc(t) * Sinc(t / kRadius);
+
+        double const kRatio = t / kRadius;
+        return Sinc(t) * BesselI0(kKaiserAlpha * sqrt(1.0 - kRatio * kRatio)) / BesselI0(kKaiserAlpha);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: MakeTaps()
+    // Desc: The taps that filter numSources texels down to numTargets.
+    //       Source texels past either end are those at the end, so the
+    //       weights of the texels outside fold onto the edge ones; the
+    //       weights of each target texel add up to 1.
+    //-------------------------------------------------------------------------
+    void MakeTaps(MipGenerator::eFilter filter, long numSources, long numTargets, Taps &taps)
+    {
+        assert((numTargets > 0) && (numSources >= numTargets));
+
+        double const        kScale = static_cast<double>(numSources) / numTargets;
+        std::vector<double> weights;
+        for (long x = 0; x < numTargets; ++x)
+        {
+            long first, end;
+            if (filter == MipGenerator::FILTER_BOX)
+            {
+                first = static_cast<long>(floor(x * kScale));
+                end   = static_cast<long>(ceil((x + 1) * kScale));
+            }
+            else
+            {
+                double const kCenter = (x + 0.5) * kScale;
+                first = static_cast<long>(floor(kCenter - kRadius * kScale));
+                end   = static_cast<long>(ceil (kCenter + kRadius * kScale)) + 1;
+            }
+
+            long const kLow  = (std::max)(0L, (std::min)(first, numSources - 1));
+            long const kHigh = (std::max)(0L, (std::min)(end - 1, numSources - 1));
+            weights.assign(static_cast<size_t>(kHigh - kLow + 1), 0.0);
+
+            double sum = 0.0;
+            for (long j = first; j < end; ++j)
+            {
+                double weight;
+                if (filter == MipGenerator::FILTER_BOX)
+                    weight = (std::min)(static_cast<double>(j + 1), (x + 1) * kScale)
+                           - (std::max)(static_cast<double>(j),      x      * kScale);
+                else
+                    weight = Kernel(filter, (j + 0.5 - (x + 0.5) * kScale) / kScale);
+
+                long const kSource = (std::max)(0L, (std::min)(j, numSources - 1));
+                weights[kSource - kLow] += weight;
+                sum += weight;
+            }
+
+            taps.first.push_back(taps.index.size());
+            for (long j = kLow; j <= kHigh; ++j)
+            {
+                if (weights[j - kLow] == 0.0)
+                    continue;
+                taps.index.push_back(j);
+                taps.weight.push_back(static_cast<float>(weights[j - kLow] / sum));
+            }
+        }
+        taps.first.push_back(taps.index.size());
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: Transfer
+    // Desc: 8 bit channels <-> floats: sRGB decoded to linear and encoded
+    //       again (gamma), or only scaled to [0, 1].  Colors are encoded
+    //       through a table of kEncodeSteps linear steps.
+    //-------------------------------------------------------------------------
+    struct Transfer
+    {
+        enum { kEncodeSteps = 4096 };
+
+        float   decode[256];
+        UCHAR   encode[kEncodeSteps + 1];
+
+        Transfer()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                double const kValue = i / 255.0;
+                decode[i] = static_cast<float>((kValue <= 0.04045) ? kValue / 12.92 : pow((kValue + 0.055) / 1.055, 2.4));
+            }
+            for (int i = 0; i <= kEncodeSteps; ++i)
+            {
+                double const kValue   = static_cast<double>(i) / kEncodeSteps;
+                double const kEncoded = (kValue <= 0.0031308) ? kValue * 12.92 : 1.055 * pow(kValue, 1.0 / 2.4) - 0.055;
+                encode[i] = static_cast<UCHAR>(kEncoded * 255.0 + 0.5);
+            }
+        }
+
+        static Transfer const & Get()
+        {
+            static Transfer const kTransfer;
+            return kTransfer;
+        }
+    };
+
+    //-------------------------------------------------------------------------
+    // Name: DecodeTexels() / EncodeTexels()
+    // Desc: A8R8G8B8 texels <-> 4 floats each, in the order of the bytes
+    //       (blue, green, red, alpha)
+    //-------------------------------------------------------------------------
+    void DecodeTexels(uint32_t const *pSource, float *pTarget, long numTexels, bool gamma)
+    {
+        Transfer const &kTransfer = Transfer::Get();
+        for (long i = 0; i < numTexels; ++i, pTarget += 4)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                uint32_t const kValue = (pSource[i] >> (8 * c)) & 0xFF;
+                pTarget[c] = gamma ? kTransfer.decode[kValue] : kValue * (1.0f / 255.0f);
+            }
+            pTarget[3] = (pSource[i] >> 24) * (1.0f / 255.0f);
+        }
+    }
+
+    void EncodeTexels(float const *pSource, uint32_t *pTarget, long numTexels, bool gamma)
+    {
+        Transfer const &kTransfer = Transfer::Get();
+        for (long i = 0; i < numTexels; ++i, pSource += 4)
+        {
+            uint32_t texel = 0;
+            for (int c = 0; c < 4; ++c)
+            {
+                float const kValue = (std::min)((std::max)(pSource[c], 0.0f), 1.0f);
+                uint32_t const kEncoded = ((c < 3) && gamma)
+                    ? kTransfer.encode[static_cast<int>(kValue * Transfer::kEncodeSteps + 0.5f)]
+                    : static_cast<uint32_t>(kValue * 255.0f + 0.5f);
+                texel |= kEncoded << (8 * c);
+            }
+            pTarget[i] = texel;
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: FilterRow()
+    // Desc: Filters a row of texels (4 floats each) down to the targets of
+    //       taps
+    //-------------------------------------------------------------------------
+    void FilterRow(Taps const &taps, float const *pSource, float *pTarget)
+    {
+        size_t const kNumTargets = taps.first.size() - 1;
+        for (size_t x = 0; x < kNumTargets; ++x, pTarget += 4)
+        {
+#ifdef MIPGENERATOR_SSE2
+            __m128 sum = _mm_setzero_ps();
+            for (size_t k = taps.first[x]; k < taps.first[x + 1]; ++k)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(taps.weight[k]), _mm_loadu_ps(pSource + 4 * taps.index[k])));
+            _mm_storeu_ps(pTarget, sum);
+#else
+            float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (size_t k = taps.first[x]; k < taps.first[x + 1]; ++k)
+                for (int c = 0; c < 4; ++c)
+                    sum[c] += taps.weight[k] * pSource[4 * taps.index[k] + c];
+            memcpy(pTarget, sum, sizeof(sum));
+#endif
+        }
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: AddWeightedRow()
+    // Desc: pTarget += weight * pSource, for numFloats floats
+    //-------------------------------------------------------------------------
+    void AddWeightedRow(float weight, float const *pSource, float *pTarget, size_t numFloats)
+    {
+        size_t i = 0;
+#ifdef MIPGENERATOR_SSE2
+        __m128 const kWeight = _mm_set1_ps(weight);
+        for (; i + 4 <= numFloats; i += 4)
+            _mm_storeu_ps(pTarget + i, _mm_add_ps(_mm_loadu_ps(pTarget + i), _mm_mul_ps(kWeight, _mm_loadu_ps(pSource + i))));
+#endif
+        for (; i < numFloats; ++i)
+            pTarget[i] += weight * pSource[i];
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: GetLevelRect()
+    // Desc: Where Packer2D::CopyBits() puts a region's mip-map at level:
+    //       its offset divided and its size divided (at least 1), clipped
+    //       to the level of image.  Returns false if nothing is left.
+    //-------------------------------------------------------------------------
+    bool GetLevelRect(ImageBuffer const &image, Region const &region, int level,
+                      long &left, long &top, long &width, long &height)
+    {
+        long const div = 1L << level;
+        left   = region.mLeft / div;
+        top    = region.mTop  / div;
+        width  = (std::min)((std::max)(1L, region.GetWidth()  / div), image.GetWidth(level)  - left);
+        height = (std::min)((std::max)(1L, region.GetHeight() / div), image.GetHeight(level) - top);
+        return (width > 0) && (height > 0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: ParseFilter()
+// Desc: Reads the -mipfilter argument: box, kaiser or lanczos, optionally
+//       followed by :linear, which filters the values as they are stored
+//       rather than in linear space.  Returns false if it is none of these.
+//-----------------------------------------------------------------------------
+bool MipGenerator::ParseFilter(char const *pName, eFilter *pFilter, bool *pGamma)
+{
+    char filter[16];
+    char const *pColon = strchr(pName, ':');
+    size_t const kLength = (pColon != nullptr) ? static_cast<size_t>(pColon - pName) : strlen(pName);
+    if (kLength >= sizeof(filter))
+        return false;
+    memcpy(filter, pName, kLength);
+    filter[kLength] = '\0';
+
+    if (_strcmpi(filter, "box") == 0)
+        *pFilter = FILTER_BOX;
+    else if (_strcmpi(filter, "kaiser") == 0)
+        *pFilter = FILTER_KAISER;
+    else if (_strcmpi(filter, "lanczos") == 0)
+        *pFilter = FILTER_LANCZOS;
+    else
+        return false;
+
+    if (pColon == nullptr)
+        *pGamma = true;
+    else if (_strcmpi(pColon + 1, "linear") == 0)
+        *pGamma = false;
+    else
+        return false;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetFilter()
+// Desc: Returns false if -mipfilter is not set, or does not apply because
+//       there are no mip-levels (-nomipmap, which volume atlases require),
+//       otherwise the filter it asks for
+//-----------------------------------------------------------------------------
+bool MipGenerator::GetFilter(CmdLineOptionCollection const &options, eFilter *pFilter, bool *pGamma)
+{
+    return    options.IsSet(CLO_MIPFILTER) && ! options.IsSet(CLO_NOMIPMAP)
+           && ParseFilter(options.GetArgument(CLO_MIPFILTER, 0), pFilter, pGamma);
+}
+
+//-----------------------------------------------------------------------------
+// Name: CanFilter()
+// Desc: Returns true if the texels of the given format can be filtered:
+//       they can be converted to A8R8G8B8 and back
+//-----------------------------------------------------------------------------
+bool MipGenerator::CanFilter(D3DFORMAT format)
+{
+    return FormatConverter::CanConvertFrom(format) && FormatConverter::CanConvertTo(format);
+}
+
+//-----------------------------------------------------------------------------
+// Name: Generate()
+// Desc: Makes levels 1 and up of image from its base level, within each of
+//       the regions (in level 0 texels, w/o margins).  The levels are made
+//       one after the other, the bands of each on all cores.  The regions
+//       are filtered in their order, so where the smallest mip-maps of
+//       neighbors overlap the atlas ends up the same as w/ one thread.
+//-----------------------------------------------------------------------------
+void MipGenerator::Generate(ImageBuffer &image, std::vector<Region> const &regions, eFilter filter, bool gamma,
+                            ThreadPool &pool)
+{
+    assert(CanFilter(image.GetFormat()));
+
+    for (int level = 1; level < image.GetLevelCount(); ++level)
+    {
+        long const kNumRows  = image.GetNumRows(level);
+        int const  kNumTasks = static_cast<int>((kNumRows + kTaskRows - 1) / kTaskRows);
+        pool.Run(kNumTasks, [&](int k)
+        {
+            long const kFirstRow = static_cast<long>(k) * kTaskRows;
+            FilterRows(image, regions, filter, gamma, level, kFirstRow, (std::min)(kNumRows, kFirstRow + kTaskRows));
+        });
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: FilterRows()
+// Desc: Makes the rows firstRow up to (not including) endRow of level from
+//       the level above it.  The source rows of a region are filtered
+//       horizontally first, each once, then the target rows vertically.
+//       Nothing but those rows of level is written.
+//-----------------------------------------------------------------------------
+void MipGenerator::FilterRows(ImageBuffer &image, std::vector<Region> const &regions, eFilter filter, bool gamma,
+                              int level, long firstRow, long endRow)
+{
+    D3DFORMAT const kFormat     = image.GetFormat();
+    int const       kTexelBytes = ImageBuffer::SizeOfTexel(kFormat) / 8;
+
+    // the same sizes come up over and over again
+    std::map<std::pair<long, long>, Taps>   tapsCache;
+    auto const GetTaps = [&](long numSources, long numTargets) -> Taps const &
+    {
+        Taps &taps = tapsCache[std::make_pair(numSources, numTargets)];
+        if (taps.first.empty())
+            MakeTaps(filter, numSources, numTargets, taps);
+        return taps;
+    };
+
+    std::vector<uint32_t>   texels;
+    std::vector<float>      sourceRow;
+    std::vector<float>      filteredRows;
+    std::vector<float>      targetRow;
+    for (size_t i = 0; i < regions.size(); ++i)
+    {
+        long sourceLeft, sourceTop, sourceWidth, sourceHeight;
+        long targetLeft, targetTop, targetWidth, targetHeight;
+        if (   ! GetLevelRect(image, regions[i], level - 1, sourceLeft, sourceTop, sourceWidth, sourceHeight)
+            || ! GetLevelRect(image, regions[i], level,     targetLeft, targetTop, targetWidth, targetHeight))
+            continue;
+
+        long const kFirstRow = (std::max)(firstRow, targetTop) - targetTop;
+        long const kEndRow   = (std::min)(endRow,   targetTop + targetHeight) - targetTop;
+        if (kFirstRow >= kEndRow)
+            continue;
+
+        // (clipped at the edge of the atlas the level above can be the narrower one)
+        Taps const &kColumns = GetTaps(sourceWidth,  (std::min)(targetWidth,  sourceWidth));
+        Taps const &kRows    = GetTaps(sourceHeight, (std::min)(targetHeight, sourceHeight));
+        long const  kWidth   = static_cast<long>(kColumns.first.size()) - 1;
+        long const  kEnd     = (std::min)(kEndRow, static_cast<long>(kRows.first.size()) - 1);
+
+        long sourceFirst = sourceHeight;
+        long sourceEnd   = 0;
+        for (long y = kFirstRow; y < kEnd; ++y)
+        {
+            sourceFirst = (std::min)(sourceFirst, kRows.index[kRows.first[y]]);
+            sourceEnd   = (std::max)(sourceEnd,   kRows.index[kRows.first[y + 1] - 1] + 1);
+        }
+
+        texels.resize(static_cast<size_t>((std::max)(sourceWidth, kWidth)));
+        sourceRow.resize(4 * static_cast<size_t>(sourceWidth));
+        filteredRows.resize(4 * static_cast<size_t>(kWidth) * (sourceEnd - sourceFirst));
+        targetRow.resize(4 * static_cast<size_t>(kWidth));
+
+        for (long row = sourceFirst; row < sourceEnd; ++row)
+        {
+            FormatConverter::ConvertRow(kFormat, image.GetRow(level - 1, sourceTop + row) + sourceLeft * kTexelBytes,
+                                        D3DFMT_A8R8G8B8, reinterpret_cast<UCHAR *>(&texels[0]), sourceWidth);
+            DecodeTexels(&texels[0], &sourceRow[0], sourceWidth, gamma);
+            FilterRow(kColumns, &sourceRow[0], &filteredRows[4 * static_cast<size_t>(kWidth) * (row - sourceFirst)]);
+        }
+
+        for (long y = kFirstRow; y < kEnd; ++y)
+        {
+            std::fill(targetRow.begin(), targetRow.end(), 0.0f);
+            for (size_t k = kRows.first[y]; k < kRows.first[y + 1]; ++k)
+                AddWeightedRow(kRows.weight[k], &filteredRows[4 * static_cast<size_t>(kWidth) * (kRows.index[k] - sourceFirst)],
+                               &targetRow[0], targetRow.size());
+
+            EncodeTexels(&targetRow[0], &texels[0], kWidth, gamma);
+            FormatConverter::ConvertRow(D3DFMT_A8R8G8B8, reinterpret_cast<UCHAR const *>(&texels[0]),
+                                        kFormat, image.GetRow(level, targetTop + y) + targetLeft * kTexelBytes, kWidth);
+        }
+    }
+}
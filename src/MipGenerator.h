@@ -0,0 +1,69 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: MipGenerator.h
+// Desc: Header file for MipGenerator class
+//-----------------------------------------------------------------------------
+
+#ifndef MIPGENERATOR_H
+#define MIPGENERATOR_H
+
+#include <vector>
+
+#include "HeadlessTypes.h"
+
+class CmdLineOptionCollection;
+class ImageBuffer;
+class Region;
+class ThreadPool;
+
+//-----------------------------------------------------------------------------
+// Name: MipGenerator
+// Desc: Makes the mip-levels of an atlas from its base level (-mipfilter),
+//       so the textures in it only need their base level decoded.  Every
+//       level is filtered down from the one above it, sub-image by
+//       sub-image: samples outside a sub-image are clamped to its edge, so
+//       no texel of a level is ever made from those of its neighbors.
+//       The sub-images at a level are those Packer2D::CopyBits() copies
+//       the mip-maps of textures to.
+//
+//       The filters are separable: FILTER_BOX averages the texels each
+//       target texel covers, FILTER_KAISER and FILTER_LANCZOS are sinc
+//       filters windowed by a Kaiser (alpha 4) and a Lanczos window, 3
+//       target texels wide to either side.  Colors are averaged in linear
+//       space (sRGB decoded and encoded again) unless asked not to; alpha
+//       always is linear.  The texels are filtered as floats, the 4
+//       channels of a texel at once w/ SSE2 where the compiler targets it.
+//       Each level is cut into bands of kTaskRows rows, which are filtered
+//       on a ThreadPool.
+//-----------------------------------------------------------------------------
+class MipGenerator
+{
+public:
+    enum eFilter
+    {
+        FILTER_BOX = 0,
+        FILTER_KAISER,
+        FILTER_LANCZOS,
+    };
+
+public:
+    static bool ParseFilter(char const *pName, eFilter *pFilter, bool *pGamma);
+    static bool GetFilter(CmdLineOptionCollection const &options, eFilter *pFilter, bool *pGamma);
+    static bool CanFilter(D3DFORMAT format);
+    static void Generate(ImageBuffer &image, std::vector<Region> const &regions, eFilter filter, bool gamma,
+                         ThreadPool &pool);
+
+private:
+    enum
+    {
+        kTaskRows = 32,                 // rows of a level each task filters
+    };
+
+    static void FilterRows(ImageBuffer &image, std::vector<Region> const &regions, eFilter filter, bool gamma,
+                           int level, long firstRow, long endRow);
+};
+
+#endif // MIPGENERATOR_H
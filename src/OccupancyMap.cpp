@@ -0,0 +1,319 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: OccupancyMap.cpp
+// Desc: Implementation of the OccupancyMap bitmap
+//-----------------------------------------------------------------------------
+
+#include <assert.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include <algorithm>
+
+#include "OccupancyMap.h"
+
+namespace
+{
+    uint64_t const kAllBits = ~uint64_t(0);
+
+    //-------------------------------------------------------------------------
+    // Name: LowestBit()
+    // Desc: Index of the lowest set bit of value, which must not be 0
+    //-------------------------------------------------------------------------
+    inline long LowestBit(uint64_t value)
+    {
+        assert(value != 0);
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<long>(index);
+#elif defined(_MSC_VER)
+        unsigned long index;
+        if (_BitScanForward(&index, static_cast<unsigned long>(value)))
+            return static_cast<long>(index);
+        _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+        return static_cast<long>(index) + 32;
+#else
+        return static_cast<long>(__builtin_ctzll(value));
+#endif
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: HighestBit()
+    // Desc: Index of the highest set bit of value, which must not be 0
+    //-------------------------------------------------------------------------
+    inline long HighestBit(uint64_t value)
+    {
+        assert(value != 0);
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<long>(index);
+#elif defined(_MSC_VER)
+        unsigned long index;
+        if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+            return static_cast<long>(index) + 32;
+        _BitScanReverse(&index, static_cast<unsigned long>(value));
+        return static_cast<long>(index);
+#else
+        return 63L - static_cast<long>(__builtin_clzll(value));
+#endif
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: WordMask()
+    // Desc: Mask of the bits of word w that lie in columns [first, end)
+    //-------------------------------------------------------------------------
+    inline uint64_t WordMask(long w, long first, long end)
+    {
+        long const kWordFirst = w * OccupancyMap::kBitsPerWord;
+        long const kLow       = (first > kWordFirst) ? (first - kWordFirst) : 0L;
+        long const kHigh      = (end - kWordFirst < OccupancyMap::kBitsPerWord)
+                                    ? (end - kWordFirst) : long(OccupancyMap::kBitsPerWord);
+
+        uint64_t mask = kAllBits << kLow;
+        if (kHigh < OccupancyMap::kBitsPerWord)
+            mask &= ~(kAllBits << kHigh);
+        return mask;
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: StepUp()
+    // Desc: The first multiple of step at or above cell
+    //-------------------------------------------------------------------------
+    inline long StepUp(long cell, long step)
+    {
+        return ((cell + step - 1) / step) * step;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: OccupancyMap()
+// Desc: Constructor: all cells are free
+//-----------------------------------------------------------------------------
+OccupancyMap::OccupancyMap(long columns, long rows)
+    : mColumns(columns)
+    , mRows(rows)
+    , mWordsPerRow((columns + kBitsPerWord - 1) / kBitsPerWord)
+{
+    assert((columns > 0) && (rows > 0));
+    mWords.resize(mWordsPerRow * mRows, 0);
+    mLongestFreeRun.resize(mRows, mColumns);
+
+    // mark the padding bits past the last column as used, so scans over
+    // whole words never report them as free
+    if (mColumns % kBitsPerWord != 0)
+    {
+        uint64_t const kPadding = kAllBits << (mColumns % kBitsPerWord);
+        for (long row = 0; row < mRows; ++row)
+            mWords[row * mWordsPerRow + mWordsPerRow - 1] = kPadding;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: ~OccupancyMap()
+// Desc: Destructor
+//-----------------------------------------------------------------------------
+OccupancyMap::~OccupancyMap()
+{
+    ;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetColumns()
+// Desc: returns the number of cells per row
+//-----------------------------------------------------------------------------
+long OccupancyMap::GetColumns() const
+{
+    return mColumns;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetRows()
+// Desc: returns the number of rows
+//-----------------------------------------------------------------------------
+long OccupancyMap::GetRows() const
+{
+    return mRows;
+}
+
+//-----------------------------------------------------------------------------
+// Name: IsFree()
+// Desc: returns true if none of the cells of the passed in rectangle is used.
+//       Parts outside of the map count as used.
+//-----------------------------------------------------------------------------
+bool OccupancyMap::IsFree(long column, long row, long columns, long rows) const
+{
+    if (   (column < 0) || (row < 0)
+        || (column + columns > mColumns) || (row + rows > mRows))
+        return false;
+
+    for (long r = row; r < row + rows; ++r)
+        if (FindLastUsed(r, column, columns) >= 0)
+            return false;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: SetUsed()
+// Desc: Marks all cells of the passed in rectangle as used
+//-----------------------------------------------------------------------------
+void OccupancyMap::SetUsed(long column, long row, long columns, long rows)
+{
+    assert((column >= 0) && (row >= 0));
+    assert((column + columns <= mColumns) && (row + rows <= mRows));
+
+    long const kEnd       = column + columns;
+    long const kFirstWord = column / kBitsPerWord;
+    long const kLastWord  = (kEnd - 1) / kBitsPerWord;
+
+    for (long r = row; r < row + rows; ++r)
+    {
+        uint64_t *pRow = &mWords[r * mWordsPerRow];
+        for (long w = kFirstWord; w <= kLastWord; ++w)
+            pRow[w] |= WordMask(w, column, kEnd);
+
+        mLongestFreeRun[r] = GetLongestFreeRun(r);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindFree()
+// Desc: First fit search for a free columns x rows rectangle, top to bottom
+//       then left to right, starting only at columns and rows that are 
+//       multiples of step.  Returns false if there is none.
+//       For each start row the free runs of that row are candidates; the
+//       rows below are then checked a word at a time.  If one of them has a
+//       used cell in the candidate's span, no start column up to that cell
+//       can work, so the search resumes right after it.  Start rows that
+//       would cover a row w/o a long enough free run are skipped outright.
+//-----------------------------------------------------------------------------
+bool OccupancyMap::FindFree(long columns, long rows, long step, long &column, long &row) const
+{
+    assert(step > 0);
+    if ((columns <= 0) || (rows <= 0) || (columns > mColumns) || (rows > mRows))
+        return false;
+
+    for (long r = 0; r + rows <= mRows; r += step)
+    {
+        // skip start rows for which one of the rows below is too full
+        // (to the first one below that row)
+        long full = r + rows - 1;
+        while ((full >= r) && (mLongestFreeRun[full] >= columns))
+            --full;
+        if (full >= r)
+        {
+            r = (full / step) * step;
+            continue;
+        }
+
+        long candidate;
+        long from = 0;
+        while (FindFreeRun(r, from, columns, step, candidate))
+        {
+            long lastUsed = -1;
+            for (long below = r + 1; (below < r + rows) && (lastUsed < 0); ++below)
+                lastUsed = FindLastUsed(below, candidate, columns);
+
+            if (lastUsed < 0)
+            {
+                column = candidate;
+                row    = r;
+                return true;
+            }
+            from = lastUsed + 1;
+        }
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindLastUsed()
+// Desc: Column of the right-most used cell in [column, column + columns) of
+//       the row, or -1 if all of them are free
+//-----------------------------------------------------------------------------
+long OccupancyMap::FindLastUsed(long row, long column, long columns) const
+{
+    long const kEnd       = column + columns;
+    long const kFirstWord = column / kBitsPerWord;
+    long const kLastWord  = (kEnd - 1) / kBitsPerWord;
+
+    uint64_t const *pRow = &mWords[row * mWordsPerRow];
+    for (long w = kLastWord; w >= kFirstWord; --w)
+    {
+        uint64_t const kUsed = pRow[w] & WordMask(w, column, kEnd);
+        if (kUsed != 0)
+            return w * kBitsPerWord + HighestBit(kUsed);
+    }
+    return -1;
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindNext()
+// Desc: Column of the first used (or free) cell of the row at or right of
+//       column, or the number of columns if there is none
+//-----------------------------------------------------------------------------
+long OccupancyMap::FindNext(long row, long column, bool used) const
+{
+    if (column >= mColumns)
+        return mColumns;
+
+    uint64_t const *pRow   = &mWords[row * mWordsPerRow];
+    uint64_t const  kFlip  = used ? 0 : kAllBits;
+
+    long     w    = column / kBitsPerWord;
+    uint64_t bits = (pRow[w] ^ kFlip) & (kAllBits << (column % kBitsPerWord));
+    while (bits == 0)
+    {
+        if (++w == mWordsPerRow)
+            return mColumns;
+        bits = pRow[w] ^ kFlip;
+    }
+
+    long const kColumn = w * kBitsPerWord + LowestBit(bits);
+    return (kColumn < mColumns) ? kColumn : mColumns;
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindFreeRun()
+// Desc: Finds the first run of at least columns free cells in the row that
+//       starts at a multiple of step at or right of fromColumn.  Returns 
+//       false if there is none.
+//-----------------------------------------------------------------------------
+bool OccupancyMap::FindFreeRun(long row, long fromColumn, long columns, long step, long &column) const
+{
+    long start = StepUp(FindNext(row, fromColumn, false), step);
+    while (start + columns <= mColumns)
+    {
+        long const kEnd = FindNext(row, start, true);
+        if (kEnd - start >= columns)
+        {
+            column = start;
+            return true;
+        }
+        start = StepUp(FindNext(row, kEnd, false), step);
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetLongestFreeRun()
+// Desc: Length of the longest run of free cells in the row
+//-----------------------------------------------------------------------------
+long OccupancyMap::GetLongestFreeRun(long row) const
+{
+    long longest = 0;
+    long start   = FindNext(row, 0, false);
+    while (start < mColumns)
+    {
+        long const kEnd = FindNext(row, start, true);
+        longest = (std::max)(longest, kEnd - start);
+        start   = FindNext(row, kEnd, false);
+    }
+    return longest;
+}
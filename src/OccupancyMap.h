@@ -0,0 +1,60 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: OccupancyMap.h
+// Desc: Header file for OccupancyMap class
+//-----------------------------------------------------------------------------
+
+#ifndef OCCUPANCYMAP_H
+#define OCCUPANCYMAP_H
+
+#include <stdint.h>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Name: OccupancyMap
+// Desc: One bit per cell (a texel, or a 4x4 block in DXTn atlases) telling
+//       whether the cell is used.  Each row is stored as 64-bit words, so
+//       testing or marking a rectangle costs a few AND/OR operations per
+//       row, independent of how many textures were placed already.
+//       Bit b of word w of a row stands for column w*64 + b.
+//-----------------------------------------------------------------------------
+class OccupancyMap
+{
+public:
+    enum
+    {
+        kBitsPerWord = 64,
+    };
+
+public:
+    OccupancyMap(long columns, long rows);
+    ~OccupancyMap();
+
+    long GetColumns() const;
+    long GetRows()    const;
+
+    bool IsFree(long column, long row, long columns, long rows) const;
+    void SetUsed(long column, long row, long columns, long rows);
+    bool FindFree(long columns, long rows, long step, long &column, long &row) const;
+
+private:
+    long FindLastUsed(long row, long column, long columns) const;
+    long FindNext(long row, long column, bool used) const;
+    bool FindFreeRun(long row, long fromColumn, long columns, long step, long &column) const;
+    long GetLongestFreeRun(long row) const;
+
+private:
+    long                    mColumns;
+    long                    mRows;
+    long                    mWordsPerRow;
+    std::vector<uint64_t>   mWords;
+
+    // length of the longest run of free cells of each row, so FindFree() 
+    // can skip rows that are too full w/o looking at their bits
+    std::vector<long>       mLongestFreeRun;
+};
+
+#endif // OCCUPANCYMAP_H
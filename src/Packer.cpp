@@ -15,9 +15,18 @@
 // Desc: Packer class implementation.
 //-----------------------------------------------------------------------------
 
+#include <stdio.h>
 #include <assert.h>
+#include <string.h>
+
+#include <algorithm>
 
 #include "Packer.h"
+#include "PackerMaxRects.h"
+#include "PackerSkyline.h"
+#include "PackerGuillotine.h"
+#include "PackerBitmap.h"
+#include "CmdLineOptions.h"
 #include "TextureObject.h"
 
 //-----------------------------------------------------------------------------
@@ -25,10 +34,10 @@
 // Desc: Constructor
 //-----------------------------------------------------------------------------
 Region::Region()
-    : mBottom(0)
-    , mLeft(0)
+    : mLeft(0)
     , mRight(0)
     , mTop(0)
+    , mBottom(0)
 {
     ;
 }
@@ -69,20 +78,15 @@ long Region::GetHeight() const
 bool Region::Intersect(Region const &region, bool shrinkTest) const
 {
     // Note Region is defined as [left, right) and [top, bottom)!
-    // general tests: test whether region's edges are inside this region
-    bool const leftIsInside   = (region.mLeft   >= mLeft) && ((!shrinkTest && (region.mLeft < mRight)) || (shrinkTest && (region.mLeft <= mRight)));
-    bool const rightIsInside  = (region.mRight  >  mLeft) && (region.mRight  <= mRight);
-    
-    bool const topIsInside    = (region.mTop    >= mTop ) && ((!shrinkTest && (region.mTop < mBottom)) || (shrinkTest && (region.mTop <= mBottom)));
-    
-    bool const bottomIsInside = (region.mBottom >  mTop ) && (region.mBottom <= mBottom);
-
-    // if and only if (at least) one of the horizontal edges and 
-    //                (at least) one of the vertical edges inside than the two inersect
-    if ((leftIsInside || rightIsInside) && (topIsInside || bottomIsInside))
-        return true;
+    // The two intersect if and only if their horizontal and their vertical
+    // extents overlap.  This also catches the case of one region containing 
+    // the other (which testing for edges inside this region missed).
+    // A shrink test also counts regions that touch the passed in region's 
+    // left or top edge.
+    bool const horizontalOverlap = (region.mRight  > mLeft) && ((!shrinkTest && (region.mLeft < mRight )) || (shrinkTest && (region.mLeft <= mRight )));
+    bool const verticalOverlap   = (region.mBottom > mTop ) && ((!shrinkTest && (region.mTop  < mBottom)) || (shrinkTest && (region.mTop  <= mBottom)));
 
-    return false;
+    return horizontalOverlap && verticalOverlap;
 }
 
 //-----------------------------------------------------------------------------
@@ -112,76 +116,17 @@ Packer::~Packer()
 //-----------------------------------------------------------------------------
 int Packer::SizeOfTexel( D3DFORMAT format ) const
 {
-	switch( format )
-	{
-		case D3DFMT_R8G8B8:			return 3*8;
-		case D3DFMT_A8R8G8B8:		return 4*8;
-		case D3DFMT_X8R8G8B8:		return 4*8;
-		case D3DFMT_R5G6B5:			return 2*8;
-		case D3DFMT_X1R5G5B5:		return 2*8;
-		case D3DFMT_A1R5G5B5:		return 2*8;
-		case D3DFMT_A4R4G4B4:		return 2*8;
-		case D3DFMT_R3G3B2:			return 8;
-		case D3DFMT_A8:				return 8;
-		case D3DFMT_A8R3G3B2:		return 2*8;
-		case D3DFMT_X4R4G4B4:		return 2*8;
-		case D3DFMT_A2B10G10R10:	return 4*8;
-		case D3DFMT_A8B8G8R8:		return 4*8;
-		case D3DFMT_X8B8G8R8:		return 4*8;
-		case D3DFMT_G16R16:			return 4*8;
-		case D3DFMT_A2R10G10B10:	return 4*8;
-		case D3DFMT_A16B16G16R16:	return 8*8;
-		case D3DFMT_A8P8:			return 8;
-		case D3DFMT_P8:				return 8;
-		case D3DFMT_L8:				return 8;
-		case D3DFMT_L16:			return 2*8;
-		case D3DFMT_A8L8:			return 2*8;
-		case D3DFMT_A4L4:			return 8;
-		case D3DFMT_V8U8:			return 2*8;
-		case D3DFMT_Q8W8V8U8:		return 4*8;
-		case D3DFMT_V16U16:			return 4*8;
-		case D3DFMT_Q16W16V16U16:	return 8*8;
-		case D3DFMT_CxV8U8:			return 2*8;
-		case D3DFMT_L6V5U5:			return 2*8;
-		case D3DFMT_X8L8V8U8:		return 4*8;
-		case D3DFMT_A2W10V10U10:	return 4*8;
-		case D3DFMT_G8R8_G8B8:		return 2*8;
-		case D3DFMT_R8G8_B8G8:		return 2*8;
-		case D3DFMT_DXT1:			return 4;
-		case D3DFMT_DXT2:			return 8;
-		case D3DFMT_DXT3:			return 8;
-		case D3DFMT_DXT4:			return 8;
-		case D3DFMT_DXT5:			return 8;
-		case D3DFMT_UYVY:			return 2*8;
-		case D3DFMT_YUY2:			return 2*8;
-		case D3DFMT_R16F:			return 2*8;
-		case D3DFMT_G16R16F:		return 4*8;
-		case D3DFMT_A16B16G16R16F:	return 8*8;
-		case D3DFMT_R32F:			return 4*8;
-		case D3DFMT_G32R32F:		return 8*8;
-		case D3DFMT_A32B32G32R32F:	return 16*8;
-		default:
-			return 0;
-	}
+    return ImageBuffer::SizeOfTexel(format);
 }
 
 //-----------------------------------------------------------------------------
 // Name: IsDXTnFormat()
-// Desc: Returns true if the given format is a DXT format, false otherwise
+// Desc: Returns true if the given format is a DXT format, or ATI1/ATI2 
+//       which are made of the same 4x4 blocks, false otherwise
 //-----------------------------------------------------------------------------
 bool Packer::IsDXTnFormat( D3DFORMAT format ) const 
 {
-	switch( format )
-	{
-		case D3DFMT_DXT1:		
-		case D3DFMT_DXT2:		
-		case D3DFMT_DXT3:		
-		case D3DFMT_DXT4:		
-		case D3DFMT_DXT5:		
-			return true;
-		default:
-			return false;
-	}
+    return ImageBuffer::IsDXTnFormat(format);
 }
 
 //-----------------------------------------------------------------------------
@@ -199,12 +144,20 @@ int Packer::GetMaxMipLevels() const
 // Name: Packer2D()
 // Desc: Constructor
 //-----------------------------------------------------------------------------
-Packer2D::Packer2D(Atlas2D * pAtlas)
-    : mpAtlas(pAtlas)
+Packer2D::Packer2D(AtlasDesc const &desc)
+    : mpAtlas(nullptr)
+    , mDesc(desc)
+    , mUsedRegionGrid(desc.width, desc.height)
+    , mNumInserted(0)
+    , mNumMerges(0)
+    , mNumProbes(0)
+    , mNumRotated(0)
+    , mNumKnownMisses(0)
+    , mbAllowRotation(false)
+    , mUsedRight(0)
+    , mUsedBottom(0)
 {
-    assert(pAtlas != nullptr);
-
-    mTotalFreeTexels = pAtlas->GetNumTexels();
+    mTotalFreeTexels = desc.width * desc.height;
 }
 
 //-----------------------------------------------------------------------------
@@ -223,22 +176,371 @@ Packer2D::~Packer2D()
     mpAtlas = nullptr;
 }
 
+//-----------------------------------------------------------------------------
+// Name: Create()
+// Desc: Creates the 2D packer pName names, or if it is nullptr the one 
+//       selected w/ the -packer option (the grid scan Packer2D if the option
+//       is not set), for the passed in atlas.  The option's argument was 
+//       already checked by CmdLineOptionCollection, see IsValidPackerName().
+//-----------------------------------------------------------------------------
+Packer2D * Packer2D::Create(CmdLineOptionCollection const &options, Atlas2D * pAtlas, char const *pName)
+{
+    assert(pAtlas != nullptr);
+
+    AtlasDesc desc;
+    desc.width  = pAtlas->GetWidth();
+    desc.height = pAtlas->GetHeight();
+    desc.format = pAtlas->GetFormat();
+    desc.mipMaps = ! options.IsSet(CLO_NOMIPMAP);
+
+    if (pName == nullptr)
+        pName = options.IsSet(CLO_PACKER) ? options.GetArgument(CLO_PACKER, 0) : "grid";
+
+    Packer2D *pPacker = Create(pName, options.IsSet(CLO_ROTATE), desc);
+    pPacker->mpAtlas  = pAtlas;
+    return pPacker;
+}
+
+//-----------------------------------------------------------------------------
+// Name: Create()
+// Desc: Creates the 2D packer pName names for an atlas described by desc.
+//       The packer has no atlas: it can only Place() textures, e.g., to try
+//       out a layout w/o touching any texels.
+//-----------------------------------------------------------------------------
+Packer2D * Packer2D::Create(char const *pName, bool allowRotation, AtlasDesc const &desc)
+{
+    assert(IsValidPackerName(pName));
+
+    Packer2D                    *pPacker = nullptr;
+    PackerMaxRects::eHeuristic  maxRectsHeuristic;
+    bool                        useWasteMap;
+    PackerGuillotine::Settings  guillotineSettings;
+
+    if (PackerMaxRects::ParseName(pName, &maxRectsHeuristic))
+        pPacker = new PackerMaxRects(desc, maxRectsHeuristic);
+    else if (PackerSkyline::ParseName(pName, &useWasteMap))
+        pPacker = new PackerSkyline(desc, useWasteMap);
+    else if (PackerGuillotine::ParseName(pName, &guillotineSettings))
+        pPacker = new PackerGuillotine(desc, guillotineSettings);
+    else if (PackerBitmap::ParseName(pName))
+        pPacker = new PackerBitmap(desc);
+    else
+        pPacker = new Packer2D(desc);
+
+    pPacker->mbAllowRotation = allowRotation;
+    return pPacker;
+}
+
+//-----------------------------------------------------------------------------
+// Name: IsValidPackerName()
+// Desc: returns true if the passed in string names a known 2D packer
+//-----------------------------------------------------------------------------
+bool Packer2D::IsValidPackerName(char const *pName)
+{
+    if (pName == nullptr)
+        return false;
+
+    return    (_strcmpi(pName, "grid") == 0) 
+           || PackerMaxRects::ParseName(pName, nullptr)
+           || PackerSkyline::ParseName(pName, nullptr)
+           || PackerGuillotine::ParseName(pName, nullptr)
+           || PackerBitmap::ParseName(pName);
+}
+
 //-----------------------------------------------------------------------------
 // Name: Insert()
 // Desc: Insert passed-in texture into atlas.  If no free spot is found, 
-//       return false.  If a free spot is found, copy bits from texture 
-//       to atlas, update texture to point to proper sub-region in atlas
-//       add the newly filled region to the used region vector, then
-//       return true.
+//       return false.  If a free spot is found, update texture to point to
+//       proper sub-region in atlas, add the newly filled region to the used
+//       region vector, then return true.
+//       No bits are copied yet: the atlas does that once it knows its 
+//       final size, see Atlas2D::Shrink().
 //-----------------------------------------------------------------------------
 bool Packer2D::Insert(Texture2D *pTexture, LONG margin)
+{
+    assert(mpAtlas != nullptr);
+
+    Placement placement;
+    if (! FindPlacement(pTexture->GetWidth(), pTexture->GetHeight(), margin, placement))
+        return false;
+
+    InsertAt(pTexture, placement);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: InsertAt()
+// Desc: Second half of Insert(): puts the texture into the spot the last
+//       FindPlacement() call found for it and points the texture to its 
+//       sub-region of the atlas.
+//-----------------------------------------------------------------------------
+void Packer2D::InsertAt(Texture2D *pTexture, Placement const &placement)
+{
+    assert(mpAtlas != nullptr);
+
+    CommitPlacement(pTexture->GetWidth(), pTexture->GetHeight(), placement);
+
+    // also update the Texture2D object to set correct 
+    // atlas pointers and offsets
+    OffsetStructure offset;
+    offset.uOffset = placement.region.mLeft;
+    offset.vOffset = placement.region.mTop;
+    offset.width   = placement.region.GetWidth();
+    offset.height  = placement.region.GetHeight();
+    offset.margin  = placement.margin;
+    offset.slice   = 0L;
+    offset.rotated = placement.rotated;
+    pTexture->SetAtlas(mpAtlas, offset);
+}
+
+//-----------------------------------------------------------------------------
+// Name: Place()
+// Desc: The layout part of Insert(): finds a free spot for a width x height
+//       texture (plus margin on the right and bottom) and marks it used, 
+//       w/o touching any texels.  Returns the spot in placed and whether
+//       the texture has to be stored transposed in rotated, or false if
+//       there is no room.
+//-----------------------------------------------------------------------------
+bool Packer2D::Place(long width, long height, LONG margin, Region &placed, bool &rotated)
+{
+    Placement placement;
+    if (! FindPlacement(width, height, margin, placement))
+        return false;
+
+    CommitPlacement(width, height, placement);
+    placed  = placement.region;
+    rotated = placement.rotated;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindPlacement()
+// Desc: Looks for a free spot for a width x height texture (plus margin on
+//       the right and bottom) w/o taking it.  Returns false if there is no
+//       room.  If rotation is allowed the spot for the transposed texture
+//       is looked up as well and the better of the two is returned.
+//       margin may be kAutoMargin, see GetMargin(); each orientation then
+//       gets the margin that fits it.
+//       Only CommitPlacement() may follow on this packer: Reserve() relies 
+//       on what the last FindRegion() call found.
+//-----------------------------------------------------------------------------
+bool Packer2D::FindPlacement(long width, long height, LONG margin, Placement &placement)
 {
     // check for trivial non-fit
-    if (pTexture->GetNumTexels() > mTotalFreeTexels)
+    if (width * height > mTotalFreeTexels)
         return false;
 
+    // a square texture fits the same either way
+    bool const kTryRotated    = mbAllowRotation && (width != height);
+    LONG const kMargin        = GetMargin(width, height, margin);
+    LONG const kRotatedMargin = GetMargin(height, width, margin);
+
+    // the same either way: it only depends on the shorter side
+    long const kAlignment     = GetMipAlignment(width, height);
+    bool const kMissed        = IsKnownMiss(width + kMargin, height + kMargin, kAlignment);
+    bool const kRotatedMissed = (! kTryRotated) || IsKnownMiss(height + kRotatedMargin, width + kRotatedMargin, kAlignment);
+    if (kMissed && kRotatedMissed)
+    {
+        ++mNumKnownMisses;
+        return false;
+    }
+
     // find a free spot for this texture
-    Region *pTest = new Region();
+    Region  found;
+    bool    bFound   = (! kMissed) && FindRegion(width, height, kMargin, found);
+    bool    bRotated = false;
+
+    if (! kRotatedMissed)
+    {
+        Region rotatedRegion;
+        if (   FindRegion(height, width, kRotatedMargin, rotatedRegion)
+            && ((! bFound) || IsBetterPlacement(rotatedRegion, found)))
+        {
+            found    = rotatedRegion;
+            bFound   = true;
+            bRotated = true;
+        }
+        else if (bFound)
+        {
+            // Reserve() relies on what the last FindRegion() call found:
+            // look up the unrotated spot again
+            FindRegion(width, height, kMargin, found);
+        }
+    }
+
+    if (! bFound)
+    {
+        AddMiss(width + kMargin, height + kMargin, kAlignment);
+        if (kTryRotated)
+            AddMiss(height + kRotatedMargin, width + kRotatedMargin, kAlignment);
+        return false;
+    }
+
+    long const kRight  = (std::max)(mUsedRight,  found.mRight);
+    long const kBottom = (std::max)(mUsedBottom, found.mBottom);
+
+    placement.region     = found;
+    placement.margin     = bRotated ? kRotatedMargin : kMargin;
+    placement.rotated    = bRotated;
+    placement.growth     =   static_cast<long long>(kRight) * kBottom 
+                           - static_cast<long long>(mUsedRight) * mUsedBottom;
+    placement.freeTexels = mTotalFreeTexels;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: CommitPlacement()
+// Desc: Marks the spot the last FindPlacement() call found as used
+//-----------------------------------------------------------------------------
+void Packer2D::CommitPlacement(long width, long height, Placement const &placement)
+{
+    Reserve(placement.region);
+
+    mTotalFreeTexels -= width * height;
+    assert(mTotalFreeTexels >= 0);
+
+    if (placement.rotated)
+        ++mNumRotated;
+
+    mUsedRight  = (std::max)(mUsedRight,  placement.region.mRight);
+    mUsedBottom = (std::max)(mUsedBottom, placement.region.mBottom);
+
+    // merge this region into the used region's vector
+    // (last: merging may grow it)
+    Merge(new Region(placement.region));
+    ++mNumInserted;
+}
+
+//-----------------------------------------------------------------------------
+// Name: IsBetterFit()
+// Desc: returns true if candidate is a better spot than current, where the
+//       two may be in different atlases: the one that grows the used area
+//       the least wins, then the one in the fuller atlas.  Textures thus go
+//       into holes first, and nearly empty atlases keep their room.
+//-----------------------------------------------------------------------------
+bool Packer2D::IsBetterFit(Placement const &candidate, Placement const &current)
+{
+    if (candidate.growth != current.growth)
+        return candidate.growth < current.growth;
+    return candidate.freeTexels < current.freeTexels;
+}
+
+//-----------------------------------------------------------------------------
+// Name: IsKnownMiss()
+// Desc: returns true if a search for a size no larger in either direction,
+//       at an alignment no coarser, failed before, so one for width x height
+//       at alignment has to fail as well: the alignments are powers of 2, so
+//       a spot for the latter would have done for the former.
+//       Only packers that find a spot whenever there is one can tell; the
+//       grid scan may miss a larger texture's spot but find a smaller one's.
+//-----------------------------------------------------------------------------
+bool Packer2D::IsKnownMiss(long width, long height, long alignment) const
+{
+    std::vector<Size>::const_iterator iterMiss;
+    for (iterMiss = mMissedSizes.begin(); iterMiss != mMissedSizes.end(); ++iterMiss)
+        if (   (width >= iterMiss->width) && (height >= iterMiss->height)
+            && (alignment >= iterMiss->alignment))
+            return true;
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name: AddMiss()
+// Desc: Remembers that there is no room for width x height at alignment,
+//       and forgets the larger sizes that this makes redundant
+//-----------------------------------------------------------------------------
+void Packer2D::AddMiss(long width, long height, long alignment)
+{
+    if (! HasMonotonicFit() || IsKnownMiss(width, height, alignment))
+        return;
+
+    size_t i = 0;
+    while (i < mMissedSizes.size())
+    {
+        if (   (mMissedSizes[i].width >= width) && (mMissedSizes[i].height >= height)
+            && (mMissedSizes[i].alignment >= alignment))
+        {
+            mMissedSizes[i] = mMissedSizes.back();
+            mMissedSizes.pop_back();
+        }
+        else
+            ++i;
+    }
+
+    Size miss;
+    miss.width     = width;
+    miss.height    = height;
+    miss.alignment = alignment;
+    mMissedSizes.push_back(miss);
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetShrunkSize()
+// Desc: Halves the passed in atlas size horizontally, then vertically, for 
+//       as long as the half that is cut off holds no used region.
+//-----------------------------------------------------------------------------
+void Packer2D::GetShrunkSize(long &width, long &height) const
+{
+    Region  tester;
+
+    // horizontal shrink first:
+    // Can we get rid of the right half of the atlas?
+    tester.mTop     = 0L;
+    tester.mBottom  = height;
+    bool bShrinking = true;
+    while (bShrinking && (width > 1))
+    {
+        tester.mLeft   = width/2L;
+        tester.mRight  = width;
+
+        if (! Intersects(tester, true))
+            width      = width/2L;
+        else
+            bShrinking = false;
+    }
+
+    // do the same vertically
+    tester.mLeft  = 0L;
+    tester.mRight = width;
+    bShrinking    = true;
+    while (bShrinking && (height > 1))
+    {
+        tester.mTop    = height/2L;
+        tester.mBottom = height;
+
+        if (! Intersects(tester, true))
+            height     = height/2L;
+        else
+            bShrinking = false;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: IsBetterPlacement()
+// Desc: returns true if candidate is a better spot than current: the one 
+//       whose bottom edge is higher up in the atlas wins, then the one whose 
+//       right edge is further left.  Keeping the packed area compact leaves
+//       the largest free space for the following textures.
+//-----------------------------------------------------------------------------
+bool Packer2D::IsBetterPlacement(Region const &candidate, Region const &current) const
+{
+    if (candidate.mBottom != current.mBottom)
+        return candidate.mBottom < current.mBottom;
+    return candidate.mRight < current.mRight;
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindRegion()
+// Desc: Grid scan for a free spot for a width x height texture (plus margin 
+//       on the right and bottom).  If one is found it is returned in region
+//       and true is returned.
+//       The grid steps are the texture's size rounded up to its alignment.
+//-----------------------------------------------------------------------------
+bool Packer2D::FindRegion(long width, long height, LONG margin, Region &region)
+{
+    long const kAlignment = GetMipAlignment(width, height);
+    long const kStepU     = AlignUp(width,  kAlignment);
+    long const kStepV     = AlignUp(height, kAlignment);
 
     long u, v;
     // *** Optimization ***
@@ -247,140 +549,426 @@ bool Packer2D::Insert(Texture2D *pTexture, LONG margin)
     // 'square' atlases; or even better insert in such a way as
     // to minimize the total number of used regions, i.e., 
     // always try to attach to one or more edges of existing regions.
+    // (See PackerMaxRects, -packer maxrects)
     //
     
     // loop in v: slide test-region vertically across atlas
-    for (v = 0; (v+1)*pTexture->GetHeight() + margin <= mpAtlas->GetHeight(); ++v)
+    for (v = 0; v*kStepV + height + margin <= mDesc.height; ++v)
     {
-        pTest->mTop    = v     * pTexture->GetHeight();
-        pTest->mBottom = (v+1) * pTexture->GetHeight() + margin;
+        region.mTop    = v * kStepV;
+        region.mBottom = v * kStepV + height + margin;
 
         // loop in u: slide test-region horizontally across atlas 
         // margin
-        for (u = 0; (u+1)*pTexture->GetWidth() + margin <= mpAtlas->GetWidth(); ++u)
+        for (u = 0; u*kStepU + width + margin <= mDesc.width; ++u)
         {
-            pTest->mLeft  = u     * pTexture->GetWidth();
-            pTest->mRight = (u+1) * pTexture->GetWidth() + margin;
+            region.mLeft  = u * kStepU;
+            region.mRight = u * kStepU + width + margin;
 
             // go through all Used regions and see if they overlap
-            Region const *pIntersection = Intersects(*pTest);
+            Region const *pIntersection = Intersects(region);
             if (pIntersection != nullptr)
             {
                 // found an intersecting used region: try next position
-                // but actually advance position by the larger of pTexture's width
-                // and this intersection
-                float ratio =   static_cast<float>(pIntersection->mRight)
-                              / static_cast<float>(pTest->mRight);
-                ratio = ceilf(max(0.0f, ratio-1.0f));  
-                u += static_cast<long>(ratio);
+                // but actually advance position past this intersection: all 
+                // positions that start left of its right edge overlap it too
+                u = (pIntersection->mRight + kStepU - 1) / kStepU - 1;
             }
             else
             {
-                // no intersection found: 
-                // merge this region into the used region's vector
-                Merge(pTest);
-
-                mTotalFreeTexels -= pTexture->GetNumTexels();
-                assert(mTotalFreeTexels >= 0);
-
-                CopyBits(*pTest, pTexture->GetD3DTexture(), margin);
-
-                // also update the Texture2D object to set correct 
-                // atlas pointers and offsets
-                OffsetStructure offset;
-                offset.uOffset = pTest->mLeft;
-                offset.vOffset = pTest->mTop;
-                offset.width   = pTest->GetWidth();
-                offset.height  = pTest->GetHeight();
-                offset.slice   = 0L;
-                pTexture->SetAtlas(mpAtlas, offset);
-
+                // no intersection found
                 return true;
             }
         }
     }
-    // could not insert: free allocated region and return failure
-    delete pTest;
     return false;
 }
 
+//-----------------------------------------------------------------------------
+// Name: Reserve()
+// Desc: Called w/ the region returned by FindRegion() right before it is 
+//       added to the used regions.  The grid scan only looks at the used 
+//       regions, so there is nothing else to keep track of.
+//-----------------------------------------------------------------------------
+void Packer2D::Reserve(Region const & /*region*/)
+{
+    ;
+}
+
+//-----------------------------------------------------------------------------
+// Name: HasMonotonicFit()
+// Desc: returns true if a texture is sure to fit wherever a larger one would.
+//       The grid scan only tries multiples of the texture's own size, so a 
+//       smaller texture may find no spot where a larger one had one.
+//-----------------------------------------------------------------------------
+bool Packer2D::HasMonotonicFit() const
+{
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetAlignment()
+// Desc: returns the granularity (in texels) regions have to be placed at:
+//       DXTn atlases can only be written in whole 4x4 blocks.
+//-----------------------------------------------------------------------------
+long Packer2D::GetAlignment() const
+{
+    return IsDXTnFormat(mDesc.format) ? 4L : 1L;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetMipAlignment()
+// Desc: returns the granularity (in texels) a width x height texture has to
+//       be placed at.  CopyBits() puts mip-level l of a texture at its offset
+//       divided by 2^l, so the offset has to be a multiple of 2^l, or 4*2^l
+//       in DXTn atlases, for the level to start on a texel (block) boundary
+//       and to not be cut short or overlap its neighbors'.  That is asked of
+//       every level on which the texture still covers a whole texel (block)
+//       both ways: the alignment is the largest power of 2 that is no larger
+//       than the shorter side.  W/o mip-maps it is just GetAlignment().
+//-----------------------------------------------------------------------------
+long Packer2D::GetMipAlignment(long width, long height) const
+{
+    long alignment = GetAlignment();
+    if (! mDesc.mipMaps)
+        return alignment;
+
+    long const kShorterSide = (std::min)(width, height);
+    while (alignment * 2 <= kShorterSide)
+        alignment *= 2;
+    return alignment;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetMargin()
+// Desc: returns the margin a width x height texture gets w/ the passed in
+//       one: kAutoMargin (-margin auto) is GetMipAlignment(), which leaves a
+//       texel (block) between the texture and its right and bottom 
+//       neighbors on every level it is aligned for.  No neighbor can sit
+//       past the edge of the atlas, so it is cut down to the room the atlas
+//       leaves: a texture as wide or high as the atlas still fits.  That
+//       room depends on the orientation, so pass a rotated texture's size
+//       swapped.  Any other margin is taken as is.
+//-----------------------------------------------------------------------------
+LONG Packer2D::GetMargin(long width, long height, LONG margin) const
+{
+    if (margin == kAutoMargin)
+    {
+        long const kRoom = (std::min)(mDesc.width - width, mDesc.height - height);
+        return (std::max)(0L, (std::min)(GetMipAlignment(width, height), kRoom));
+    }
+    return margin;
+}
+
+//-----------------------------------------------------------------------------
+// Name: AlignUp()
+// Desc: rounds size up to the next multiple of GetAlignment()
+//-----------------------------------------------------------------------------
+long Packer2D::AlignUp(long size) const
+{
+    return AlignUp(size, GetAlignment());
+}
+
+//-----------------------------------------------------------------------------
+// Name: AlignUp()
+// Desc: rounds size (or a position) up to the next multiple of alignment
+//-----------------------------------------------------------------------------
+long Packer2D::AlignUp(long size, long alignment)
+{
+    return ((size + alignment - 1) / alignment) * alignment;
+}
+
 //-----------------------------------------------------------------------------
 // Name: CopyBits()
 // Desc: copy the contents of all mip-maps of the passed in texture into 
 //       the mpAtlas bits at the offsets indicated by target region.
+//       If transpose is set, texel (x, y) of each mip-map goes to (y, x) of 
+//       the target region, whose width and height are thus those of the 
+//       texture swapped.
 //-----------------------------------------------------------------------------
-void Packer2D::CopyBits(Region const &target, IDirect3DTexture9 *pTexture, LONG margin)
+void Packer2D::CopyBits(Region const &target, ImageBuffer const &source, LONG margin, bool transpose)
 {
-    HRESULT         hr;
-    RECT            srcRect,       dstRect;
-    D3DLOCKED_RECT  srcLockedRect, dstLockedRect;
-
-    srcRect.left = srcRect.top = 0;
+    assert(mpAtlas != nullptr);
+    ImageBuffer const &atlas = mpAtlas->GetImage();
 
     // If -nomipmap was set then mpAtlas only has one mip-map and kNumMipMaps is 1.
     // If it wasn't then mpAtlas has more mip-maps then the texture and kNumMipMaps
-    // is the same as there are mip-maps in pTexture.
-    int const kNumMipMaps = min(mpAtlas->GetD3DTexture()->GetLevelCount(), pTexture->GetLevelCount());
+    // is the same as there are mip-maps in the source.
+    int const kNumMipMaps = (std::min)(atlas.GetLevelCount(), source.GetLevelCount());
     if (kNumMipMaps > mMaxNumberMipLevels)
         mMaxNumberMipLevels = kNumMipMaps;
-    for (long mipLevel = 0; mipLevel < kNumMipMaps; ++mipLevel)
+
+    for (int mipLevel = 0; mipLevel < kNumMipMaps; ++mipLevel)
+        CopyBits(target, source, margin, transpose, mipLevel, 0, atlas.GetNumRows(mipLevel));
+}
+
+//-----------------------------------------------------------------------------
+// Name: CopyBits()
+// Desc: The part of the above that lands in the rows firstRow up to (not 
+//       including) endRow of the atlas' mipLevel, in units (texels or 4x4 
+//       blocks).  Copies into disjoint bands of rows can run concurrently:
+//       nothing but those rows of the atlas is written.
+//-----------------------------------------------------------------------------
+void Packer2D::CopyBits(Region const &target, ImageBuffer const &source, LONG margin, bool transpose,
+                        int mipLevel, long firstRow, long endRow) const
+{
+    assert(mpAtlas != nullptr);
+    ImageBuffer &atlas = mpAtlas->GetImage();
+
+    if ((mipLevel >= atlas.GetLevelCount()) || (mipLevel >= source.GetLevelCount()))
+        return;
+
+    // DXTn data is addressed in whole 4x4 blocks: a "unit" is either a texel 
+    // or a block, and rows of the image buffers are rows of such units.
+    int const kBlockFactor  = (IsDXTnFormat(atlas.GetFormat()) ? 4 : 1);
+    int const kBytesPerUnit = (kBlockFactor * kBlockFactor * SizeOfTexel(atlas.GetFormat()))/8;
+
+    long const div        = 1L << mipLevel;
+    long const mipWidth   = (std::max)(1L, (target.GetWidth() - margin) / div);
+    long const mipHeight  = (std::max)(1L, (target.GetHeight() - margin) / div);
+
+    long const dstColumn  = (target.mLeft/div) / kBlockFactor;
+    long const dstRow     = (target.mTop /div) / kBlockFactor;
+
+    // clamp to what both surfaces actually have at this level
+    // (transposed: the rows of the target are the columns of the source)
+    long const kSourceColumns = source.GetRowBytes(mipLevel) / kBytesPerUnit;
+    long const kSourceRows    = source.GetNumRows(mipLevel);
+    long const kColumns   = (std::min)((mipWidth  + kBlockFactor - 1) / kBlockFactor,
+                                       (std::min)(transpose ? kSourceRows : kSourceColumns,
+                                                  atlas.GetRowBytes(mipLevel) / kBytesPerUnit - dstColumn));
+    long const kRows      = (std::min)((mipHeight + kBlockFactor - 1) / kBlockFactor,
+                                       (std::min)(transpose ? kSourceColumns : kSourceRows,
+                                                  atlas.GetNumRows(mipLevel) - dstRow));
+
+    // the rows of the target region inside the band
+    long const kFirstRow  = (std::max)(0L, firstRow - dstRow);
+    long const kEndRow    = (std::min)(kRows, endRow - dstRow);
+    if (kFirstRow >= kEndRow)
+        return;
+
+    if (transpose)
+    {
+        CopyTransposed(atlas, mipLevel, dstColumn, dstRow, source, kColumns, kFirstRow, kEndRow);
+        return;
+    }
+
+    for (long row = kFirstRow; row < kEndRow; ++row)
+    {
+        memcpy( atlas.GetRow(mipLevel, dstRow + row) + dstColumn * kBytesPerUnit, 
+                source.GetRow(mipLevel, row), 
+                kColumns * kBytesPerUnit );
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: CopyTransposed()
+// Desc: Writes the transpose of the source's mip-map level into the atlas
+//       level at dstColumn, dstRow, but only the target rows firstRow up to
+//       endRow (the source's columns) and the first columns target columns
+//       (the source's rows).
+//       Walking a whole source column per target row would touch a
+//       different source row for every unit, so the copy goes tile by tile:
+//       the source rows of one tile stay in the cache while it is written.
+//       DXTn blocks are transposed as a whole, see TransposeBlock().
+//-----------------------------------------------------------------------------
+void Packer2D::CopyTransposed(ImageBuffer &atlas, int mipLevel, long dstColumn, long dstRow,
+                              ImageBuffer const &source, long columns, long firstRow, long endRow) const
+{
+    D3DFORMAT const kFormat       = atlas.GetFormat();
+    bool const      kIsDXTn       = IsDXTnFormat(kFormat);
+    int const       kBlockFactor  = (kIsDXTn ? 4 : 1);
+    int const       kBytesPerUnit = (kBlockFactor * kBlockFactor * SizeOfTexel(kFormat))/8;
+
+    for (long tileRow = firstRow; tileRow < endRow; tileRow += kTransposeTileSize)
+        for (long tileColumn = 0; tileColumn < columns; tileColumn += kTransposeTileSize)
+        {
+            long const kRowEnd    = (std::min)(endRow,  tileRow    + kTransposeTileSize);
+            long const kColumnEnd = (std::min)(columns, tileColumn + kTransposeTileSize);
+
+            for (long row = tileRow; row < kRowEnd; ++row)
+            {
+                UCHAR *pDst = atlas.GetRow(mipLevel, dstRow + row) + (dstColumn + tileColumn) * kBytesPerUnit;
+                for (long column = tileColumn; column < kColumnEnd; ++column, pDst += kBytesPerUnit)
+                {
+                    UCHAR const *pSrc = source.GetRow(mipLevel, column) + row * kBytesPerUnit;
+                    if (kIsDXTn)
+                        TransposeBlock(kFormat, pSrc, pDst);
+                    else
+                        memcpy(pDst, pSrc, kBytesPerUnit);
+                }
+            }
+        }
+}
+
+//-----------------------------------------------------------------------------
+// Name: TransposeBlock()
+// Desc: Writes the transpose of a 4x4 DXTn (ATI1/ATI2) block to pDst.  The
+//       end-point colors (alphas) stay as they are, only the per-texel
+//       indices move: index (x, y) is stored at position 4*y + x of each 
+//       index field.
+//-----------------------------------------------------------------------------
+void Packer2D::TransposeBlock(D3DFORMAT format, UCHAR const *pSrc, UCHAR *pDst)
+{
+    // ATI1/ATI2: one or two DXT5 style alpha blocks, and no color part
+    if ((format == D3DFMT_ATI1) || (format == D3DFMT_ATI2))
     {
-        long const div        = static_cast<long>(pow(2L, mipLevel));
-        long const mipWidth   = max(1L, (target.GetWidth() - margin) / div);
-        long const mipHeight  = max(1L, (target.GetHeight() - margin) / div);
-
-        srcRect.right  = mipWidth;
-        srcRect.bottom = mipHeight;
-
-        dstRect.left   = max(0L, target.mLeft/div);
-        dstRect.top    = max(0L, target.mTop /div);
-        dstRect.right  = dstRect.left + mipWidth;
-        dstRect.bottom = dstRect.top  + mipHeight;
-
-        // These calls to LockRect fail (generate errors:
-        // Direct3D9: (ERROR) :Rects for DXT surfaces must be on 4x4 boundaries) 
-        // in the 2003 Summer SDK Debug Runtime.  They work just fine 
-        // (and as expected) when using the retail run-time: 
-        // please make sure to use the retail run-time when running this!
-        hr = pTexture->LockRect( mipLevel, &srcLockedRect, &srcRect, D3DLOCK_READONLY );
-        assert(hr == S_OK);
-        hr = mpAtlas->GetD3DTexture()->LockRect( mipLevel, &dstLockedRect, &dstRect, 0 );
-        assert(hr == S_OK);
-
-	    int const kBytesPerRow = (mipWidth * SizeOfTexel(mpAtlas->GetFormat()))/8;
-	    int const kBlockFactor = (IsDXTnFormat(mpAtlas->GetFormat()) ? 4 : 1);
-        UCHAR *srcPtr = reinterpret_cast<UCHAR*>(srcLockedRect.pBits);
-        UCHAR *dstPtr = reinterpret_cast<UCHAR*>(dstLockedRect.pBits);
-
-        for (int i = 0; i < mipHeight/kBlockFactor; ++i)
+        for (int offset = 0; offset < ((format == D3DFMT_ATI1) ? 8 : 16); offset += 8)
         {
-            memcpy( dstPtr, srcPtr, kBlockFactor * kBytesPerRow );
-            srcPtr += srcLockedRect.Pitch;
-            dstPtr += dstLockedRect.Pitch;
+            pDst[offset]     = pSrc[offset];
+            pDst[offset + 1] = pSrc[offset + 1];
+            StoreBits(pDst + offset + 2, 6, TransposeIndices(LoadBits(pSrc + offset + 2, 6), 3));
         }
+        return;
+    }
+
+    // the color part is the last 8 bytes of every DXTn block: two 16 bit 
+    // end-points followed by 2 bit indices
+    int const kColorOffset = (format == D3DFMT_DXT1) ? 0 : 8;
 
-        hr = pTexture->UnlockRect( mipLevel );
-        assert(hr == S_OK);
-        hr = mpAtlas->GetD3DTexture()->UnlockRect( mipLevel );
-        assert(hr == S_OK);
+    switch (format)
+    {
+        case D3DFMT_DXT2:
+        case D3DFMT_DXT3:
+            // 4 bit explicit alphas
+            StoreBits(pDst, 8, TransposeIndices(LoadBits(pSrc, 8), 4));
+            break;
+        case D3DFMT_DXT4:
+        case D3DFMT_DXT5:
+            // two 8 bit alpha end-points followed by 3 bit indices
+            pDst[0] = pSrc[0];
+            pDst[1] = pSrc[1];
+            StoreBits(pDst + 2, 6, TransposeIndices(LoadBits(pSrc + 2, 6), 3));
+            break;
+        default:
+            break;
     }
+
+    memcpy(pDst + kColorOffset, pSrc + kColorOffset, 4);
+    StoreBits(pDst + kColorOffset + 4, 4, TransposeIndices(LoadBits(pSrc + kColorOffset + 4, 4), 2));
+}
+
+//-----------------------------------------------------------------------------
+// Name: TransposeIndices()
+// Desc: Transposes the 4x4 field of bitsPerIndex wide indices packed into
+//       the low bits of indices
+//-----------------------------------------------------------------------------
+uint64_t Packer2D::TransposeIndices(uint64_t indices, int bitsPerIndex)
+{
+    uint64_t const kMask  = (uint64_t(1) << bitsPerIndex) - 1;
+    uint64_t       result = 0;
+
+    for (int y = 0; y < 4; ++y)
+        for (int x = 0; x < 4; ++x)
+        {
+            uint64_t const kIndex = (indices >> ((4*x + y) * bitsPerIndex)) & kMask;
+            result |= kIndex << ((4*y + x) * bitsPerIndex);
+        }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Name: LoadBits()
+// Desc: Reads numBytes (at most 8) little endian bytes
+//-----------------------------------------------------------------------------
+uint64_t Packer2D::LoadBits(UCHAR const *pSrc, int numBytes)
+{
+    uint64_t bits = 0;
+    for (int i = numBytes-1; i >= 0; --i)
+        bits = (bits << 8) | pSrc[i];
+    return bits;
+}
+
+//-----------------------------------------------------------------------------
+// Name: StoreBits()
+// Desc: Writes the low numBytes (at most 8) bytes of bits little endian
+//-----------------------------------------------------------------------------
+void Packer2D::StoreBits(UCHAR *pDst, int numBytes, uint64_t bits)
+{
+    for (int i = 0; i < numBytes; ++i, bits >>= 8)
+        pDst[i] = static_cast<UCHAR>(bits & 0xff);
 }
 
 //-----------------------------------------------------------------------------
 // Name: Merge()
-// Desc: *** Optimization ***
-//       Ideally here we should try to merge used region into 
-//       fewer and larger regions, ie can the new region combine 
-//       with any existing one, if yes, merge them and repeat
-//       until no more merges occur.
+// Desc: Adds the new region to the used regions, merging used regions into 
+//       fewer and larger regions: if the new region combines w/ an existing
+//       one into a rectangle, the existing one is removed and the new one
+//       grown; this repeats until no more merges occur.
+//       Fewer regions means fewer intersection tests per probe.
 //-----------------------------------------------------------------------------
 void Packer2D::Merge(Region * pNewRegion) 
 {
-    mUsedRegions.push_back(pNewRegion);
     // since we have the 'advance more than 1 step in u if possible' optimization
     // it makes sense to favor wider over higher regions.
     // so try to merge horizontally before trying to merge vertically.
-    ;
+    bool bMerged = true;
+    while (bMerged)
+    {
+        bMerged = MergeNeighbor(pNewRegion, true);
+        if (! bMerged)
+            bMerged = MergeNeighbor(pNewRegion, false);
+    }
+
+    mUsedRegions.push_back(pNewRegion);
+    mUsedRegionGrid.Insert(pNewRegion);
+}
+
+//-----------------------------------------------------------------------------
+// Name: MergeNeighbor()
+// Desc: Looks for a used region that shares a complete vertical (horizontal
+//       merge) or horizontal (vertical merge) edge w/ the passed in region.
+//       If there is one, the passed in region is grown to cover both, the 
+//       other one is deleted and true is returned.
+//-----------------------------------------------------------------------------
+bool Packer2D::MergeNeighbor(Region * pRegion, bool horizontal)
+{
+    // only regions in a one texel wide border around pRegion can touch it
+    Region area = *pRegion;
+    if (horizontal)
+    {
+        --area.mLeft;
+        ++area.mRight;
+    }
+    else
+    {
+        --area.mTop;
+        ++area.mBottom;
+    }
+
+    std::vector<Region const *> candidates;
+    mUsedRegionGrid.GetCandidates(area, candidates);
+
+    std::vector<Region const *>::const_iterator iterCandidate;
+    for (iterCandidate = candidates.begin(); iterCandidate != candidates.end(); ++iterCandidate)
+    {
+        Region const &other = **iterCandidate;
+        bool const bMergeable = horizontal 
+                                    ?    (other.mTop == pRegion->mTop) && (other.mBottom == pRegion->mBottom)
+                                      && ((other.mRight == pRegion->mLeft) || (other.mLeft == pRegion->mRight))
+                                    :    (other.mLeft == pRegion->mLeft) && (other.mRight == pRegion->mRight)
+                                      && ((other.mBottom == pRegion->mTop) || (other.mTop == pRegion->mBottom));
+        if (! bMergeable)
+            continue;
+
+        pRegion->mLeft   = (std::min)(pRegion->mLeft,   other.mLeft);
+        pRegion->mRight  = (std::max)(pRegion->mRight,  other.mRight);
+        pRegion->mTop    = (std::min)(pRegion->mTop,    other.mTop);
+        pRegion->mBottom = (std::max)(pRegion->mBottom, other.mBottom);
+
+        // remove the other region: search from the back, the most recently
+        // added regions are the most likely neighbors
+        mUsedRegionGrid.Remove(&other);
+        std::vector<Region *>::reverse_iterator iterUsed = std::find(mUsedRegions.rbegin(), mUsedRegions.rend(), &other);
+        assert(iterUsed != mUsedRegions.rend());
+        delete *iterUsed;
+        *iterUsed = mUsedRegions.back();
+        mUsedRegions.pop_back();
+
+        ++mNumMerges;
+        return true;
+    }
+    return false;
 }
 
 //-----------------------------------------------------------------------------
@@ -388,20 +976,29 @@ void Packer2D::Merge(Region * pNewRegion)
 // Desc: returns nullptr if the passed in region does not intersect any stored 
 //       used regions.
 //       Returns a pointer to the intersecting region if it does intersect. 
+//       Only the used regions near the passed in region are tested (see
+//       RegionGrid), not all of them.
 //-----------------------------------------------------------------------------
 Region const * Packer2D::Intersects(Region const &region, bool shrinkTest) const
 {
-    // go through all Used regions and see if they overlap
-    std::vector<Region *>::const_iterator iterUsed;
-    for (iterUsed = mUsedRegions.begin(); iterUsed != mUsedRegions.end(); ++iterUsed)
-        if ((*iterUsed)->Intersect(region, shrinkTest))
-        {
-            // found an intersecting used region: return the result
-            return *iterUsed;
-        }
+    ++mNumProbes;
+    return mUsedRegionGrid.Intersects(region, shrinkTest);
+}
 
-    // made it through w/o finding intersection: return nullptr;
-    return nullptr;
+//-----------------------------------------------------------------------------
+// Name: PrintStatistics()
+// Desc: Prints how many textures went into the atlas, how many used regions
+//       are left after merging them (w/o merging there would be one per 
+//       texture) and how many intersection probes it took.
+//-----------------------------------------------------------------------------
+void Packer2D::PrintStatistics(char const *pAtlasName) const
+{
+    fprintf( stderr, "Atlas %s: %d textures, %d used regions after %d merges, %ld intersection probes\n",
+             pAtlasName, mNumInserted, static_cast<int>(mUsedRegions.size()), mNumMerges, mNumProbes );
+    if (mbAllowRotation)
+        fprintf( stderr, "Atlas %s: %d textures rotated\n", pAtlasName, mNumRotated );
+    if (mNumKnownMisses > 0)
+        fprintf( stderr, "Atlas %s: %d textures turned down by earlier misses\n", pAtlasName, mNumKnownMisses );
 }
 
 //-----------------------------------------------------------------------------
@@ -439,7 +1036,7 @@ bool PackerVolume::Insert(Texture2D *pTexture, LONG /*margin*/)
     if (mSlicesUsed >= mpAtlas->GetDepth())
         return false;
 
-    CopyBits(pTexture->GetD3DTexture());
+    CopyBits(pTexture->GetImage());
 
     // also update the Texture2D object to set correct 
     // atlas pointers and offsets
@@ -448,7 +1045,9 @@ bool PackerVolume::Insert(Texture2D *pTexture, LONG /*margin*/)
     offset.vOffset = 0;
     offset.width   = pTexture->GetWidth();
     offset.height  = pTexture->GetHeight();
+    offset.margin  = 0L;
     offset.slice   = mSlicesUsed;
+    offset.rotated = false;
     pTexture->SetAtlas(mpAtlas, offset);
 
     ++mSlicesUsed;
@@ -460,70 +1059,41 @@ bool PackerVolume::Insert(Texture2D *pTexture, LONG /*margin*/)
 // Desc: Copy the bits of the passed in texture the indicated slice of the 
 //       volume texture;
 //-----------------------------------------------------------------------------
-void PackerVolume::CopyBits(IDirect3DTexture9 *pTexture)
+void PackerVolume::CopyBits(ImageBuffer const &texture)
 {
-    D3DLOCKED_RECT  srcLockedRect;
-    HRESULT hr = pTexture->LockRect( 0, &srcLockedRect, nullptr, D3DLOCK_READONLY );
-    assert(hr == S_OK);
-
-    D3DLOCKED_BOX   dstLockedBox;
-    hr = mpAtlas->GetD3DTexture()->LockBox(0, &dstLockedBox, nullptr, D3DLOCK_DISCARD);
-    assert(hr == S_OK);
-
-	int const kBytesPerRow = (mpAtlas->GetWidth() * SizeOfTexel(mpAtlas->GetFormat()))/8;
-	int const kBlockFactor = (IsDXTnFormat(mpAtlas->GetFormat()) ? 4 : 1);
-    UCHAR *srcPtr = reinterpret_cast<UCHAR*>(srcLockedRect.pBits);
-    UCHAR *dstPtr = reinterpret_cast<UCHAR*>(dstLockedBox.pBits);
+    ImageBuffer &volume = mpAtlas->GetImage();
 
-    dstPtr += (mSlicesUsed * dstLockedBox.SlicePitch);
+    // Format, width, and height of the texture and a volume slice are the same
+    assert(texture.GetRowBytes(0) == volume.GetRowBytes(0));
+    assert(texture.GetNumRows(0)  == volume.GetNumRows(0));
 
-    for (int i = 0; i < mpAtlas->GetHeight()/kBlockFactor; ++i)
+    for (long row = 0; row < volume.GetNumRows(0); ++row)
     {
-        memcpy( dstPtr, srcPtr, kBlockFactor * kBytesPerRow );
-        srcPtr += srcLockedRect.Pitch;
-        dstPtr += dstLockedBox.RowPitch;
+        memcpy( volume.GetRow(0, row, mSlicesUsed), texture.GetRow(0, row), volume.GetRowBytes(0) );
     }
-
-    hr = pTexture->UnlockRect( 0 );
-    assert(hr == S_OK);
-    hr = mpAtlas->GetD3DTexture()->UnlockBox( 0 );
-    assert(hr == S_OK);
 }
 
 //-----------------------------------------------------------------------------
-// Name: CopyBits()
+// Name: CopyVolumeBits()
 // Desc: Copy the bits of the passed in volume texture into the 
 //       volume texture;
 //-----------------------------------------------------------------------------
-void PackerVolume::CopyBits(IDirect3DVolumeTexture9 *pVolumeTexture)
+void PackerVolume::CopyVolumeBits(ImageBuffer const &volume)
 {
-    D3DLOCKED_BOX   srcLockedBox;
-    HRESULT hr = pVolumeTexture->LockBox(0, &srcLockedBox, nullptr, D3DLOCK_READONLY);
-    assert(hr == S_OK);
-
-    D3DLOCKED_BOX   dstLockedBox;
-    hr = mpAtlas->GetD3DTexture()->LockBox(0, &dstLockedBox, nullptr, D3DLOCK_DISCARD);
-    assert(hr == S_OK);
-
-	int const kBytesPerSlice = (mpAtlas->GetWidth() * mpAtlas->GetHeight() * SizeOfTexel(mpAtlas->GetFormat()))/8;
-	int const kBlockFactor = (IsDXTnFormat(mpAtlas->GetFormat()) ? 4 : 1);
-    UCHAR *srcPtr = reinterpret_cast<UCHAR*>(srcLockedBox.pBits);
-    UCHAR *dstPtr = reinterpret_cast<UCHAR*>(dstLockedBox.pBits);
+    ImageBuffer &atlas = mpAtlas->GetImage();
 
     // Format, width, and height of these two volumes are assumed to be the same
     // between these two textures...
-    assert(srcLockedBox.RowPitch == dstLockedBox.RowPitch);
-    
-    for (int slice = 0; slice < mpAtlas->GetDepth(); ++slice)
+    assert(volume.GetRowBytes(0) == atlas.GetRowBytes(0));
+
+    long const kSlices = (std::min)(volume.GetDepth(), atlas.GetDepth());
+    for (long slice = 0; slice < kSlices; ++slice)
     {
-        memcpy( dstPtr, srcPtr, kBlockFactor * kBytesPerSlice );
-        srcPtr += srcLockedBox.SlicePitch;
-        dstPtr += dstLockedBox.SlicePitch;
+        for (long row = 0; row < atlas.GetNumRows(0); ++row)
+        {
+            memcpy( atlas.GetRow(0, row, slice), volume.GetRow(0, row, slice), atlas.GetRowBytes(0) );
+        }
     }
-    hr = pVolumeTexture->UnlockBox( 0 );
-    assert(hr == S_OK);
-    hr = mpAtlas->GetD3DTexture()->UnlockBox( 0 );
-    assert(hr == S_OK);
 }
 
 //-----------------------------------------------------------------------------
@@ -18,12 +18,11 @@
 #ifndef PACKER_H
 #define PACKER_H
 
-#include <d3dx9.h>
-//#include <d3d9.h>
-//#include <d3d9types.h>
-//#include "DX9SDKSampleFramework/d3dx9_compatibility.h"
+#include <stdint.h>
 
 #include "TATypes.h"
+#include "ImageBuffer.h"
+#include "RegionGrid.h"
 
 class CmdLineOptionCollection;
 class Texture2D;
@@ -57,6 +56,34 @@ public:
     long     mBottom;
 };
 
+//-----------------------------------------------------------------------------
+// Name: AtlasDesc
+// Desc: What a 2D packer needs to know about the atlas it fills
+//-----------------------------------------------------------------------------
+struct AtlasDesc
+{
+    long        width;
+    long        height;
+    D3DFORMAT   format;
+    bool        mipMaps;            // false w/ -nomipmap
+};
+
+//-----------------------------------------------------------------------------
+// Name: Placement
+// Desc: A spot Packer2D::FindPlacement() found for a texture, and what taking
+//       it costs: how many texels the bounding box of the atlas' used area
+//       grows by, and how many free texels the atlas has before.  Lets 
+//       AtlasContainer compare spots in different atlases (-bestfit).
+//-----------------------------------------------------------------------------
+struct Placement
+{
+    Region      region;
+    LONG        margin;             // part of region, see Packer2D::GetMargin()
+    bool        rotated;
+    long long   growth;
+    long        freeTexels;
+};
+
 //-----------------------------------------------------------------------------
 // Name: Packer
 // Desc: Pure virtual base class for Packer objects.  For example, a Packer2D
@@ -68,7 +95,7 @@ class Packer
 {
 public:
     Packer();
-    ~Packer();
+    virtual ~Packer();
 
     virtual bool Insert(Texture2D *pTexture, LONG margin) = 0;
 
@@ -87,24 +114,110 @@ protected:
 // Name: Packer2D
 // Desc: Derived class that knows how to deal with Atlas2D objects,
 //       specifically how to insert Texture2D objects into Atlas2D objects
+//       
+//       Packer2D itself places textures with a grid scan: a texture can only 
+//       land at multiples of its own size.  It is also the base class of the 
+//       other 2D packing algorithms (see Create()): these only override how
+//       a free spot is found (FindRegion) and how they keep track of the 
+//       space they handed out (Reserve).
+//       Insert() only lays the texture out; CopyBits() is called once the
+//       atlas has its final size.  Place() does the bookkeeping of Insert()
+//       w/o a texture, so packers created w/o an atlas can lay out textures
+//       on their sizes alone.
+//       Both first look for a spot (FindPlacement) and then take it 
+//       (CommitPlacement), so a caller can look at spots in several atlases
+//       before it picks one.  Sizes that did not fit are remembered, so the
+//       same or larger textures are turned down w/o a search.
+//       With -rotate Insert() also tries each texture turned by 90 degrees
+//       and keeps the orientation that fits better; a rotated texture is 
+//       stored transposed.
+//       In atlases w/ mip-maps every texture is placed at an offset its
+//       lower levels can start at exactly, see GetMipAlignment(); all
+//       packers only try such offsets.
 //-----------------------------------------------------------------------------
 class Packer2D : public Packer
 {
 public:
-    Packer2D(Atlas2D * pAtlas);
-    ~Packer2D();
+    Packer2D(AtlasDesc const &desc);
+    virtual ~Packer2D();
+
+    static Packer2D * Create(CmdLineOptionCollection const &options, Atlas2D * pAtlas, char const *pName = nullptr);
+    static Packer2D * Create(char const *pName, bool allowRotation, AtlasDesc const &desc);
+    static bool       IsValidPackerName(char const *pName);
 
     virtual bool Insert(Texture2D *pTexture, LONG margin);
+    bool         Place(long width, long height, LONG margin, Region &placed, bool &rotated);
+    bool         FindPlacement(long width, long height, LONG margin, Placement &placement);
+    void         CommitPlacement(long width, long height, Placement const &placement);
+    void         InsertAt(Texture2D *pTexture, Placement const &placement);
+    static bool  IsBetterFit(Placement const &candidate, Placement const &current);
+    void         GetShrunkSize(long &width, long &height) const;
 
     Region const * Intersects(Region const &region, bool shrinkTest = false) const;
-    void           CopyBits(Region const &test, IDirect3DTexture9 *pTexture, LONG margin);
+    void           CopyBits(Region const &target, ImageBuffer const &source, LONG margin, bool transpose = false);
+    void           CopyBits(Region const &target, ImageBuffer const &source, LONG margin, bool transpose,
+                            int mipLevel, long firstRow, long endRow) const;
+    void           PrintStatistics(char const *pAtlasName) const;
+
+protected:
+    virtual bool FindRegion(long width, long height, LONG margin, Region &region);
+    virtual void Reserve(Region const &region);
+    virtual bool HasMonotonicFit() const;
+
+    long         GetAlignment() const;
+    long         GetMipAlignment(long width, long height) const;
+    LONG         GetMargin(long width, long height, LONG margin) const;
+    long         AlignUp(long size) const;
+    static long  AlignUp(long size, long alignment);
 
 private:
+    enum
+    {
+        kTransposeTileSize = 16,            // units (texels or 4x4 blocks)
+    };
+
+    struct Size
+    {
+        long    width;
+        long    height;
+        long    alignment;
+    };
+
+    bool IsBetterPlacement(Region const &candidate, Region const &current) const;
+    bool IsKnownMiss(long width, long height, long alignment) const;
+    void AddMiss(long width, long height, long alignment);
+    void CopyTransposed(ImageBuffer &atlas, int mipLevel, long dstColumn, long dstRow,
+                        ImageBuffer const &source, long columns, long firstRow, long endRow) const;
+
+    static void     TransposeBlock(D3DFORMAT format, UCHAR const *pSrc, UCHAR *pDst);
+    static uint64_t TransposeIndices(uint64_t indices, int bitsPerIndex);
+    static uint64_t LoadBits(UCHAR const *pSrc, int numBytes);
+    static void     StoreBits(UCHAR *pDst, int numBytes, uint64_t bits);
+
     void Merge(Region * pNewRegion);
+    bool MergeNeighbor(Region * pRegion, bool horizontal);
 
-private:
-    Atlas2D *               mpAtlas;
+protected:
+    Atlas2D *               mpAtlas;                // nullptr for layout-only packers
+    AtlasDesc               mDesc;
     std::vector<Region *>   mUsedRegions;
+    RegionGrid              mUsedRegionGrid;        // spatial index over mUsedRegions
+
+    int                     mNumInserted;
+    int                     mNumMerges;
+    mutable long            mNumProbes;             // calls to Intersects()
+    int                     mNumRotated;
+    int                     mNumKnownMisses;        // searches skipped
+
+    bool                    mbAllowRotation;        // -rotate
+
+    // bounding box of the used area, and the smallest sizes (margin
+    // included) a search failed for: all sizes at least as large in both
+    // directions, and placed at least as coarsely, cannot fit either, since
+    // free space only ever gets less
+    long                    mUsedRight;
+    long                    mUsedBottom;
+    std::vector<Size>       mMissedSizes;
 
 };
 
@@ -120,8 +233,8 @@ public:
     ~PackerVolume();
 
     virtual bool Insert(Texture2D *pTexture, LONG margin);
-    void         CopyBits(IDirect3DTexture9       *pTexture);
-    void         CopyBits(IDirect3DVolumeTexture9 *pVolumeTexture);
+    void         CopyBits(ImageBuffer const &texture);
+    void         CopyVolumeBits(ImageBuffer const &volume);
     int          GetSlicesUsed() const;
 
 private:
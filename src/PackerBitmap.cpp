@@ -0,0 +1,93 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: PackerBitmap.cpp
+// Desc: Implementation of the occupancy bitmap 2D packer
+//-----------------------------------------------------------------------------
+
+#include <assert.h>
+
+#include <algorithm>
+
+#include "PackerBitmap.h"
+#include "TextureObject.h"
+
+//-----------------------------------------------------------------------------
+// Name: PackerBitmap()
+// Desc: Constructor: one bitmap cell per texel, or per 4x4 block in DXTn
+//       atlases, all of them free
+//-----------------------------------------------------------------------------
+PackerBitmap::PackerBitmap(AtlasDesc const &desc)
+    : Packer2D(desc)
+    , mCellSize(GetAlignment())
+    , mOccupancy((std::max)(1L, desc.width  / GetAlignment()),
+                 (std::max)(1L, desc.height / GetAlignment()))
+{
+    ;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ~PackerBitmap()
+// Desc: Destructor
+//-----------------------------------------------------------------------------
+PackerBitmap::~PackerBitmap()
+{
+    ;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ParseName()
+// Desc: returns true if pName is bitmap
+//-----------------------------------------------------------------------------
+bool PackerBitmap::ParseName(char const *pName)
+{
+    return (_strcmpi(pName, "bitmap") == 0);
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindRegion()
+// Desc: First fit search in the bitmap for the texture (plus margin on the 
+//       right and bottom), at cells the texture is aligned to (see
+//       GetMipAlignment()).  Returns false if there is no free spot.
+//-----------------------------------------------------------------------------
+bool PackerBitmap::FindRegion(long width, long height, LONG margin, Region &region)
+{
+    long const kColumns = AlignUp(width  + margin) / mCellSize;
+    long const kRows    = AlignUp(height + margin) / mCellSize;
+    long const kStep    = GetMipAlignment(width, height) / mCellSize;
+
+    long column, row;
+    if (! mOccupancy.FindFree(kColumns, kRows, kStep, column, row))
+        return false;
+
+    region.mLeft   = column * mCellSize;
+    region.mTop    = row    * mCellSize;
+    region.mRight  = region.mLeft + width  + margin;
+    region.mBottom = region.mTop  + height + margin;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: Reserve()
+// Desc: Marks the cells the (block aligned) region covers as used
+//-----------------------------------------------------------------------------
+void PackerBitmap::Reserve(Region const &region)
+{
+    assert((region.mLeft % mCellSize == 0) && (region.mTop % mCellSize == 0));
+
+    mOccupancy.SetUsed(region.mLeft / mCellSize, region.mTop / mCellSize,
+                       AlignUp(region.GetWidth())  / mCellSize,
+                       AlignUp(region.GetHeight()) / mCellSize);
+}
+
+//-----------------------------------------------------------------------------
+// Name: HasMonotonicFit()
+// Desc: Every cell position is tried, so a free spot for a texture also
+//       holds any smaller one
+//-----------------------------------------------------------------------------
+bool PackerBitmap::HasMonotonicFit() const
+{
+    return true;
+}
@@ -0,0 +1,45 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: PackerBitmap.h
+// Desc: Header file for PackerBitmap class
+//-----------------------------------------------------------------------------
+
+#ifndef PACKERBITMAP_H
+#define PACKERBITMAP_H
+
+#include "Packer.h"
+#include "OccupancyMap.h"
+
+//-----------------------------------------------------------------------------
+// Name: PackerBitmap
+// Desc: 2D packer backed by an occupancy bitmap (-packer bitmap).
+//       Every texel (every 4x4 block in DXTn atlases) of the atlas has one
+//       bit that tells whether it is used.  A texture goes to the first
+//       free spot top to bottom, left to right, at any texel (block)
+//       position it is aligned to (see GetMipAlignment()).  Testing a spot
+//       costs a few word operations per row instead of a walk over the used
+//       regions, so the cost does not grow w/ the number of textures 
+//       already placed.
+//-----------------------------------------------------------------------------
+class PackerBitmap : public Packer2D
+{
+public:
+    PackerBitmap(AtlasDesc const &desc);
+    virtual ~PackerBitmap();
+
+    static bool ParseName(char const *pName);
+
+protected:
+    virtual bool FindRegion(long width, long height, LONG margin, Region &region);
+    virtual void Reserve(Region const &region);
+    virtual bool HasMonotonicFit() const;
+
+private:
+    long            mCellSize;          // texels per bitmap cell and side
+    OccupancyMap    mOccupancy;
+};
+
+#endif // PACKERBITMAP_H
@@ -0,0 +1,283 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: PackerGuillotine.cpp
+// Desc: Implementation of the guillotine 2D packer
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "PackerGuillotine.h"
+#include "TextureObject.h"
+
+//-----------------------------------------------------------------------------
+// Name: PackerGuillotine()
+// Desc: Constructor: the whole atlas is one free rectangle
+//-----------------------------------------------------------------------------
+PackerGuillotine::PackerGuillotine(AtlasDesc const &desc, Settings const &settings)
+    : Packer2D(desc)
+    , mSettings(settings)
+    , mLastIndex(0)
+{
+    Region  atlasRegion;
+    atlasRegion.mRight  = desc.width;
+    atlasRegion.mBottom = desc.height;
+    mFreeRegions.push_back(atlasRegion);
+}
+
+//-----------------------------------------------------------------------------
+// Name: ~PackerGuillotine()
+// Desc: Destructor
+//-----------------------------------------------------------------------------
+PackerGuillotine::~PackerGuillotine()
+{
+    ;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ParseName()
+// Desc: returns true if pName is "guillotine" optionally followed by
+//       ':'-separated settings (see PackerGuillotine.h) and if so the
+//       settings it selects.  pSettings may be nullptr.
+//-----------------------------------------------------------------------------
+bool PackerGuillotine::ParseName(char const *pName, Settings *pSettings)
+{
+    char    name[kFilenameLength];
+    if (strlen(pName) >= sizeof(name))
+        return false;
+    sprintf_s(name, "%s", pName);
+
+    Settings    settings;
+    settings.choice = CHOICE_BESTAREAFIT;
+    settings.split  = SPLIT_SHORTERLEFTOVERAXIS;
+    settings.merge  = false;
+
+    // cut the name into its ':'-separated tokens: the first one is the packer
+    char *pToken = name;
+    char *pNext  = strchr(pToken, ':');
+    if (pNext != nullptr)
+        *pNext++ = '\0';
+
+    if (_strcmpi(pToken, "guillotine") != 0)
+        return false;
+
+    while (pNext != nullptr)
+    {
+        pToken = pNext;
+        pNext  = strchr(pToken, ':');
+        if (pNext != nullptr)
+            *pNext++ = '\0';
+
+        if (_strcmpi(pToken, "baf") == 0)
+            settings.choice = CHOICE_BESTAREAFIT;
+        else if (_strcmpi(pToken, "bssf") == 0)
+            settings.choice = CHOICE_BESTSHORTSIDEFIT;
+        else if (_strcmpi(pToken, "sas") == 0)
+            settings.split  = SPLIT_SHORTERLEFTOVERAXIS;
+        else if (_strcmpi(pToken, "las") == 0)
+            settings.split  = SPLIT_LONGERLEFTOVERAXIS;
+        else if (_strcmpi(pToken, "merge") == 0)
+            settings.merge  = true;
+        else
+            return false;
+    }
+
+    if (pSettings != nullptr)
+        *pSettings = settings;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindRegion()
+// Desc: Picks the free rectangle w/ the best score for the texture (plus
+//       margin on the right and bottom) and returns its top-left corner in
+//       region.  Returns false if no free rectangle is large enough.
+//-----------------------------------------------------------------------------
+bool PackerGuillotine::FindRegion(long width, long height, LONG margin, Region &region)
+{
+    // The space handed out is rounded up to the block size, so all cuts
+    // (and thus all placements) stay block aligned.
+    long const kWidth     = AlignUp(width  + margin);
+    long const kHeight    = AlignUp(height + margin);
+    long const kAlignment = GetMipAlignment(width, height);
+
+    long bestScore = LONG_MAX;
+    bool bFound    = false;
+
+    for (size_t i = 0; i < mFreeRegions.size(); ++i)
+    {
+        Region freeRegion = mFreeRegions[i];
+        freeRegion.mLeft  = AlignUp(freeRegion.mLeft, kAlignment);
+        freeRegion.mTop   = AlignUp(freeRegion.mTop,  kAlignment);
+        if (   (freeRegion.mRight  - freeRegion.mLeft < kWidth) 
+            || (freeRegion.mBottom - freeRegion.mTop  < kHeight))
+            continue;
+
+        long const kScore = Score(freeRegion, kWidth, kHeight);
+        if (kScore < bestScore)
+        {
+            bestScore  = kScore;
+            mLastIndex = i;
+            bFound     = true;
+
+            // a perfect fit cannot be beaten
+            if (kScore == 0L)
+                break;
+        }
+    }
+
+    if (! bFound)
+        return false;
+
+    region.mLeft   = AlignUp(mFreeRegions[mLastIndex].mLeft, kAlignment);
+    region.mTop    = AlignUp(mFreeRegions[mLastIndex].mTop,  kAlignment);
+    region.mRight  = region.mLeft + width  + margin;
+    region.mBottom = region.mTop  + height + margin;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: Score()
+// Desc: Score of putting a width x height block into freeRegion according
+//       to the choice rule.  Lower is better.
+//-----------------------------------------------------------------------------
+long PackerGuillotine::Score(Region const &freeRegion, long width, long height) const
+{
+    switch (mSettings.choice)
+    {
+        case CHOICE_BESTSHORTSIDEFIT:
+            return (std::min)(freeRegion.GetWidth() - width, freeRegion.GetHeight() - height);
+        case CHOICE_BESTAREAFIT:
+        default:
+            return freeRegion.GetWidth() * freeRegion.GetHeight() - width * height;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: Reserve()
+// Desc: Cuts the (block aligned) region out of the free rectangle that the
+//       preceding FindRegion() call picked.  If the region was moved off the
+//       rectangle's corner to be aligned, the strips left of and above it 
+//       are cut away w/ it: kept as cells of their own they fragment the 
+//       free space (and slow down merge) for hardly ever holding a texture.
+//-----------------------------------------------------------------------------
+void PackerGuillotine::Reserve(Region const &region)
+{
+    Region  used   = region;
+    used.mRight    = region.mLeft + AlignUp(region.GetWidth());
+    used.mBottom   = region.mTop  + AlignUp(region.GetHeight());
+
+    used.mLeft     = mFreeRegions[mLastIndex].mLeft;
+    used.mTop      = mFreeRegions[mLastIndex].mTop;
+
+    SplitFreeRegion(mLastIndex, used);
+
+    if (mSettings.merge)
+        MergeFreeRegions();
+}
+
+//-----------------------------------------------------------------------------
+// Name: HasMonotonicFit()
+// Desc: A texture fits if one free cell is large enough, and then so does
+//       any smaller one.  W/ :merge a later merge can join cells into one
+//       large enough for a size that missed before, so misses are not kept.
+//-----------------------------------------------------------------------------
+bool PackerGuillotine::HasMonotonicFit() const
+{
+    return ! mSettings.merge;
+}
+
+//-----------------------------------------------------------------------------
+// Name: SplitFreeRegion()
+// Desc: Replaces free region index w/ the (up to two) rectangles left of it
+//       right of and below the used region.  The split rule decides which
+//       of the two gets the corner next to the used region.
+//-----------------------------------------------------------------------------
+void PackerGuillotine::SplitFreeRegion(size_t index, Region const &used)
+{
+    Region const kFree = mFreeRegions[index];
+    assert((kFree.mLeft == used.mLeft) && (kFree.mTop == used.mTop));
+
+    mFreeRegions[index] = mFreeRegions.back();
+    mFreeRegions.pop_back();
+
+    long const kLeftoverWidth  = kFree.mRight  - used.mRight;
+    long const kLeftoverHeight = kFree.mBottom - used.mBottom;
+
+    // horizontal cut: the bottom part keeps the full width of the free region
+    // vertical cut:   the right part keeps the full height
+    bool const kCutHorizontal = (mSettings.split == SPLIT_SHORTERLEFTOVERAXIS)
+                                    ? (kLeftoverWidth <= kLeftoverHeight)
+                                    : (kLeftoverWidth >  kLeftoverHeight);
+
+    Region right  = kFree;
+    Region bottom = kFree;
+    right.mLeft   = used.mRight;
+    bottom.mTop   = used.mBottom;
+
+    if (kCutHorizontal)
+        right.mBottom = used.mBottom;
+    else
+        bottom.mRight = used.mRight;
+
+    if ((right.GetWidth() > 0) && (right.GetHeight() > 0))
+        mFreeRegions.push_back(right);
+    if ((bottom.GetWidth() > 0) && (bottom.GetHeight() > 0))
+        mFreeRegions.push_back(bottom);
+}
+
+//-----------------------------------------------------------------------------
+// Name: MergeFreeRegions()
+// Desc: Merges pairs of free rectangles that share a complete edge, i.e.,
+//       that together form a larger rectangle.
+//-----------------------------------------------------------------------------
+void PackerGuillotine::MergeFreeRegions()
+{
+    for (size_t i = 0; i < mFreeRegions.size(); ++i)
+        for (size_t j = i+1; j < mFreeRegions.size(); ++j)
+        {
+            Region &a = mFreeRegions[i];
+            Region &b = mFreeRegions[j];
+            bool   bMerged = false;
+
+            if ((a.mLeft == b.mLeft) && (a.mRight == b.mRight))
+            {
+                if (a.mBottom == b.mTop)
+                {
+                    a.mBottom = b.mBottom;
+                    bMerged   = true;
+                }
+                else if (b.mBottom == a.mTop)
+                {
+                    a.mTop    = b.mTop;
+                    bMerged   = true;
+                }
+            }
+            else if ((a.mTop == b.mTop) && (a.mBottom == b.mBottom))
+            {
+                if (a.mRight == b.mLeft)
+                {
+                    a.mRight  = b.mRight;
+                    bMerged   = true;
+                }
+                else if (b.mRight == a.mLeft)
+                {
+                    a.mLeft   = b.mLeft;
+                    bMerged   = true;
+                }
+            }
+
+            if (bMerged)
+            {
+                mFreeRegions.erase(mFreeRegions.begin() + j);
+                --j;
+            }
+        }
+}
@@ -0,0 +1,80 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: PackerGuillotine.h
+// Desc: Header file for PackerGuillotine class
+//-----------------------------------------------------------------------------
+
+#ifndef PACKERGUILLOTINE_H
+#define PACKERGUILLOTINE_H
+
+#include "Packer.h"
+
+//-----------------------------------------------------------------------------
+// Name: PackerGuillotine
+// Desc: 2D packer using guillotine splits (-packer guillotine).
+//       The free space is a list of disjoint rectangles.  A texture goes into
+//       the top-left corner of one of them and the rest of that rectangle is
+//       cut in two w/ a single straight cut, so the atlas is always made of
+//       clean rectangular cells.  Settings (appended to the name w/ ':'):
+//         baf | bssf   free rectangle choice: best area fit (default) or
+//                      best short side fit
+//         sas | las    cut along the shorter (default) or longer leftover
+//                      axis
+//         merge        merge neighboring free rectangles of equal size
+//                      after each insertion
+//       A texture that has to be aligned (see GetMipAlignment()) goes to the
+//       first aligned spot right of and below the corner instead; what it
+//       skips is lost.
+//-----------------------------------------------------------------------------
+class PackerGuillotine : public Packer2D
+{
+public:
+    enum eChoiceRule
+    {
+        CHOICE_BESTAREAFIT = 0,
+        CHOICE_BESTSHORTSIDEFIT,
+        CHOICE_NUM,
+    };
+
+    enum eSplitRule
+    {
+        SPLIT_SHORTERLEFTOVERAXIS = 0,
+        SPLIT_LONGERLEFTOVERAXIS,
+        SPLIT_NUM,
+    };
+
+    struct Settings
+    {
+        eChoiceRule     choice;
+        eSplitRule      split;
+        bool            merge;
+    };
+
+public:
+    PackerGuillotine(AtlasDesc const &desc, Settings const &settings);
+    virtual ~PackerGuillotine();
+
+    static bool ParseName(char const *pName, Settings *pSettings);
+
+protected:
+    virtual bool FindRegion(long width, long height, LONG margin, Region &region);
+    virtual void Reserve(Region const &region);
+    virtual bool HasMonotonicFit() const;
+
+private:
+    long Score(Region const &freeRegion, long width, long height) const;
+    void SplitFreeRegion(size_t index, Region const &used);
+    void MergeFreeRegions();
+
+private:
+    Settings                mSettings;
+    std::vector<Region>     mFreeRegions;
+
+    // index of the free region the last FindRegion() call picked
+    size_t                  mLastIndex;
+};
+
+#endif // PACKERGUILLOTINE_H
@@ -0,0 +1,328 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: PackerMaxRects.cpp
+// Desc: Implementation of the MaxRects 2D packer
+//-----------------------------------------------------------------------------
+
+#include <assert.h>
+#include <limits.h>
+
+#include <algorithm>
+
+#include "PackerMaxRects.h"
+#include "TextureObject.h"
+
+namespace
+{
+    struct HeuristicName
+    {
+        char const *                    pName;
+        PackerMaxRects::eHeuristic      heuristic;
+    };
+
+    HeuristicName const kHeuristicNames[] =
+    {
+        { "maxrects",       PackerMaxRects::HEURISTIC_BESTSHORTSIDEFIT },
+        { "maxrects:bssf",  PackerMaxRects::HEURISTIC_BESTSHORTSIDEFIT },
+        { "maxrects:baf",   PackerMaxRects::HEURISTIC_BESTAREAFIT      },
+        { "maxrects:bl",    PackerMaxRects::HEURISTIC_BOTTOMLEFT       },
+        { "maxrects:cp",    PackerMaxRects::HEURISTIC_CONTACTPOINT     },
+    };
+
+    //-------------------------------------------------------------------------
+    // Name: Overlaps()
+    // Desc: returns true if the two [left, right) x [top, bottom) regions
+    //       share at least one texel
+    //-------------------------------------------------------------------------
+    bool Overlaps(Region const &a, Region const &b)
+    {
+        return    (a.mLeft < b.mRight) && (a.mRight  > b.mLeft)
+               && (a.mTop  < b.mBottom) && (a.mBottom > b.mTop);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: IsContainedIn()
+    // Desc: returns true if region a lies completely inside region b
+    //-------------------------------------------------------------------------
+    bool IsContainedIn(Region const &a, Region const &b)
+    {
+        return    (a.mLeft >= b.mLeft) && (a.mRight  <= b.mRight)
+               && (a.mTop  >= b.mTop ) && (a.mBottom <= b.mBottom);
+    }
+
+    //-------------------------------------------------------------------------
+    // Name: CommonIntervalLength()
+    // Desc: returns the length of the overlap of [start1, end1) and [start2, end2)
+    //-------------------------------------------------------------------------
+    long CommonIntervalLength(long start1, long end1, long start2, long end2)
+    {
+        if ((end1 <= start2) || (end2 <= start1))
+            return 0L;
+        return (std::min)(end1, end2) - (std::max)(start1, start2);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: PackerMaxRects()
+// Desc: Constructor: the whole atlas is one free rectangle
+//-----------------------------------------------------------------------------
+PackerMaxRects::PackerMaxRects(AtlasDesc const &desc, eHeuristic heuristic)
+    : Packer2D(desc)
+    , mHeuristic(heuristic)
+{
+    Region  atlasRegion;
+    atlasRegion.mRight  = desc.width;
+    atlasRegion.mBottom = desc.height;
+    mFreeRegions.push_back(atlasRegion);
+}
+
+//-----------------------------------------------------------------------------
+// Name: ~PackerMaxRects()
+// Desc: Destructor
+//-----------------------------------------------------------------------------
+PackerMaxRects::~PackerMaxRects()
+{
+    ;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ParseName()
+// Desc: returns true if pName is one of the maxrects packer names
+//       (maxrects, maxrects:bssf, ...) and if so the heuristic it selects.
+//       pHeuristic may be nullptr.
+//-----------------------------------------------------------------------------
+bool PackerMaxRects::ParseName(char const *pName, eHeuristic *pHeuristic)
+{
+    for (int i = 0; i < static_cast<int>(sizeof(kHeuristicNames)/sizeof(kHeuristicNames[0])); ++i)
+        if (_strcmpi(kHeuristicNames[i].pName, pName) == 0)
+        {
+            if (pHeuristic != nullptr)
+                *pHeuristic = kHeuristicNames[i].heuristic;
+            return true;
+        }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindRegion()
+// Desc: Scores all free rectangles that can hold the texture (plus margin
+//       on the right and bottom) and returns the top-left corner of the best
+//       one in region.  Returns false if no free rectangle is large enough.
+//       The corners are first moved right and down to the texture's 
+//       alignment, see GetMipAlignment(); what is cut off stays free.
+//-----------------------------------------------------------------------------
+bool PackerMaxRects::FindRegion(long width, long height, LONG margin, Region &region)
+{
+    // The space handed out is rounded up to the block size, so all free
+    // rectangle edges (and thus all placements) stay block aligned.
+    long const kWidth     = AlignUp(width  + margin);
+    long const kHeight    = AlignUp(height + margin);
+    long const kAlignment = GetMipAlignment(width, height);
+
+    long bestPrimaryScore   = LONG_MAX;
+    long bestSecondaryScore = LONG_MAX;
+    bool bFound             = false;
+
+    std::vector<Region>::const_iterator iterFree;
+    for (iterFree = mFreeRegions.begin(); iterFree != mFreeRegions.end(); ++iterFree)
+    {
+        Region aligned = *iterFree;
+        aligned.mLeft  = AlignUp(iterFree->mLeft, kAlignment);
+        aligned.mTop   = AlignUp(iterFree->mTop,  kAlignment);
+        if ((aligned.mRight - aligned.mLeft < kWidth) || (aligned.mBottom - aligned.mTop < kHeight))
+            continue;
+
+        long primaryScore, secondaryScore;
+        ScoreRegion(aligned, kWidth, kHeight, primaryScore, secondaryScore);
+
+        if (   (primaryScore < bestPrimaryScore)
+            || ((primaryScore == bestPrimaryScore) && (secondaryScore < bestSecondaryScore)))
+        {
+            bestPrimaryScore   = primaryScore;
+            bestSecondaryScore = secondaryScore;
+
+            region.mLeft   = aligned.mLeft;
+            region.mTop    = aligned.mTop;
+            region.mRight  = aligned.mLeft + width  + margin;
+            region.mBottom = aligned.mTop  + height + margin;
+            bFound         = true;
+        }
+    }
+    return bFound;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ScoreRegion()
+// Desc: Computes the score of placing a width x height block at the top-left
+//       corner of freeRegion according to mHeuristic.  Lower is better; the
+//       secondary score breaks ties.
+//-----------------------------------------------------------------------------
+void PackerMaxRects::ScoreRegion(Region const &freeRegion, long width, long height,
+                                 long &primaryScore, long &secondaryScore) const
+{
+    long const kLeftoverHoriz = freeRegion.GetWidth()  - width;
+    long const kLeftoverVert  = freeRegion.GetHeight() - height;
+    long const kShortSide     = (std::min)(kLeftoverHoriz, kLeftoverVert);
+    long const kLongSide      = (std::max)(kLeftoverHoriz, kLeftoverVert);
+
+    switch (mHeuristic)
+    {
+        case HEURISTIC_BESTAREAFIT:
+            primaryScore   = freeRegion.GetWidth() * freeRegion.GetHeight() - width * height;
+            secondaryScore = kShortSide;
+            break;
+        case HEURISTIC_BOTTOMLEFT:
+            primaryScore   = freeRegion.mTop + height;
+            secondaryScore = freeRegion.mLeft;
+            break;
+        case HEURISTIC_CONTACTPOINT:
+            // more contact is better: negate so lower still wins
+            primaryScore   = -ContactScore(freeRegion.mLeft, freeRegion.mTop, width, height);
+            secondaryScore = kShortSide;
+            break;
+        case HEURISTIC_BESTSHORTSIDEFIT:
+        default:
+            primaryScore   = kShortSide;
+            secondaryScore = kLongSide;
+            break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: ContactScore()
+// Desc: returns the length of the edges of the given block that touch the
+//       atlas borders or already reserved regions.
+//-----------------------------------------------------------------------------
+long PackerMaxRects::ContactScore(long left, long top, long width, long height) const
+{
+    long const kRight  = left + width;
+    long const kBottom = top  + height;
+    long       score   = 0L;
+
+    if ((left == 0L) || (kRight == mDesc.width))
+        score += height;
+    if ((top == 0L) || (kBottom == mDesc.height))
+        score += width;
+
+    std::vector<Region>::const_iterator iterUsed;
+    for (iterUsed = mReservedRegions.begin(); iterUsed != mReservedRegions.end(); ++iterUsed)
+    {
+        if ((iterUsed->mLeft == kRight) || (iterUsed->mRight == left))
+            score += CommonIntervalLength(iterUsed->mTop, iterUsed->mBottom, top, kBottom);
+        if ((iterUsed->mTop == kBottom) || (iterUsed->mBottom == top))
+            score += CommonIntervalLength(iterUsed->mLeft, iterUsed->mRight, left, kRight);
+    }
+    return score;
+}
+
+//-----------------------------------------------------------------------------
+// Name: Reserve()
+// Desc: Removes the (block aligned) region from the free rectangles: every
+//       free rectangle it overlaps is split into up to four maximal
+//       rectangles around it; then rectangles that are contained in others
+//       are dropped.
+//-----------------------------------------------------------------------------
+void PackerMaxRects::Reserve(Region const &region)
+{
+    Region  used   = region;
+    used.mRight    = region.mLeft + AlignUp(region.GetWidth());
+    used.mBottom   = region.mTop  + AlignUp(region.GetHeight());
+
+    size_t numFreeRegions = mFreeRegions.size();
+    for (size_t i = 0; i < numFreeRegions; ++i)
+    {
+        // copy: SplitFreeRegion appends to mFreeRegions
+        Region const kFree = mFreeRegions[i];
+        if (SplitFreeRegion(kFree, used))
+        {
+            mFreeRegions.erase(mFreeRegions.begin() + i);
+            --i;
+            --numFreeRegions;
+        }
+    }
+    PruneFreeRegions(numFreeRegions);
+
+    mReservedRegions.push_back(used);
+}
+
+//-----------------------------------------------------------------------------
+// Name: HasMonotonicFit()
+// Desc: The free rectangles are maximal, so a texture fits if it fits into
+//       one of them: whatever is no larger fits as well
+//-----------------------------------------------------------------------------
+bool PackerMaxRects::HasMonotonicFit() const
+{
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: SplitFreeRegion()
+// Desc: If usedRegion overlaps freeRegion, appends the parts of freeRegion
+//       left, right, above and below usedRegion to mFreeRegions and
+//       returns true.  Returns false (and does nothing) otherwise.
+//-----------------------------------------------------------------------------
+bool PackerMaxRects::SplitFreeRegion(Region const &freeRegion, Region const &usedRegion)
+{
+    if (! Overlaps(freeRegion, usedRegion))
+        return false;
+
+    Region newRegion;
+
+    // part above the used region
+    if (usedRegion.mTop > freeRegion.mTop)
+    {
+        newRegion         = freeRegion;
+        newRegion.mBottom = usedRegion.mTop;
+        mFreeRegions.push_back(newRegion);
+    }
+    // part below the used region
+    if (usedRegion.mBottom < freeRegion.mBottom)
+    {
+        newRegion         = freeRegion;
+        newRegion.mTop    = usedRegion.mBottom;
+        mFreeRegions.push_back(newRegion);
+    }
+    // part left of the used region
+    if (usedRegion.mLeft > freeRegion.mLeft)
+    {
+        newRegion         = freeRegion;
+        newRegion.mRight  = usedRegion.mLeft;
+        mFreeRegions.push_back(newRegion);
+    }
+    // part right of the used region
+    if (usedRegion.mRight < freeRegion.mRight)
+    {
+        newRegion         = freeRegion;
+        newRegion.mLeft   = usedRegion.mRight;
+        mFreeRegions.push_back(newRegion);
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: PruneFreeRegions()
+// Desc: Removes all free rectangles that are contained in another one.
+//       Only the ones from firstNew on, which the last split added, can be:
+//       an older one that lies in one of them would lie in the rectangle it
+//       was split off from, and would have been removed back then.  So the
+//       cost grows w/ the number of free rectangles, not w/ its square.
+//-----------------------------------------------------------------------------
+void PackerMaxRects::PruneFreeRegions(size_t firstNew)
+{
+    size_t i = firstNew;
+    while (i < mFreeRegions.size())
+    {
+        bool bContained = false;
+        for (size_t j = 0; (j < mFreeRegions.size()) && (! bContained); ++j)
+            bContained = (j != i) && IsContainedIn(mFreeRegions[i], mFreeRegions[j]);
+
+        if (bContained)
+            mFreeRegions.erase(mFreeRegions.begin() + i);
+        else
+            ++i;
+    }
+}
@@ -0,0 +1,63 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: PackerMaxRects.h
+// Desc: Header file for PackerMaxRects class
+//-----------------------------------------------------------------------------
+
+#ifndef PACKERMAXRECTS_H
+#define PACKERMAXRECTS_H
+
+#include "Packer.h"
+
+//-----------------------------------------------------------------------------
+// Name: PackerMaxRects
+// Desc: 2D packer using the MaxRects algorithm (-packer maxrects).
+//       It keeps the list of maximal free rectangles of the atlas: a texture
+//       can go into any free rectangle large enough to hold it and is placed
+//       in its top-left corner.  The free rectangle is chosen by one of the
+//       usual heuristics:
+//         bssf  best short side fit: smallest leftover on the shorter side
+//         baf   best area fit: smallest free rectangle that fits
+//         bl    bottom-left: lowest, then left-most position (Tetris style)
+//         cp    contact point: touches the most atlas borders/used regions
+//-----------------------------------------------------------------------------
+class PackerMaxRects : public Packer2D
+{
+public:
+    enum eHeuristic
+    {
+        HEURISTIC_BESTSHORTSIDEFIT = 0,
+        HEURISTIC_BESTAREAFIT,
+        HEURISTIC_BOTTOMLEFT,
+        HEURISTIC_CONTACTPOINT,
+        HEURISTIC_NUM,
+    };
+
+public:
+    PackerMaxRects(AtlasDesc const &desc, eHeuristic heuristic);
+    virtual ~PackerMaxRects();
+
+    static bool ParseName(char const *pName, eHeuristic *pHeuristic);
+
+protected:
+    virtual bool FindRegion(long width, long height, LONG margin, Region &region);
+    virtual void Reserve(Region const &region);
+    virtual bool HasMonotonicFit() const;
+
+private:
+    void ScoreRegion(Region const &freeRegion, long width, long height,
+                     long &primaryScore, long &secondaryScore) const;
+    long ContactScore(long left, long top, long width, long height) const;
+    bool SplitFreeRegion(Region const &freeRegion, Region const &usedRegion);
+    void PruneFreeRegions(size_t firstNew);
+
+private:
+    eHeuristic              mHeuristic;
+    std::vector<Region>     mFreeRegions;
+    std::vector<Region>     mReservedRegions;
+};
+
+#endif // PACKERMAXRECTS_H
@@ -0,0 +1,341 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: PackerSkyline.cpp
+// Desc: Implementation of the skyline bottom-left 2D packer
+//-----------------------------------------------------------------------------
+
+#include <assert.h>
+#include <limits.h>
+
+#include <algorithm>
+
+#include "PackerSkyline.h"
+#include "TextureObject.h"
+
+//-----------------------------------------------------------------------------
+// Name: PackerSkyline()
+// Desc: Constructor: the skyline starts out as one segment at the top of
+//       the atlas spanning its whole width.
+//-----------------------------------------------------------------------------
+PackerSkyline::PackerSkyline(AtlasDesc const &desc, bool useWasteMap)
+    : Packer2D(desc)
+    , mbUseWasteMap(useWasteMap)
+    , mbLastInWaste(false)
+    , mLastIndex(0)
+{
+    SkylineSegment  segment;
+    segment.left  = 0L;
+    segment.top   = 0L;
+    segment.width = desc.width;
+    mSkyline.push_back(segment);
+}
+
+//-----------------------------------------------------------------------------
+// Name: ~PackerSkyline()
+// Desc: Destructor
+//-----------------------------------------------------------------------------
+PackerSkyline::~PackerSkyline()
+{
+    ;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ParseName()
+// Desc: returns true if pName is skyline or skyline:waste and if so whether
+//       the waste map is to be used.  pUseWasteMap may be nullptr.
+//-----------------------------------------------------------------------------
+bool PackerSkyline::ParseName(char const *pName, bool *pUseWasteMap)
+{
+    bool useWasteMap;
+    if (_strcmpi(pName, "skyline") == 0)
+        useWasteMap = false;
+    else if (_strcmpi(pName, "skyline:waste") == 0)
+        useWasteMap = true;
+    else
+        return false;
+
+    if (pUseWasteMap != nullptr)
+        *pUseWasteMap = useWasteMap;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindRegion()
+// Desc: Finds a spot for the texture (plus margin on the right and bottom):
+//       in the waste map if enabled and the texture fits there, otherwise
+//       on top of the skyline.  Returns false if neither has room.
+//-----------------------------------------------------------------------------
+bool PackerSkyline::FindRegion(long width, long height, LONG margin, Region &region)
+{
+    // The space handed out is rounded up to the block size, so all skyline
+    // and waste map edges (and thus all placements) stay block aligned.
+    long const kWidth     = AlignUp(width  + margin);
+    long const kHeight    = AlignUp(height + margin);
+    long const kAlignment = GetMipAlignment(width, height);
+
+    size_t  index;
+    long    left, top;
+
+    if (mbUseWasteMap && FindWastePosition(kWidth, kHeight, kAlignment, index))
+    {
+        left          = AlignUp(mWasteRegions[index].mLeft, kAlignment);
+        top           = AlignUp(mWasteRegions[index].mTop,  kAlignment);
+        mbLastInWaste = true;
+    }
+    else if (FindSkylinePosition(kWidth, kHeight, kAlignment, index, left, top))
+        mbLastInWaste = false;
+    else
+        return false;
+
+    mLastIndex     = index;
+    region.mLeft   = left;
+    region.mTop    = top;
+    region.mRight  = left + width  + margin;
+    region.mBottom = top  + height + margin;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: Reserve()
+// Desc: Updates the waste map or the skyline w/ the (block aligned) region
+//       that the preceding FindRegion() call returned.
+//       If the region was moved off the waste region's corner or the 
+//       segment's left end to be aligned, what it skipped is split off 
+//       first: it stays in the waste map or on the skyline.
+//-----------------------------------------------------------------------------
+void PackerSkyline::Reserve(Region const &region)
+{
+    Region  used   = region;
+    used.mRight    = region.mLeft + AlignUp(region.GetWidth());
+    used.mBottom   = region.mTop  + AlignUp(region.GetHeight());
+
+    if (mbLastInWaste)
+    {
+        Region waste = mWasteRegions[mLastIndex];
+        if (used.mLeft > waste.mLeft)
+        {
+            Region skipped  = waste;
+            skipped.mRight  = used.mLeft;
+            waste.mLeft     = used.mLeft;
+            mWasteRegions.push_back(skipped);
+        }
+        if (used.mTop > waste.mTop)
+        {
+            Region skipped  = waste;
+            skipped.mBottom = used.mTop;
+            waste.mTop      = used.mTop;
+            mWasteRegions.push_back(skipped);
+        }
+        mWasteRegions[mLastIndex] = waste;
+
+        SplitWasteRegion(mLastIndex, used);
+        return;
+    }
+
+    SkylineSegment &segment = mSkyline[mLastIndex];
+    if (used.mLeft > segment.left)
+    {
+        SkylineSegment skipped = segment;
+        skipped.width  = used.mLeft - segment.left;
+        segment.left   = used.mLeft;
+        segment.width -= skipped.width;
+        mSkyline.insert(mSkyline.begin() + mLastIndex, skipped);
+        ++mLastIndex;
+    }
+    AddSkylineLevel(mLastIndex, used);
+}
+
+//-----------------------------------------------------------------------------
+// Name: HasMonotonicFit()
+// Desc: A smaller texture fits wherever a larger one does, on the skyline
+//       as well as in the waste map
+//-----------------------------------------------------------------------------
+bool PackerSkyline::HasMonotonicFit() const
+{
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindSkylinePosition()
+// Desc: Bottom-left rule: of all skyline segments a width x height block can
+//       start at, pick the one where the bottom of the block is the highest
+//       up (smallest y); on ties prefer the narrower segment.
+//-----------------------------------------------------------------------------
+bool PackerSkyline::FindSkylinePosition(long width, long height, long alignment, 
+                                        size_t &index, long &left, long &top) const
+{
+    long bestBottom = LONG_MAX;
+    long bestWidth  = LONG_MAX;
+    bool bFound     = false;
+
+    for (size_t i = 0; i < mSkyline.size(); ++i)
+    {
+        long segmentLeft, segmentTop;
+        if (! Fits(i, width, height, alignment, segmentLeft, segmentTop))
+            continue;
+
+        if (   (segmentTop + height < bestBottom)
+            || ((segmentTop + height == bestBottom) && (mSkyline[i].width < bestWidth)))
+        {
+            bestBottom = segmentTop + height;
+            bestWidth  = mSkyline[i].width;
+            index      = i;
+            left       = segmentLeft;
+            top        = segmentTop;
+            bFound     = true;
+        }
+    }
+    return bFound;
+}
+
+//-----------------------------------------------------------------------------
+// Name: Fits()
+// Desc: Returns true if a width x height block starting at the first
+//       aligned x of skyline segment index fits into the atlas; left is
+//       then that x and top the y it rests at, i.e., the highest skyline 
+//       level below it rounded up to the alignment.  A segment w/o an 
+//       aligned x does not fit: the next one starts at the same x.
+//-----------------------------------------------------------------------------
+bool PackerSkyline::Fits(size_t index, long width, long height, long alignment, long &left, long &top) const
+{
+    left = AlignUp(mSkyline[index].left, alignment);
+    if (   (left >= mSkyline[index].left + mSkyline[index].width)
+        || (left + width > mDesc.width))
+        return false;
+
+    long widthLeft = left + width - mSkyline[index].left;
+    top            = mSkyline[index].top;
+    for (size_t i = index; widthLeft > 0; ++i)
+    {
+        // the segments cover the whole atlas width, so i stays in range
+        assert(i < mSkyline.size());
+        top = (std::max)(top, mSkyline[i].top);
+        widthLeft -= mSkyline[i].width;
+    }
+    top = AlignUp(top, alignment);
+    return (top + height <= mDesc.height);
+}
+
+//-----------------------------------------------------------------------------
+// Name: AddSkylineLevel()
+// Desc: Raises the skyline over the used region which starts at segment
+//       index.  The gaps between the old skyline and the bottom of the used
+//       region go into the waste map (if enabled).
+//-----------------------------------------------------------------------------
+void PackerSkyline::AddSkylineLevel(size_t index, Region const &used)
+{
+    assert(mSkyline[index].left == used.mLeft);
+
+    if (mbUseWasteMap)
+    {
+        for (size_t i = index; (i < mSkyline.size()) && (mSkyline[i].left < used.mRight); ++i)
+        {
+            Region waste;
+            waste.mLeft   = mSkyline[i].left;
+            waste.mRight  = (std::min)(mSkyline[i].left + mSkyline[i].width, used.mRight);
+            waste.mTop    = mSkyline[i].top;
+            waste.mBottom = used.mTop;
+
+            if (waste.mTop < waste.mBottom)
+                mWasteRegions.push_back(waste);
+        }
+    }
+
+    SkylineSegment  newSegment;
+    newSegment.left  = used.mLeft;
+    newSegment.top   = used.mBottom;
+    newSegment.width = used.GetWidth();
+    mSkyline.insert(mSkyline.begin() + index, newSegment);
+
+    // cut away what the new segment now covers of the following ones
+    long const kRight = newSegment.left + newSegment.width;
+    for (size_t i = index+1; i < mSkyline.size(); )
+    {
+        if (mSkyline[i].left >= kRight)
+            break;
+
+        long const kShrink = kRight - mSkyline[i].left;
+        if (mSkyline[i].width <= kShrink)
+        {
+            mSkyline.erase(mSkyline.begin() + i);
+            continue;
+        }
+        mSkyline[i].left  += kShrink;
+        mSkyline[i].width -= kShrink;
+        break;
+    }
+
+    // merge neighboring segments at the same level
+    for (size_t i = (index > 0) ? index-1 : 0; (i+1 < mSkyline.size()) && (i <= index+1); )
+    {
+        if (mSkyline[i].top == mSkyline[i+1].top)
+        {
+            mSkyline[i].width += mSkyline[i+1].width;
+            mSkyline.erase(mSkyline.begin() + i + 1);
+        }
+        else
+            ++i;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindWastePosition()
+// Desc: Best area fit over the waste map: returns the index of the smallest
+//       waste region that can hold a width x height block at an aligned
+//       position.
+//-----------------------------------------------------------------------------
+bool PackerSkyline::FindWastePosition(long width, long height, long alignment, size_t &index) const
+{
+    long bestArea = LONG_MAX;
+    bool bFound   = false;
+
+    for (size_t i = 0; i < mWasteRegions.size(); ++i)
+    {
+        Region const &waste = mWasteRegions[i];
+        if (   (waste.mRight  - AlignUp(waste.mLeft, alignment) < width) 
+            || (waste.mBottom - AlignUp(waste.mTop,  alignment) < height))
+            continue;
+
+        long const kArea = waste.GetWidth() * waste.GetHeight();
+        if (kArea < bestArea)
+        {
+            bestArea = kArea;
+            index    = i;
+            bFound   = true;
+        }
+    }
+    return bFound;
+}
+
+//-----------------------------------------------------------------------------
+// Name: SplitWasteRegion()
+// Desc: Replaces waste region index w/ what is left of it right and below
+//       of the used region.  The cut goes along the shorter leftover axis,
+//       so the larger leftover stays in one piece.
+//-----------------------------------------------------------------------------
+void PackerSkyline::SplitWasteRegion(size_t index, Region const &used)
+{
+    Region const kWaste = mWasteRegions[index];
+    assert((kWaste.mLeft == used.mLeft) && (kWaste.mTop == used.mTop));
+
+    mWasteRegions[index] = mWasteRegions.back();
+    mWasteRegions.pop_back();
+
+    Region right  = kWaste;
+    Region bottom = kWaste;
+    right.mLeft   = used.mRight;
+    bottom.mTop   = used.mBottom;
+
+    if (kWaste.mRight - used.mRight < kWaste.mBottom - used.mBottom)
+        right.mBottom = used.mBottom;       // bottom part keeps the full width
+    else
+        bottom.mRight = used.mRight;        // right part keeps the full height
+
+    if ((right.GetWidth() > 0) && (right.GetHeight() > 0))
+        mWasteRegions.push_back(right);
+    if ((bottom.GetWidth() > 0) && (bottom.GetHeight() > 0))
+        mWasteRegions.push_back(bottom);
+}
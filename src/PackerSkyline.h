@@ -0,0 +1,70 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: PackerSkyline.h
+// Desc: Header file for PackerSkyline class
+//-----------------------------------------------------------------------------
+
+#ifndef PACKERSKYLINE_H
+#define PACKERSKYLINE_H
+
+#include "Packer.h"
+
+//-----------------------------------------------------------------------------
+// Name: PackerSkyline
+// Desc: 2D packer using the skyline bottom-left algorithm (-packer skyline).
+//       Only the upper contour ("skyline") of the placed textures is stored:
+//       a list of horizontal segments.  A texture is put on the segment where
+//       its bottom edge ends up the highest up in the atlas.  The cost of an
+//       insertion only depends on the number of skyline segments, not on the
+//       number of textures already placed, so it scales to very large sets
+//       of small images.
+//
+//       The space that ends up trapped below a texture that sits on a higher
+//       segment is lost to the skyline.  With -packer skyline:waste these
+//       gaps are kept in a waste map (a list of free rectangles split
+//       guillotine style) and are filled first when a texture fits there.
+//       A texture that has to be aligned (see GetMipAlignment()) goes to
+//       the first aligned spot right of a segment's left end, or right of
+//       and below a waste region's top-left corner.
+//-----------------------------------------------------------------------------
+class PackerSkyline : public Packer2D
+{
+public:
+    PackerSkyline(AtlasDesc const &desc, bool useWasteMap);
+    virtual ~PackerSkyline();
+
+    static bool ParseName(char const *pName, bool *pUseWasteMap);
+
+protected:
+    virtual bool FindRegion(long width, long height, LONG margin, Region &region);
+    virtual void Reserve(Region const &region);
+    virtual bool HasMonotonicFit() const;
+
+private:
+    struct SkylineSegment
+    {
+        long    left;
+        long    top;            // the free space above starts at this y
+        long    width;
+    };
+
+    bool FindSkylinePosition(long width, long height, long alignment, size_t &index, long &left, long &top) const;
+    bool Fits(size_t index, long width, long height, long alignment, long &left, long &top) const;
+    void AddSkylineLevel(size_t index, Region const &used);
+    bool FindWastePosition(long width, long height, long alignment, size_t &index) const;
+    void SplitWasteRegion(size_t index, Region const &used);
+
+private:
+    bool                            mbUseWasteMap;
+    std::vector<SkylineSegment>     mSkyline;
+    std::vector<Region>             mWasteRegions;
+
+    // where the last FindRegion() call found its spot: Reserve() uses these
+    bool                            mbLastInWaste;
+    size_t                          mLastIndex;
+};
+
+#endif // PACKERSKYLINE_H
@@ -0,0 +1,155 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: RegionGrid.cpp
+// Desc: Implementation of the RegionGrid spatial index
+//-----------------------------------------------------------------------------
+
+#include <assert.h>
+
+#include <algorithm>
+
+#include "RegionGrid.h"
+#include "Packer.h"
+
+//-----------------------------------------------------------------------------
+// Name: RegionGrid()
+// Desc: Constructor: picks a power of 2 cell size so that the atlas is
+//       covered by at most kMaxCellsPerSide cells in each direction.
+//-----------------------------------------------------------------------------
+RegionGrid::RegionGrid(long width, long height)
+    : mCellSize(kMinCellSize)
+    , mNumColumns(0)
+    , mNumRows(0)
+{
+    long const kLargestSide = (std::max)(1L, (std::max)(width, height));
+    while (mCellSize * kMaxCellsPerSide < kLargestSide)
+        mCellSize *= 2;
+
+    mNumColumns = (std::max)(1L, (width  + mCellSize - 1) / mCellSize);
+    mNumRows    = (std::max)(1L, (height + mCellSize - 1) / mCellSize);
+    mCells.resize(mNumColumns * mNumRows);
+}
+
+//-----------------------------------------------------------------------------
+// Name: ~RegionGrid()
+// Desc: Destructor
+//-----------------------------------------------------------------------------
+RegionGrid::~RegionGrid()
+{
+    ;
+}
+
+//-----------------------------------------------------------------------------
+// Name: Insert()
+// Desc: Adds the region to all cells it overlaps
+//-----------------------------------------------------------------------------
+void RegionGrid::Insert(Region const *pRegion)
+{
+    assert(pRegion != nullptr);
+
+    long firstColumn, lastColumn, firstRow, lastRow;
+    if (! GetCellRange(*pRegion, false, firstColumn, lastColumn, firstRow, lastRow))
+        return;
+
+    for (long row = firstRow; row <= lastRow; ++row)
+        for (long column = firstColumn; column <= lastColumn; ++column)
+            mCells[row * mNumColumns + column].push_back(pRegion);
+}
+
+//-----------------------------------------------------------------------------
+// Name: Remove()
+// Desc: Removes the region from all cells it was added to.  The region must
+//       not have changed since it was inserted.
+//-----------------------------------------------------------------------------
+void RegionGrid::Remove(Region const *pRegion)
+{
+    long firstColumn, lastColumn, firstRow, lastRow;
+    if (! GetCellRange(*pRegion, false, firstColumn, lastColumn, firstRow, lastRow))
+        return;
+
+    for (long row = firstRow; row <= lastRow; ++row)
+        for (long column = firstColumn; column <= lastColumn; ++column)
+        {
+            std::vector<Region const *> &cell = mCells[row * mNumColumns + column];
+            std::vector<Region const *>::iterator iterCell = std::find(cell.begin(), cell.end(), pRegion);
+            if (iterCell != cell.end())
+            {
+                *iterCell = cell.back();
+                cell.pop_back();
+            }
+        }
+}
+
+//-----------------------------------------------------------------------------
+// Name: Intersects()
+// Desc: Same as Packer2D::Intersects(): returns a region that intersects the
+//       passed in one, or nullptr if there is none.
+//-----------------------------------------------------------------------------
+Region const * RegionGrid::Intersects(Region const &region, bool shrinkTest) const
+{
+    long firstColumn, lastColumn, firstRow, lastRow;
+    if (! GetCellRange(region, shrinkTest, firstColumn, lastColumn, firstRow, lastRow))
+        return nullptr;
+
+    for (long row = firstRow; row <= lastRow; ++row)
+        for (long column = firstColumn; column <= lastColumn; ++column)
+        {
+            std::vector<Region const *> const &cell = mCells[row * mNumColumns + column];
+            std::vector<Region const *>::const_iterator iterCell;
+            for (iterCell = cell.begin(); iterCell != cell.end(); ++iterCell)
+                if ((*iterCell)->Intersect(region, shrinkTest))
+                    return *iterCell;
+        }
+
+    return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetCandidates()
+// Desc: Appends all regions listed in the cells the area covers to 
+//       candidates, i.e., all regions that might intersect area (and some
+//       that do not).  A region may be appended more than once.
+//-----------------------------------------------------------------------------
+void RegionGrid::GetCandidates(Region const &area, std::vector<Region const *> &candidates) const
+{
+    long firstColumn, lastColumn, firstRow, lastRow;
+    if (! GetCellRange(area, false, firstColumn, lastColumn, firstRow, lastRow))
+        return;
+
+    for (long row = firstRow; row <= lastRow; ++row)
+        for (long column = firstColumn; column <= lastColumn; ++column)
+        {
+            std::vector<Region const *> const &cell = mCells[row * mNumColumns + column];
+            candidates.insert(candidates.end(), cell.begin(), cell.end());
+        }
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetCellRange()
+// Desc: Computes the (inclusive) range of cells the region covers, clamped
+//       to the grid.  For shrink tests regions that only touch the left or
+//       top edge of the passed in region count as well, so the range starts
+//       one texel further left/up.  Returns false if the region is empty or
+//       outside the grid.
+//-----------------------------------------------------------------------------
+bool RegionGrid::GetCellRange(Region const &region, bool shrinkTest,
+                              long &firstColumn, long &lastColumn,
+                              long &firstRow,    long &lastRow) const
+{
+    long const kExtend = shrinkTest ? 1L : 0L;
+    long const kLeft   = (std::max)(0L, region.mLeft - kExtend);
+    long const kTop    = (std::max)(0L, region.mTop  - kExtend);
+
+    if ((region.mRight <= kLeft) || (region.mBottom <= kTop))
+        return false;
+
+    firstColumn = kLeft / mCellSize;
+    firstRow    = kTop  / mCellSize;
+    lastColumn  = (std::min)(mNumColumns - 1, (region.mRight  - 1) / mCellSize);
+    lastRow     = (std::min)(mNumRows    - 1, (region.mBottom - 1) / mCellSize);
+
+    return (firstColumn <= lastColumn) && (firstRow <= lastRow);
+}
@@ -0,0 +1,56 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: RegionGrid.h
+// Desc: Header file for RegionGrid class
+//-----------------------------------------------------------------------------
+
+#ifndef REGIONGRID_H
+#define REGIONGRID_H
+
+#include <vector>
+
+class Region;
+
+//-----------------------------------------------------------------------------
+// Name: RegionGrid
+// Desc: Spatial index over the used regions of an atlas: a uniform grid of
+//       square buckets covering the atlas.  Each region is listed in every
+//       bucket it overlaps, so an intersection query only has to look at
+//       the regions in the buckets the query region covers instead of at
+//       all regions of the atlas.
+//       The grid does not own the regions.
+//-----------------------------------------------------------------------------
+class RegionGrid
+{
+public:
+    enum
+    {
+        kMaxCellsPerSide = 64,
+        kMinCellSize     = 16,
+    };
+
+public:
+    RegionGrid(long width, long height);
+    ~RegionGrid();
+
+    void            Insert(Region const *pRegion);
+    void            Remove(Region const *pRegion);
+    Region const *  Intersects(Region const &region, bool shrinkTest) const;
+    void            GetCandidates(Region const &area, std::vector<Region const *> &candidates) const;
+
+private:
+    bool            GetCellRange(Region const &region, bool shrinkTest,
+                                 long &firstColumn, long &lastColumn,
+                                 long &firstRow,    long &lastRow) const;
+
+private:
+    long                                        mCellSize;
+    long                                        mNumColumns;
+    long                                        mNumRows;
+    std::vector< std::vector<Region const *> >  mCells;
+};
+
+#endif // REGIONGRID_H
@@ -0,0 +1,163 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: SourceStream.cpp
+// Desc: Implementation of the SourceStream class
+//-----------------------------------------------------------------------------
+
+#include <assert.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "SourceStream.h"
+#include "CmdLineOptions.h"
+#include "TextureObject.h"
+#include "ThreadPool.h"
+
+//-----------------------------------------------------------------------------
+// Name: SourceStream()
+// Desc: Constructor: starts decoding the first window textures right away,
+//       on as many workers as there are cores, but no more than window
+//-----------------------------------------------------------------------------
+SourceStream::SourceStream(CmdLineOptionCollection const &options, TTexture2DPtrVector const &textures, int window)
+    : mOptions(options)
+    , mTextures(textures)
+    , mWindow((std::max)(window, 1))
+    , mStates(textures.size(), STATE_QUEUED)
+    , mNextToDecode(0)
+    , mNumInFlight(0)
+    , mbQuit(false)
+{
+    int const kNumWorkers = (std::min)((std::min)(mWindow, ThreadPool::GetDefaultNumThreads()),
+                                       static_cast<int>(textures.size()));
+    for (int i = 0; i < kNumWorkers; ++i)
+        mWorkers.push_back(std::thread(&SourceStream::WorkerMain, this));
+}
+
+//-----------------------------------------------------------------------------
+// Name: ~SourceStream()
+// Desc: Destructor: stops and joins the workers, and frees the texels of
+//       the textures that were decoded but not released
+//-----------------------------------------------------------------------------
+SourceStream::~SourceStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mbQuit = true;
+    }
+    mRoomAvailable.notify_all();
+
+    std::vector<std::thread>::iterator iterWorker;
+    for (iterWorker = mWorkers.begin(); iterWorker != mWorkers.end(); ++iterWorker)
+        iterWorker->join();
+
+    for (size_t i = 0; i < mStates.size(); ++i)
+        if (mStates[i] == STATE_READY)
+            mTextures[i]->ReleaseImage();
+}
+
+//-----------------------------------------------------------------------------
+// Name: Acquire()
+// Desc: Waits until the i-th texture is decoded and returns it, or returns
+//       nullptr if it could not be decoded
+//-----------------------------------------------------------------------------
+Texture2D * SourceStream::Acquire(int i)
+{
+    assert((i >= 0) && (i < static_cast<int>(mStates.size())));
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDecoded.wait(lock, [this, i] { return (mStates[i] == STATE_READY) || (mStates[i] == STATE_FAILED); });
+
+    return (mStates[i] == STATE_READY) ? mTextures[i] : nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Name: Release()
+// Desc: Frees the texels of the i-th texture, which Acquire() returned, so
+//       the next texture can be decoded in its place
+//-----------------------------------------------------------------------------
+void SourceStream::Release(int i)
+{
+    assert((i >= 0) && (i < static_cast<int>(mStates.size())));
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        assert((mStates[i] == STATE_READY) || (mStates[i] == STATE_FAILED));
+        if (mStates[i] == STATE_READY)
+            mTextures[i]->ReleaseImage();
+        mStates[i] = STATE_RELEASED;
+        --mNumInFlight;
+    }
+    mRoomAvailable.notify_one();
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetWindow()
+// Desc: returns the number of textures -stream lets be decoded at once,
+//       0 if textures are not streamed
+//-----------------------------------------------------------------------------
+int SourceStream::GetWindow(CmdLineOptionCollection const &options)
+{
+    int window = 0;
+    if (options.IsSet(CLO_STREAM) && ! options.IsSet(CLO_VOLUME))
+        sscanf_s(options.GetArgument(CLO_STREAM, 0), "%i", &window);
+    return window;
+}
+
+//-----------------------------------------------------------------------------
+// Name: WorkerMain()
+// Desc: What each worker thread runs: decode the next texture in order as
+//       soon as the window has room for it
+//-----------------------------------------------------------------------------
+void SourceStream::WorkerMain()
+{
+    int const kNumTextures = static_cast<int>(mTextures.size());
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        mRoomAvailable.wait(lock, [this, kNumTextures]
+            { return mbQuit || ((mNextToDecode < kNumTextures) && (mNumInFlight < mWindow)); });
+        if (mbQuit || (mNextToDecode >= kNumTextures))
+            return;
+
+        int const kIndex = mNextToDecode++;
+        ++mNumInFlight;
+        mStates[kIndex] = STATE_DECODING;
+
+        lock.unlock();
+        bool const kDecoded = Decode(mTextures[kIndex]);
+        lock.lock();
+
+        mStates[kIndex] = kDecoded ? STATE_READY : STATE_FAILED;
+        mDecoded.notify_all();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: Decode()
+// Desc: Loads the texels of the texture, and makes sure they are still what
+//       the layout was made for
+//-----------------------------------------------------------------------------
+bool SourceStream::Decode(Texture2D *pTexture) const
+{
+    long const      kWidth  = pTexture->GetWidth();
+    long const      kHeight = pTexture->GetHeight();
+    D3DFORMAT const kFormat = pTexture->GetFormat();
+    int const       kLevels = pTexture->GetLevelCount();
+
+    if (FAILED(pTexture->LoadTexture(mOptions)))
+        return false;
+
+    if (   (pTexture->GetWidth() != kWidth) || (pTexture->GetHeight() != kHeight)
+        || (pTexture->GetFormat() != kFormat) || (pTexture->GetLevelCount() != kLevels))
+    {
+        fprintf_s(stderr, "*** Error: Texture %s does not match its file header.\n", pTexture->GetFilename());
+        pTexture->ReleaseImage();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: SourceStream.h
+// Desc: Header file for SourceStream class
+//-----------------------------------------------------------------------------
+
+#ifndef SOURCESTREAM_H
+#define SOURCESTREAM_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "TATypes.h"
+
+class CmdLineOptionCollection;
+
+//-----------------------------------------------------------------------------
+// Name: SourceStream
+// Desc: Decodes a list of textures ahead of their use, on worker threads,
+//       so that at most window of them are decoded (or being decoded) and
+//       not yet released at any time (-stream).  The textures have to be
+//       taken in order: Acquire(i) waits for the i-th texture to be
+//       decoded, Release(i) frees its texels again and makes room for the
+//       next one.  The textures keep their size, format and level count,
+//       which the layout was made from (see Texture2D::ProbeTexture()).
+//-----------------------------------------------------------------------------
+class SourceStream
+{
+public:
+    SourceStream(CmdLineOptionCollection const &options, TTexture2DPtrVector const &textures, int window);
+    ~SourceStream();
+
+    Texture2D * Acquire(int i);
+    void        Release(int i);
+
+    static int  GetWindow(CmdLineOptionCollection const &options);
+
+private:
+    enum eState
+    {
+        STATE_QUEUED = 0,
+        STATE_DECODING,
+        STATE_READY,
+        STATE_FAILED,
+        STATE_RELEASED,
+    };
+
+    void WorkerMain();
+    bool Decode(Texture2D *pTexture) const;
+
+private:
+    CmdLineOptionCollection const & mOptions;
+    TTexture2DPtrVector const &     mTextures;
+    int const                       mWindow;
+
+    std::vector<std::thread>        mWorkers;
+    std::mutex                      mMutex;
+    std::condition_variable         mRoomAvailable;     // for the workers
+    std::condition_variable         mDecoded;           // for Acquire()
+
+    std::vector<eState>             mStates;
+    int                             mNextToDecode;
+    int                             mNumInFlight;       // decoding or decoded, not yet released
+    bool                            mbQuit;
+};
+
+#endif // SOURCESTREAM_H
@@ -21,7 +21,7 @@
 #include <map>
 #include <vector>
 
-#include <d3d9.h> 
+#include "HeadlessTypes.h"
 
 
 class Texture2D;
@@ -30,6 +30,14 @@ class AtlasObject;
 enum {
     kFilenameLength    = 256,
     kPrintStringLength = 512,
+
+    // atlas size limits used when there is no device to ask for its caps
+    kDefaultMaxTextureSize  = 16384,
+    kDefaultMaxVolumeExtent = 2048,
+
+    // -margin auto: each texture gets the margin its mip-maps need, see
+    // Packer2D::GetMargin()
+    kAutoMargin = -1,
 };
 
 typedef std::vector<Texture2D *>                          TTexture2DPtrVector;
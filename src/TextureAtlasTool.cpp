@@ -40,6 +40,8 @@
 #include "CmdLineOptions.h"
 #include "TextureObject.h"
 #include "AtlasContainer.h"
+#include "LayoutSearch.h"
+#include "ThreadPool.h"
 
 
 //-----------------------------------------------------------------------------
@@ -59,9 +61,9 @@ static void PrintVersion()
 // Name: main()
 // Desc: Entry point to the program. It parses all cmd-line options 
 //       and fills a command structure w/ all this data.
-//       Then creates a d3dapp oject that has reference to a d3d device 
-//       and uses that device to create, load, and save textures,
-//       particularly texture atlases.
+//       Then creates a d3dapp oject that creates a d3d device once the
+//       textures need to be decoded, and uses that device to load them,
+//       then creates and saves texture atlases.
 //-----------------------------------------------------------------------------
 int main( int argc, char **argv )
 {
@@ -74,10 +76,6 @@ int main( int argc, char **argv )
     CMyD3DApplication d3dApp;
     g_pApp  = &d3dApp;
 
-    InitCommonControls();
-    if (FAILED(d3dApp.Create(nullptr)))
-        return 0;
-
     bool const kResult = d3dApp.CreateTextureAtlases(options);
     d3dApp.CleanShutdown();
 
@@ -100,6 +98,7 @@ CMyD3DApplication::CMyD3DApplication()
     m_d3dEnumeration.AppUsesDepthBuffer = TRUE;
 	m_bStartFullscreen			        = false;
 	m_bShowCursorWhenFullscreen	        = false;
+    m_bCreateMultithreadDevice          = true;     // textures are decoded on worker threads
 }
 
 
@@ -119,8 +118,25 @@ CMyD3DApplication::~CMyD3DApplication()
 //-----------------------------------------------------------------------------
 void CMyD3DApplication::CleanShutdown()
 {
-    // Close the window, which shuts down the app
-    SendMessage( m_hWnd, WM_CLOSE, 0, 0 );
+    // Close the window, which shuts down the app (if it was ever created)
+    if (m_hWnd != nullptr)
+        SendMessage( m_hWnd, WM_CLOSE, 0, 0 );
+}
+
+//-----------------------------------------------------------------------------
+// Name: CreateDevice()
+// Desc: Creates the window and the d3d device the first time it is called.
+//       Only decoding textures needs the device (D3DX), so -taionly runs 
+//       that lay out all textures from their headers never create it.
+//       Returns false if the device could not be created.
+//-----------------------------------------------------------------------------
+bool CMyD3DApplication::CreateDevice()
+{
+    if (m_pd3dDevice != nullptr)
+        return true;
+
+    InitCommonControls();
+    return SUCCEEDED(Create(nullptr));
 }
 
 //-----------------------------------------------------------------------------
@@ -489,11 +505,11 @@ HRESULT CMyD3DApplication::Create( HINSTANCE hInstance)
 //       All options/info is stored in the options parameter.
 //       Returns false if errors occur.
 //-----------------------------------------------------------------------------
-bool CMyD3DApplication::CreateTextureAtlases(CmdLineOptionCollection const &options) const
+bool CMyD3DApplication::CreateTextureAtlases(CmdLineOptionCollection const &options)
 {
     bool retValue = true;
 
-    // Create an array of texture objects and load the filenames/textures into that array.
+    // Create an array of texture objects for the files matching the filenames/search patterns.
     int const   kNumTextures = options.GetNumFilenames();
     char const *pFilename = nullptr;
     int         i;
@@ -505,6 +521,13 @@ bool CMyD3DApplication::CreateTextureAtlases(CmdLineOptionCollection const &opti
     Texture2D* pFindTex2D = nullptr;
     std::string findPath;
 
+    bool const kHeadersOnly = options.IsSet(CLO_TAIONLY) && ! options.IsSet(CLO_VOLUME);
+    bool const kStreamed    = options.IsSet(CLO_STREAM)  && ! options.IsSet(CLO_VOLUME);
+
+    // -taionly: the device is only created if a texture has to be decoded
+    if ((! kHeadersOnly) && (! CreateDevice()))
+        return false;
+
     bool fileFound = false;
     for (i = 0; i < kNumTextures; ++i)
     {
@@ -522,14 +545,6 @@ bool CMyD3DApplication::CreateTextureAtlases(CmdLineOptionCollection const &opti
             {
                 pFindTex2D = new Texture2D();
                 pFindTex2D->Init(m_pd3dDevice, (findPath + "\\" + ffd.cFileName));
-
-                if (FAILED(pFindTex2D->LoadTexture(options)))
-                {
-                    delete pFindTex2D;
-                    retValue = false;
-                    break;
-                }
-
                 sourceTexs.push_back(pFindTex2D);
             }
 
@@ -537,12 +552,57 @@ bool CMyD3DApplication::CreateTextureAtlases(CmdLineOptionCollection const &opti
             fileFound = ::FindNextFile(hFind, &ffd);
         }
 
-        if (retValue == false)
-            break;
+        if (hFind != INVALID_HANDLE_VALUE)
+            ::FindClose(hFind);
+    }
+
+    // Load the textures on all cores.  Each task only touches its own 
+    // texture and result, and sourceTexs stays in the order the files were
+    // found in, so the sort and the layout below do not depend on the 
+    // number of threads or on which decode finishes first.
+    ThreadPool                  pool;
+    std::vector<HRESULT>        loadResults(sourceTexs.size(), S_OK);
+    pool.Run(static_cast<int>(sourceTexs.size()), [&](int k)
+    {
+        // -taionly and -stream: the layout only needs the sizes and
+        // formats, which most file headers have; decode only the others
+        // (-stream: and free them again, they are decoded once more 
+        // when copied into their atlas)
+        if (   (kHeadersOnly || kStreamed)
+            && SUCCEEDED(sourceTexs[k]->ProbeTexture(options)))
+            return;
+
+        if (m_pd3dDevice == nullptr)
+        {
+            loadResults[k] = E_PENDING;
+            return;
+        }
+
+        loadResults[k] = sourceTexs[k]->LoadTexture(options);
+        if (kStreamed && SUCCEEDED(loadResults[k]))
+            sourceTexs[k]->ReleaseImage();
+    });
+
+    // -taionly: decode the textures the headers did not tell enough about,
+    // w/ a device created here, on the thread that owns its window.  All
+    // textures get the device, so all atlases honor its caps.  If it cannot
+    // be created, those textures stay failed.
+    if (   (std::find(loadResults.begin(), loadResults.end(), E_PENDING) != loadResults.end())
+        && CreateDevice())
+    {
+        for (auto pTex2D : sourceTexs)
+            pTex2D->SetDevice(m_pd3dDevice);
+
+        pool.Run(static_cast<int>(sourceTexs.size()), [&](int k)
+        {
+            if (loadResults[k] == E_PENDING)
+                loadResults[k] = sourceTexs[k]->LoadTexture(options);
+        });
     }
 
-    if (hFind != INVALID_HANDLE_VALUE)
-        ::FindClose(hFind);
+    for (size_t k = 0; k < loadResults.size(); ++k)
+        if (FAILED(loadResults[k]))
+            retValue = false;
 
     if (retValue == true)
     {
@@ -553,8 +613,9 @@ bool CMyD3DApplication::CreateTextureAtlases(CmdLineOptionCollection const &opti
             formatMap[pTex2D->GetFormat()].push_back(pTex2D);
         }
 
-        // We do not do format conversions, so all these different formats 
-        // require their own atlases.  Each format may have multiple atlases, e.g., 
+        // Only -format converts uncompressed textures to one format, and DXTn
+        // ones to one DXTn format (see Texture2D::LoadTexture()), otherwise all
+        // these different formats require their own atlases.  Each format may have multiple atlases, e.g., 
         // there is not enough space in a single atlas for all textures of the 
         // same format.  An atlas container contains all these concepts.
         AtlasContainer   atlas(options, formatMap.size());
@@ -565,27 +626,64 @@ bool CMyD3DApplication::CreateTextureAtlases(CmdLineOptionCollection const &opti
             std::sort(fmSort.second.begin(), fmSort.second.end(), Texture2DGreater());
         }
 
-        // For each format-vector of textures, insert them into their respective atlas vector:
+        // -margin auto: the packers size each texture's margin
         LONG margin = 0;
         if (options.IsSet(CLO_MARGIN))
-            sscanf_s(options.GetArgument(CLO_MARGIN, 0), "%i", &margin);
+        {
+            if (_strcmpi(options.GetArgument(CLO_MARGIN, 0), "auto") == 0)
+                margin = kAutoMargin;
+            else
+                sscanf_s(options.GetArgument(CLO_MARGIN, 0), "%i", &margin);
+        }
 
-        TNewFormatMap::const_iterator fmIter;
-        for (i = 0, fmIter = formatMap.begin(); fmIter != formatMap.end(); ++fmIter, ++i)
+        // -bestof: try several packers and texture orders for each format-vector 
+        // on the texture sizes only, then pack for real w/ the best of them
+        std::vector<char const *> packerNames(formatMap.size(), nullptr);
+        if (options.IsSet(CLO_BESTOF) && (! options.IsSet(CLO_VOLUME)))
         {
-            atlas.Insert(i, fmIter->second, margin);
+            long atlasWidth, atlasHeight;
+            Atlas2D::GetMaxSize(options, m_pd3dDevice, atlasWidth, atlasHeight);
+
+            LayoutSearch    search(options, margin, atlasWidth, atlasHeight);
+            TNewFormatMap::iterator fmSearchIter;
+            for (i = 0, fmSearchIter = formatMap.begin(); fmSearchIter != formatMap.end(); ++fmSearchIter, ++i)
+            {
+                search.Run(fmSearchIter->second, pool);
+                packerNames[i] = search.GetPackerName();
+            }
         }
 
-        // Done inserting data: shrink all atlases to minimum size
-        atlas.Shrink();
+        // For each format-vector of textures, insert them into their respective atlas vector.
+        // The formats do not share atlases, so they are all laid out at once; the atlases
+        // are numbered once all are done, so their filenames do not depend on timing.
+        std::vector<TTexture2DPtrVector const *> formatVectors;
+        TNewFormatMap::const_iterator fmIter;
+        for (fmIter = formatMap.begin(); fmIter != formatMap.end(); ++fmIter)
+        {
+            formatVectors.push_back(&fmIter->second);
+        }
 
-        // Write all atlases to disk w/ the filenames they have stored
-        atlas.WriteToDisk();
+        pool.Run(static_cast<int>(formatVectors.size()), [&](int k)
+        {
+            atlas.Insert(k, *formatVectors[k], margin, packerNames[k]);
+        });
+        atlas.NumberAtlases();
+        atlas.PrintStatistics();
+
+        // Done laying out: shrink all atlases to minimum size, then copy
+        // each texture into its atlas, and write all atlases to disk w/ the
+        // filenames they have stored; each atlas is written as soon as it is
+        // filled (-taionly: there are no texels to write; -stream: one atlas
+        // at a time)
+        if (kHeadersOnly)
+            atlas.Shrink();
+        else
+            atlas.ShrinkAndWriteToDisk(kStreamed);
 
         // Save the Texture Atlas Info (tai) file.
         // For each original texture read-out where it landed up
         // and write that into the tai file.
-        retValue = CreateTAIFile(options, formatMap, margin);
+        retValue = CreateTAIFile(options, formatMap);
     }
 
     // free all memory
@@ -599,8 +697,7 @@ bool CMyD3DApplication::CreateTextureAtlases(CmdLineOptionCollection const &opti
 }
 
 bool CMyD3DApplication::CreateTAIFile(CmdLineOptionCollection const &options, 
-                                      TNewFormatMap const           &formatMap,
-                                      LONG margin) const
+                                      TNewFormatMap const           &formatMap) const
 {
     // write the tai header 
     char     fname[kFilenameLength];
@@ -626,7 +723,8 @@ bool CMyD3DApplication::CreateTAIFile(CmdLineOptionCollection const &options,
                 fprintf( fp, " %s", options.GetArgument(static_cast<eCmdLineOptionType>(i), j));    
         }
     fprintf( fp, "\n#\n");
-    fprintf( fp, "# <filename>\t\t<atlas filename>, <atlas idx>, <atlas type>, <woffset>, <hoffset>, <depth offset>, <width>, <height>\n#\n" );
+    fprintf( fp, "# <filename>\t\t<atlas filename>, <atlas idx>, <atlas type>, <woffset>, <hoffset>, <depth offset>, <width>, <height>%s\n#\n",
+             options.IsSet(CLO_ROTATE) ? ", <rotated>" : "" );
     fprintf( fp, "# Texture <filename> can be found in texture atlas <atlas filename>, i.e., \n");
     fprintf( fp, "# %s<idx>.dds of <atlas type> type with texture coordinates boundary given by:\n", options.GetArgument(CLO_OUTFILE, 0));
     fprintf( fp, "#   A = ( <woffset>, <hoffset> )\n" );
@@ -635,6 +733,11 @@ bool CMyD3DApplication::CreateTAIFile(CmdLineOptionCollection const &options,
     fprintf( fp, "# to coordinates A and B, respectively, in the texture atlas.\n" );
     fprintf( fp, "# If the atlas is a volume texture then <depth offset> is the w-coordinate\n" );
     fprintf( fp, "# to use the access the appropriate slice in the volume atlas.\n" );
+    if (options.IsSet(CLO_ROTATE))
+    {
+        fprintf( fp, "# If <rotated> is 1 then the texture is stored transposed: texture\n" );
+        fprintf( fp, "# coordinates (u,v) map to (v,u) of the region from A to B.\n" );
+    }
     fprintf( fp, "\n" );
 
     // go through each texture and convert coordinates and write out the data
@@ -659,7 +762,7 @@ bool CMyD3DApplication::CreateTAIFile(CmdLineOptionCollection const &options,
     {
         for (texIter = (fmIter->second).begin(); texIter != (fmIter->second).end(); ++texIter)
         {
-            (*texIter)->WriteTAILine(options, fp, margin);
+            (*texIter)->WriteTAILine(options, fp);
         }
     }
 
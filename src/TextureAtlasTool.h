@@ -37,12 +37,12 @@ public:
 
     virtual HRESULT Create( HINSTANCE hInstance);
     void            CleanShutdown();
-    bool            CreateTextureAtlases(CmdLineOptionCollection const &options) const;
+    bool            CreateTextureAtlases(CmdLineOptionCollection const &options);
 
 private:
+    bool CreateDevice();
     bool CreateTAIFile(CmdLineOptionCollection const &options, 
-                       TNewFormatMap           const &formatMap,
-                       LONG margin) const;
+                       TNewFormatMap           const &formatMap) const;
 
 protected:
     virtual HRESULT Render();
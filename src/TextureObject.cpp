@@ -17,10 +17,20 @@
 
 #include <stdio.h>
 #include <assert.h>
+#include <string.h>
+#include <math.h>
+
+#include <d3dx9.h>
 
 #include "TextureObject.h"
 #include "CmdLineOptions.h"
+#include "DXTCompressor.h"
+#include "FormatConverter.h"
+#include "MipGenerator.h"
 #include "Packer.h"
+#include "ImageProbe.h"
+#include "SourceStream.h"
+#include "ThreadPool.h"
 
 #pragma warning(push)
 #pragma warning(disable : 26812) // unscoped enum
@@ -54,6 +64,15 @@ IDirect3DDevice9 * TextureObject::GetDevice() const
     return mpD3DDev;
 }
 
+//-----------------------------------------------------------------------------
+// Name: SetDevice()
+// Desc: Sets the d3d device, for objects initialized before there was one
+//-----------------------------------------------------------------------------
+void TextureObject::SetDevice(IDirect3DDevice9 *pD3d)
+{
+    mpD3DDev = pD3d;
+}
+
 //-----------------------------------------------------------------------------
 // Name: GetFilename()
 // Desc: Return a pointer to the filename stored
@@ -75,7 +94,7 @@ TextureObject::eTextureType TextureObject::GetType() const
 //-----------------------------------------------------------------------------
 // Name: Init()
 // Desc: initializes the innards of the object
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 void TextureObject::Init(IDirect3DDevice9 *pD3d, const std::string& pFilename)
 {
     assert(mType != TEXTYPE_UNINITIALIZED);
@@ -86,7 +105,7 @@ void TextureObject::Init(IDirect3DDevice9 *pD3d, const std::string& pFilename)
 //-----------------------------------------------------------------------------
 // Name: PrintError()
 // Desc: Prints and error to stderr
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 void TextureObject::PrintError(char const * pText) const
 {
     fprintf(stderr, "*** Error: %s\n", pText); 
@@ -116,7 +135,25 @@ AtlasObject::~AtlasObject()
 // Desc: Base class implementation simply does nothing: it's valid and a good
 //       fallback.
 //-----------------------------------------------------------------------------
-void AtlasObject::Shrink()
+void AtlasObject::Shrink(ThreadPool &pool)
+{
+    UNREFERENCED_PARAMETER(pool);
+}
+
+//-----------------------------------------------------------------------------
+// Name: PrintStatistics()
+// Desc: Base class implementation has nothing to report.
+//-----------------------------------------------------------------------------
+void AtlasObject::PrintStatistics() const
+{
+    ;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ReleaseImage()
+// Desc: Base class implementation keeps its texels.
+//-----------------------------------------------------------------------------
+void AtlasObject::ReleaseImage()
 {
     ;
 }
@@ -139,14 +176,29 @@ int AtlasObject::GetId() const
     return mAtlasId;
 }
 
+//-----------------------------------------------------------------------------
+// Name: SetId()
+// Desc: Sets the atlas id, and the filename that goes w/ it: the -o name 
+//       followed by the id.
+//-----------------------------------------------------------------------------
+void AtlasObject::SetId(CmdLineOptionCollection const &options, int id)
+{
+    mAtlasId = id;
+    sprintf_s(mFilename, "%s%d.dds", options.GetArgument(CLO_OUTFILE, 0), id);
+    mpFilename = mFilename;
+}
+
 //-----------------------------------------------------------------------------
 // Name: Texture2D()
 // Desc: Constructor for class: set everything to good defaults 
 //-----------------------------------------------------------------------------
 Texture2D::Texture2D()
-    : mpTexture2D(NULL)
-    , mpAtlas(NULL)
+    : mpAtlas(NULL)
     , mOffset()
+    , mWidth(0)
+    , mHeight(0)
+    , mFormat(D3DFMT_UNKNOWN)
+    , mLevels(0)
 {
     mType = TEXTYPE_2D;
 }
@@ -154,23 +206,19 @@ Texture2D::Texture2D()
 //-----------------------------------------------------------------------------
 // Name: ~Texture2D()
 // Desc: Destructor for class: clean stuff up
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 Texture2D::~Texture2D()
 { 
-    if (mpTexture2D != nullptr)
-        mpTexture2D->Release();
+    ;
 }
 
 //-----------------------------------------------------------------------------
 // Name: GetFormat()
 // Desc: returns the format of the currently loaded texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 D3DFORMAT Texture2D::GetFormat() const
 {
-	D3DSURFACE_DESC     desc;
-	mpTexture2D->GetLevelDesc(0, &desc);
-
-    return desc.Format;
+    return mFormat;
 }
 
 //-----------------------------------------------------------------------------
@@ -179,10 +227,10 @@ D3DFORMAT Texture2D::GetFormat() const
 //       The list of supported formats are essentially all formats that we 
 //       currently know how to deal with, ie they have a known size.  
 //       It is a fail-safe mechansim to not have to deal w/ unknown 4CC codes.
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 bool Texture2D::IsSupportedFormat(D3DFORMAT format) const
 {
-    switch (format)
+    switch (static_cast<DWORD>(format))
     {
 		case D3DFMT_R8G8B8:		
 		case D3DFMT_A8R8G8B8:	
@@ -222,6 +270,8 @@ bool Texture2D::IsSupportedFormat(D3DFORMAT format) const
 		case D3DFMT_DXT3:		
 		case D3DFMT_DXT4:		
 		case D3DFMT_DXT5:		
+		case D3DFMT_ATI1:
+		case D3DFMT_ATI2:
 		case D3DFMT_R16F:		
 		case D3DFMT_G16R16F:	
 		case D3DFMT_A16B16G16R16F:
@@ -238,50 +288,37 @@ bool Texture2D::IsSupportedFormat(D3DFORMAT format) const
 //-----------------------------------------------------------------------------
 // Name: GetNumTexels()
 // Desc: returns the number of texels in this texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 long Texture2D::GetNumTexels() const
 {
-	D3DSURFACE_DESC     desc;
-    assert(mpTexture2D != nullptr);
-	mpTexture2D->GetLevelDesc(0, &desc);
-
-    return desc.Width * desc.Height;
+    return mWidth * mHeight;
 }
 
 //-----------------------------------------------------------------------------
 // Name: GetWidth()
 // Desc: returns the width of the texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 long Texture2D::GetWidth() const
 {
-	D3DSURFACE_DESC     desc;
-    assert(mpTexture2D != nullptr);
-	mpTexture2D->GetLevelDesc(0, &desc);
-
-    return desc.Width;
+    return mWidth;
 }
 
 //-----------------------------------------------------------------------------
 // Name: GetHeight()
 // Desc: returns the height of the texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 long Texture2D::GetHeight() const
 {
-	D3DSURFACE_DESC     desc;
-    assert(mpTexture2D != nullptr);
-	mpTexture2D->GetLevelDesc(0, &desc);
-
-    return desc.Height;
+    return mHeight;
 }
 
 //-----------------------------------------------------------------------------
-// Name: GetD3DTexture()
-// Desc: returns the internal d3d texture
-//-----------------------------------------------------------------------------~
-IDirect3DTexture9*  Texture2D::GetD3DTexture() const
+// Name: GetLevelCount()
+// Desc: returns the number of mip-levels of the texture
+//-----------------------------------------------------------------------------
+int Texture2D::GetLevelCount() const
 {
-    assert(mpTexture2D != nullptr);
-	return mpTexture2D;
+    return mLevels;
 }
 
 //-----------------------------------------------------------------------------
@@ -289,21 +326,51 @@ IDirect3DTexture9*  Texture2D::GetD3DTexture() const
 // Desc: loads the textureinto memory according to the given options
 //       If all goes well and as expected returns S_OK, otherwise
 //       the error that occured.
-//-----------------------------------------------------------------------------~
+//       D3DX is only used to decode the file (and generate missing mips):
+//       the texels are copied into the device independent mImage right away
+//       (converted to the -format one if set) and the d3d texture is 
+//       released again.  -mipfilter: only the base level is, though the 
+//       texture still has all levels as far as the layout is concerned.
+//-----------------------------------------------------------------------------
 HRESULT Texture2D::LoadTexture(CmdLineOptionCollection const &options)
 {
     assert(mpD3DDev != nullptr); 
 
+    IDirect3DTexture9  *pTexture2D = nullptr;
+
     // We always force max number of mip-levels: hopefully the texture-author provided them!
     // Note: D3DX does the right thing and only generates the ones that do not exist.
     // Unless -nomipmap was spec'd: in that case we force everything to one surface only
 
-    UINT const      kMipLevels = (options.IsSet(CLO_NOMIPMAP)) ? 1 : 0;
-    HRESULT const   hr = D3DXCreateTextureFromFileEx(mpD3DDev, mpFilename.c_str(),
-                                                 D3DX_DEFAULT, D3DX_DEFAULT, kMipLevels, 
-                                                 0, D3DFMT_UNKNOWN, D3DPOOL_SYSTEMMEM, 
-                                                 D3DX_DEFAULT, D3DX_DEFAULT, 0, nullptr, nullptr, 
-                                                 &mpTexture2D);
+    // -mipfilter: only the base level is decoded, the atlas makes the others
+    // (see Atlas2D::GenerateMipMaps()), unless its texels cannot be filtered
+    MipGenerator::eFilter   filter;
+    bool                    gamma;
+    bool                    baseOnly = MipGenerator::GetFilter(options, &filter, &gamma);
+
+    auto const Decode = [&](UINT mipLevels)
+    {
+        return D3DXCreateTextureFromFileEx(mpD3DDev, mpFilename.c_str(),
+                                           D3DX_DEFAULT, D3DX_DEFAULT, mipLevels, 
+                                           0, D3DFMT_UNKNOWN, D3DPOOL_SYSTEMMEM, 
+                                           D3DX_DEFAULT, D3DX_DEFAULT, 0, nullptr, nullptr, 
+                                           &pTexture2D);
+    };
+
+    UINT const  kMipLevels = (options.IsSet(CLO_NOMIPMAP) || baseOnly) ? 1 : 0;
+    HRESULT     hr = Decode(kMipLevels);
+    if ((hr == D3D_OK) && baseOnly)
+    {
+        D3DSURFACE_DESC baseDesc;
+        pTexture2D->GetLevelDesc(0, &baseDesc);
+        if (! MipGenerator::CanFilter(FormatConverter::GetConvertedFormat(options, baseDesc.Format)))
+        {
+            pTexture2D->Release();
+            pTexture2D = nullptr;
+            baseOnly   = false;
+            hr         = Decode(0);
+        }
+    }
 	if (hr != D3D_OK)
     {
         char string[kPrintStringLength];
@@ -313,24 +380,196 @@ HRESULT Texture2D::LoadTexture(CmdLineOptionCollection const &options)
     }
 
     // Can only pack 2D textures of known types
-    if ( (mpTexture2D->GetType() != D3DRTYPE_TEXTURE) || (! IsSupportedFormat(GetFormat())))
+    D3DSURFACE_DESC     desc;
+    pTexture2D->GetLevelDesc(0, &desc);
+    if ( (pTexture2D->GetType() != D3DRTYPE_TEXTURE) || (! IsSupportedFormat(desc.Format)))
     {
         fprintf_s( stderr, "*** Error: Texture %s has unsupported format.\n", mpFilename.c_str());
+        pTexture2D->Release();
         return E_FAIL;
     }
 
+    // -format: texels of other uncompressed formats are converted as they are copied,
+    // DXTn blocks are transcoded if all of them can be w/o loss
+    D3DFORMAT const kFormat = GetLoadedFormat(options, pTexture2D, desc.Format);
+
+    if (! mImage.Create(kFormat, desc.Width, desc.Height, 1, pTexture2D->GetLevelCount()))
+    {
+        char string[kPrintStringLength];
+        sprintf_s(string, "Out of memory loading texture %s.", mpFilename.c_str());
+        PrintError(string);
+        pTexture2D->Release();
+        return E_OUTOFMEMORY;
+    }
+
+    for (int level = 0; level < mImage.GetLevelCount(); ++level)
+    {
+        D3DLOCKED_RECT  lockedRect;
+        HRESULT const   hrLock = pTexture2D->LockRect( level, &lockedRect, nullptr, D3DLOCK_READONLY );
+        assert(hrLock == S_OK);
+        UNREFERENCED_PARAMETER(hrLock);
+
+        UCHAR const *srcPtr = reinterpret_cast<UCHAR const *>(lockedRect.pBits);
+        for (long row = 0; row < mImage.GetNumRows(level); ++row)
+        {
+            if (kFormat == desc.Format)
+                memcpy( mImage.GetRow(level, row), srcPtr, mImage.GetRowBytes(level) );
+            else if (ImageBuffer::IsDXTnFormat(kFormat))
+                FormatConverter::TranscodeRow( desc.Format, srcPtr, kFormat, mImage.GetRow(level, row), (mImage.GetWidth(level) + 3)/4 );
+            else
+                FormatConverter::ConvertRow( desc.Format, srcPtr, kFormat, mImage.GetRow(level, row), mImage.GetWidth(level) );
+            srcPtr += lockedRect.Pitch;
+        }
+        pTexture2D->UnlockRect( level );
+    }
+    pTexture2D->Release();
+
+    // -mipfilter: as many levels as D3DX would have made
+    mWidth  = mImage.GetWidth();
+    mHeight = mImage.GetHeight();
+    mFormat = mImage.GetFormat();
+    mLevels = mImage.GetLevelCount();
+    if (baseOnly)
+        for (long size = (std::max)(mWidth, mHeight); size > 1; size >>= 1)
+            ++mLevels;
+    return S_OK;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetLoadedFormat()
+// Desc: Returns the format LoadTexture() stores the texels of pTexture2D
+//       in: the -format one (see FormatConverter::GetConvertedFormat()),
+//       except that DXTn textures keep their own format unless every block
+//       of every level can be transcoded exactly.
+//-----------------------------------------------------------------------------
+D3DFORMAT Texture2D::GetLoadedFormat(CmdLineOptionCollection const &options, 
+                                     IDirect3DTexture9 *pTexture2D, D3DFORMAT format) const
+{
+    D3DFORMAT const kFormat = FormatConverter::GetConvertedFormat(options, format);
+    if ((kFormat == format) || ! ImageBuffer::IsDXTnFormat(kFormat))
+        return kFormat;
+
+    bool exact = true;
+    for (DWORD level = 0; exact && (level < pTexture2D->GetLevelCount()); ++level)
+    {
+        D3DSURFACE_DESC desc;
+        pTexture2D->GetLevelDesc(level, &desc);
+
+        D3DLOCKED_RECT  lockedRect;
+        HRESULT const   hrLock = pTexture2D->LockRect( level, &lockedRect, nullptr, D3DLOCK_READONLY );
+        assert(hrLock == S_OK);
+        UNREFERENCED_PARAMETER(hrLock);
+
+        UCHAR const *srcPtr = reinterpret_cast<UCHAR const *>(lockedRect.pBits);
+        for (UINT row = 0; exact && (row < (desc.Height + 3)/4); ++row, srcPtr += lockedRect.Pitch)
+            exact = FormatConverter::TranscodeRow( format, srcPtr, kFormat, nullptr, (desc.Width + 3)/4 );
+        pTexture2D->UnlockRect( level );
+    }
+    if (exact)
+        return kFormat;
+
+    // (-stream: not again when the texture is loaded once more)
+    if (mFormat != format)
+        fprintf_s( stderr, "*** Warning: Texture %s has DXTn blocks that cannot be transcoded exactly and thus keeps its format.\n",
+                   mpFilename.c_str());
+    return format;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ReleaseImage()
+// Desc: Frees the texels; the size, format and level count are kept, so 
+//       the texture can still be laid out and written to the TAI file
+//-----------------------------------------------------------------------------
+void Texture2D::ReleaseImage()
+{
+    mImage.Release();
+}
+
+//-----------------------------------------------------------------------------
+// Name: ProbeTexture()
+// Desc: Finds out the size, format and number of mip-levels LoadTexture() 
+//       would end up w/, from the header of the file only.  Returns S_OK if
+//       all went well, otherwise the texture has to be loaded to find out.
+//       D3DX rounds the size up to powers of 2 (D3DX_DEFAULT), converts the
+//       texels to a format the device supports and generates all levels; 
+//       D3DXCheckTextureRequirements() tells what it makes of the file's.
+//       Formats every device supports as they are do not need a device to
+//       tell, see IsKeptByAnyDevice(), so w/o one only the others fail.
+//       -format then converts it as in LoadTexture(); whether DXTn blocks
+//       can be transcoded is only known from the texels, so those textures
+//       are loaded.
+//-----------------------------------------------------------------------------
+HRESULT Texture2D::ProbeTexture(CmdLineOptionCollection const &options)
+{
+    ImageInfo info;
+    if (! ImageProbe::Probe(mpFilename.c_str(), info))
+        return E_FAIL;
+
+    UINT width  = 1;
+    UINT height = 1;
+    while (width  < static_cast<UINT>(info.width))
+        width  <<= 1;
+    while (height < static_cast<UINT>(info.height))
+        height <<= 1;
+
+    UINT        levels = (options.IsSet(CLO_NOMIPMAP)) ? 1 : 0;
+    D3DFORMAT   format = info.format;
+    if (IsKeptByAnyDevice(format, static_cast<long>(width), static_cast<long>(height)))
+    {
+        if (levels == 0)
+            levels = static_cast<UINT>(ImageBuffer::GetMaxMipLevels(static_cast<long>(width), static_cast<long>(height)));
+    }
+    else if (mpD3DDev == nullptr)
+        return E_FAIL;
+    else if (D3DXCheckTextureRequirements(mpD3DDev, &width, &height, &levels, 0, &format, D3DPOOL_SYSTEMMEM) != D3D_OK)
+        return E_FAIL;
+
+    if (! IsSupportedFormat(format))
+        return E_FAIL;
+
+    D3DFORMAT const kFormat = FormatConverter::GetConvertedFormat(options, format);
+    if ((kFormat != format) && ImageBuffer::IsDXTnFormat(kFormat))
+        return E_FAIL;
+
+    mWidth  = static_cast<long>(width);
+    mHeight = static_cast<long>(height);
+    mFormat = kFormat;
+    mLevels = static_cast<int>(levels);
     return S_OK;
 }
 
 //-----------------------------------------------------------------------------
-// Name: SetAtlas()
-// Desc: Sets the atlas for this texture: set mpatlas to passed in pointer
-//       and copy offset structure
+// Name: IsKeptByAnyDevice()
+// Desc: returns true if D3DX loads a texture of the passed in format and
+//       (power of 2) size as it is on every device: the format is one all
+//       Direct3D 9 drivers support for textures, and the size is within
+//       the 4096 texels every device w/ pixel shader 3.0 supports.  DXTn
+//       textures must be at least one block large.
 //-----------------------------------------------------------------------------
-void Texture2D::SetAtlas(AtlasObject const *pAtlas, OffsetStructure const &offset)
+bool Texture2D::IsKeptByAnyDevice(D3DFORMAT format, long width, long height)
 {
-    mpAtlas = pAtlas;
-    mOffset = offset;
+    long const kMaxSize = 4096;
+    if ((width > kMaxSize) || (height > kMaxSize))
+        return false;
+
+    switch (static_cast<DWORD>(format))
+    {
+    case D3DFMT_A8R8G8B8:
+    case D3DFMT_X8R8G8B8:
+    case D3DFMT_R5G6B5:
+    case D3DFMT_X1R5G5B5:
+    case D3DFMT_A1R5G5B5:
+    case D3DFMT_A4R4G4B4:
+        return true;
+    case D3DFMT_DXT1:
+    case D3DFMT_DXT2:
+    case D3DFMT_DXT3:
+    case D3DFMT_DXT4:
+    case D3DFMT_DXT5:
+        return (width >= 4) && (height >= 4);
+    default:
+        return false;
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -338,8 +577,10 @@ void Texture2D::SetAtlas(AtlasObject const *pAtlas, OffsetStructure const &offse
 // Desc: Appends a line to passed in fp stating where in which atlas this texture
 //       ws mapped to.
 //-----------------------------------------------------------------------------
-void Texture2D::WriteTAILine(CmdLineOptionCollection const &options, FILE *fp, LONG margin) const
+void Texture2D::WriteTAILine(CmdLineOptionCollection const &options, FILE *fp) const
 {
+    LONG const margin = mOffset.margin;
+
     // if mpAtlas is nullptr then we failed to insert this texture anywhere
     // in that case spit out this texture as its own atlas
     // Note that we still apply the halftexel offset as requested.
@@ -386,7 +627,7 @@ void Texture2D::WriteTAILine(CmdLineOptionCollection const &options, FILE *fp, L
                     break;
                 kDepth  = static_cast<float>(pVolume->GetDepth());
 
-                // D3DX conveniently saves single-slice volume textures as a 2D texture...
+                // Single-slice volume textures are saved as a 2D texture (see ImageBuffer::WriteDDS)...
                 // So have to adjust for that accordingly in the tai file.
                 if (kDepth == 1)
                     pType = "2D";
@@ -409,7 +650,7 @@ void Texture2D::WriteTAILine(CmdLineOptionCollection const &options, FILE *fp, L
     {
         // Coordinate as an integer offsets within the atlas image width and height. Re-scaling the atlas images 
         // may invalidate these coordinates unless values are re-mapped to the new size.
-        fprintf(fp, "%s\t\t%s, %d, %s, %d, %d, %d, %d, %d\n",
+        fprintf(fp, "%s\t\t%s, %d, %s, %d, %d, %d, %d, %d",
             mpFilename.c_str(), (mpAtlas == nullptr) ? mpFilename.c_str() : mpAtlas->GetFilename(),
             id, pType, mOffset.uOffset, mOffset.vOffset, mOffset.slice, mOffset.width - margin, mOffset.height - margin);
     }
@@ -417,49 +658,52 @@ void Texture2D::WriteTAILine(CmdLineOptionCollection const &options, FILE *fp, L
     {
         // Coordiantes as a float offsets using normalized 0.0 - 1.0 value range. If the atlas image is re-scaled then 
         // the same coordinate is still valid as long the new atlas size has the same aspect ratio.
-        fprintf(fp, "%s\t\t%s, %d, %s, %.6f, %.6f, %.6f, %.6f, %.6f\n",
+        fprintf(fp, "%s\t\t%s, %d, %s, %.6f, %.6f, %.6f, %.6f, %.6f",
             mpFilename.c_str(), (mpAtlas == nullptr) ? mpFilename.c_str() : mpAtlas->GetFilename(),
             id, pType, uOffset, vOffset, wOffset, uWidth, vHeight);
     }
+
+    // With -rotate a texture may be stored transposed: the width and height
+    // above are then those of the atlas region, i.e., of the texture swapped,
+    // and the u and v coordinates of the texture have to be swapped as well.
+    if (options.IsSet(CLO_ROTATE))
+        fprintf(fp, ", %d", (mpAtlas != nullptr) && mOffset.rotated ? 1 : 0);
+    fprintf(fp, "\n");
 }
 
 //-----------------------------------------------------------------------------
 // Name: Atlas2D()
 // Desc: Constructor for class: set everything to good defaults 
-//       Create a suitable atlas texture.
-//-----------------------------------------------------------------------------
-Atlas2D::Atlas2D(CmdLineOptionCollection const &options, Texture2D *pTexture, int num)
+//       The atlas starts out as a layout only: textures are placed on their
+//       sizes, and the texels are only allocated and copied once the final
+//       size is known, see Shrink().
+//       The first texture sits in the top-left corner and gets no margin,
+//       unless it is kAutoMargin: that one keeps its mip-levels apart from
+//       the textures right of and below it.
+//-----------------------------------------------------------------------------
+Atlas2D::Atlas2D(CmdLineOptionCollection const &options, Texture2D *pTexture, LONG margin, int num, char const *pPackerName)
     : AtlasObject()
-    , mpTexture2D(nullptr)
+    , mpImage(nullptr)
+    , mpPacker2D(nullptr)
+    , mWidth(0)
+    , mHeight(0)
+    , mFormat(D3DFMT_UNKNOWN)
+    , mLevels(0)
+    , mpOptions(&options)
+    , mpPackerName(pPackerName)
 {
     mType = TEXTYPE_ATLAS2D;
 
-    mAtlasId = num;
-    sprintf_s(mFilename, "%s%d.dds", options.GetArgument(CLO_OUTFILE, 0), num);
+    SetId(options, num);
     Init(pTexture->GetDevice(), mFilename);
 
-    // create mpTexture2D: use pTexture's format, and some max width height
-    D3DCAPS9    caps;
-    HRESULT     hr = mpD3DDev->GetDeviceCaps(&caps);
-    assert(hr == S_OK);
-
-    int width = static_cast<int>(caps.MaxTextureWidth);
-    if (options.IsSet(CLO_WIDTH))
-        sscanf_s(options.GetArgument(CLO_WIDTH, 0), "%i", &width);
-
-    if (width > static_cast<int>(caps.MaxTextureWidth))
-        width = static_cast<int>(caps.MaxTextureWidth);
+    // lay out on pTexture's format, and some max width height.
+    GetMaxSize(options, mpD3DDev, mWidth, mHeight);
+    mFormat = pTexture->GetFormat();
 
-    int height = static_cast<int>(caps.MaxTextureHeight);
-    if (options.IsSet(CLO_HEIGHT))
-        sscanf_s(options.GetArgument(CLO_HEIGHT, 0), "%i", &height);
-    
-    if (height > static_cast<int>(caps.MaxTextureHeight))
-        height = static_cast<int>(caps.MaxTextureHeight);
-
-    int levels = 0;     // default to generate all levels, will prune later
+    mLevels = 0;     // default to generate all levels, will prune later
     if (options.IsSet(CLO_NOMIPMAP))
-        levels = 1;
+        mLevels = 1;
 
     char string[kPrintStringLength];
 
@@ -470,17 +714,9 @@ Atlas2D::Atlas2D(CmdLineOptionCollection const &options, Texture2D *pTexture, in
         return;
     }
 
-    hr = mpD3DDev->CreateTexture(width, height, levels, D3DUSAGE_DYNAMIC, pTexture->GetFormat(), D3DPOOL_SYSTEMMEM, &mpTexture2D, nullptr ); 
-    if ( hr != D3D_OK )
-    {
-        sprintf_s(string, "Unable to create atlas for texture %s.", pTexture->GetFilename());
-        PrintError(string);
-        return;
-    }
-    
-    mpPacker2D = new Packer2D(this);
+    mpPacker2D = Packer2D::Create(options, this, pPackerName);
 
-    if (! Insert(pTexture, 0))
+    if (! Insert(pTexture, (margin == kAutoMargin) ? kAutoMargin : 0))
     {
         // failed insertion: most likely due to size mis-matches
         // barf an error msg, but then continue: these textures will be left
@@ -491,27 +727,64 @@ Atlas2D::Atlas2D(CmdLineOptionCollection const &options, Texture2D *pTexture, in
     }
 }
 
+//-----------------------------------------------------------------------------
+// Name: GetMaxSize()
+// Desc: The size 2D atlases are created w/ before they are shrunk: -width 
+//       and -height if set.  The atlas lives in system memory only, but it
+//       still should not be larger than what the device could use: honor
+//       the device caps if there is a device.
+//-----------------------------------------------------------------------------
+void Atlas2D::GetMaxSize(CmdLineOptionCollection const &options, IDirect3DDevice9 *pD3DDev,
+                         long &width, long &height)
+{
+    int maxWidth  = kDefaultMaxTextureSize;
+    int maxHeight = kDefaultMaxTextureSize;
+    if (pD3DDev != nullptr)
+    {
+        D3DCAPS9        caps;
+        HRESULT const   hr = pD3DDev->GetDeviceCaps(&caps);
+        assert(hr == S_OK);
+        UNREFERENCED_PARAMETER(hr);
+
+        maxWidth  = static_cast<int>(caps.MaxTextureWidth);
+        maxHeight = static_cast<int>(caps.MaxTextureHeight);
+    }
+
+    int optionWidth = maxWidth;
+    if (options.IsSet(CLO_WIDTH))
+        sscanf_s(options.GetArgument(CLO_WIDTH, 0), "%i", &optionWidth);
+
+    if (optionWidth > maxWidth)
+        optionWidth = maxWidth;
+
+    int optionHeight = maxHeight;
+    if (options.IsSet(CLO_HEIGHT))
+        sscanf_s(options.GetArgument(CLO_HEIGHT, 0), "%i", &optionHeight);
+    
+    if (optionHeight > maxHeight)
+        optionHeight = maxHeight;
+
+    width  = optionWidth;
+    height = optionHeight;
+}
+
 //-----------------------------------------------------------------------------
 // Name: ~Atlas2D()
 // Desc: Destructor for class: clean stuff up
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 Atlas2D::~Atlas2D()
 { 
     delete mpPacker2D;
-    if (mpTexture2D != nullptr)
-        mpTexture2D->Release();
+    delete mpImage;
 }
 
 //-----------------------------------------------------------------------------
 // Name: GetFormat()
 // Desc: returns the format of the texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 D3DFORMAT Atlas2D::GetFormat() const
 {
-	D3DSURFACE_DESC     desc;
-	mpTexture2D->GetLevelDesc(0, &desc);
-
-    return desc.Format;
+    return mFormat;
 }
 
 //-----------------------------------------------------------------------------
@@ -520,10 +793,10 @@ D3DFORMAT Atlas2D::GetFormat() const
 //       The list of supported formats are essentially all formats that we 
 //       currently know how to deal with, ie they have a known size.  
 //       It is a fail-safe mechansim to not have to deal w/ unknown 4CC codes.
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 bool Atlas2D::IsSupportedFormat(D3DFORMAT format) const
 {
-    switch (format)
+    switch (static_cast<DWORD>(format))
     {
 		case D3DFMT_R8G8B8:		
 		case D3DFMT_A8R8G8B8:	
@@ -563,6 +836,8 @@ bool Atlas2D::IsSupportedFormat(D3DFORMAT format) const
 		case D3DFMT_DXT3:		
 		case D3DFMT_DXT4:		
 		case D3DFMT_DXT5:		
+		case D3DFMT_ATI1:
+		case D3DFMT_ATI2:
 		case D3DFMT_R16F:		
 		case D3DFMT_G16R16F:	
 		case D3DFMT_A16B16G16R16F:
@@ -579,66 +854,56 @@ bool Atlas2D::IsSupportedFormat(D3DFORMAT format) const
 //-----------------------------------------------------------------------------
 // Name: GetNumTexels()
 // Desc: returns the number of texels in this texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 long Atlas2D::GetNumTexels() const
 {
-	D3DSURFACE_DESC     desc;
-    assert(mpTexture2D != nullptr);
-	mpTexture2D->GetLevelDesc(0, &desc);
-
-    return desc.Width * desc.Height;
+    return mWidth * mHeight;
 }
 
 //-----------------------------------------------------------------------------
 // Name: WriteToDisk()
-// Desc: save the d3d texture into disk file w/ given filename
-//-----------------------------------------------------------------------------~
-void Atlas2D::WriteToDisk() const
+// Desc: save the texture into disk file w/ given filename
+//       Returns the number of bytes written, 0 if it failed.
+//-----------------------------------------------------------------------------
+size_t Atlas2D::WriteToDisk() const
 {
-    HRESULT const hr = D3DXSaveTextureToFile(GetFilename(), D3DXIFF_DDS,
-                                             mpTexture2D, nullptr);
-    if (hr != S_OK)
+    size_t const kNumBytes = (mpImage != nullptr) ? mpImage->WriteDDS(GetFilename()) : 0;
+    if (kNumBytes == 0)
     {
         char    string[kPrintStringLength];
         sprintf_s(string, "Unable to save atlas %s.", GetFilename());
         PrintError(string);
     }
+    return kNumBytes;
+}
+
+//-----------------------------------------------------------------------------
+// Name: ReleaseImage()
+// Desc: Frees the texels once they are written; the size is kept for the 
+//       TAI file
+//-----------------------------------------------------------------------------
+void Atlas2D::ReleaseImage()
+{
+    delete mpImage;
+    mpImage = nullptr;
 }
 
 //-----------------------------------------------------------------------------
 // Name: GetWidth()
 // Desc: returns the width of the texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 long Atlas2D::GetWidth() const
 {
-	D3DSURFACE_DESC     desc;
-    assert(mpTexture2D != nullptr);
-	mpTexture2D->GetLevelDesc(0, &desc);
-
-    return desc.Width;
+    return mWidth;
 }
 
 //-----------------------------------------------------------------------------
 // Name: GetHeight()
 // Desc: returns the height of the texture
-//-----------------------------------------------------------------------------~
-long Atlas2D::GetHeight() const
-{
-	D3DSURFACE_DESC     desc;
-    assert(mpTexture2D != nullptr);
-	mpTexture2D->GetLevelDesc(0, &desc);
-
-    return desc.Height;
-}
-
 //-----------------------------------------------------------------------------
-// Name: GetD3DTexture()
-// Desc: returns the internal d3d texture
-//-----------------------------------------------------------------------------~
-IDirect3DTexture9*  Atlas2D::GetD3DTexture() const
+long Atlas2D::GetHeight() const
 {
-    assert(mpTexture2D != nullptr);
-	return mpTexture2D;
+    return mHeight;
 }
 
 //-----------------------------------------------------------------------------
@@ -652,71 +917,469 @@ bool Atlas2D::Insert(Texture2D *pTexture, LONG margin)
     if (mpPacker2D == nullptr)
         return false;
 
-    return mpPacker2D->Insert(pTexture, margin);
+    if (! mpPacker2D->Insert(pTexture, margin))
+        return false;
+
+    mTextures.push_back(pTexture);
+    mMargins.push_back(pTexture->GetOffset().margin);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindPlacement()
+// Desc: Looks for a spot for the passed in texture w/o inserting it: return
+//       true and the spot if there is one, false otherwise.
+//-----------------------------------------------------------------------------
+bool Atlas2D::FindPlacement(Texture2D *pTexture, LONG margin, Placement &placement)
+{
+    assert(pTexture != nullptr);
+    if (mpPacker2D == nullptr)
+        return false;
+
+    return mpPacker2D->FindPlacement(pTexture->GetWidth(), pTexture->GetHeight(), margin, placement);
+}
+
+//-----------------------------------------------------------------------------
+// Name: InsertAt()
+// Desc: Inserts the passed in texture into the spot FindPlacement() found
+//-----------------------------------------------------------------------------
+void Atlas2D::InsertAt(Texture2D *pTexture, Placement const &placement)
+{
+    assert((pTexture != nullptr) && (mpPacker2D != nullptr));
+
+    mpPacker2D->InsertAt(pTexture, placement);
+    mTextures.push_back(pTexture);
+    mMargins.push_back(placement.margin);
+}
+
+//-----------------------------------------------------------------------------
+// Name: PrintStatistics()
+// Desc: Prints the packing statistics of this atlas
+//-----------------------------------------------------------------------------
+void Atlas2D::PrintStatistics() const
+{
+    if (mpPacker2D != nullptr)
+        mpPacker2D->PrintStatistics(GetFilename());
 }
 
 //-----------------------------------------------------------------------------
 // Name: Shrink()
-// Desc: Attempt to make the stored atlas smaller, ie fit it to its actually
-//       used content.
+// Desc: Fit the atlas to its actually used content, then allocate it at 
+//       that size and copy each texture's bits into it, once.
+//       The copies, mip-maps and compression run on pool, which the caller
+//       sizes to the share of the cores this atlas gets.
 //-----------------------------------------------------------------------------
-void Atlas2D::Shrink()
+void Atlas2D::Shrink(ThreadPool &pool)
 {
-    // For the mip-levels, just ask the packer what the largest 
-    // miplevel was that it had to deal with while inserting 
-    // textures.  If it is 0 something is screwy and we just punt.
-    int     newMipLevel = mpPacker2D->GetMaxMipLevels();
+    // For the mip-levels, use the largest number of levels of the textures
+    // inserted, but no more than the atlas was to have.
+    // If it is 0 something is screwy and we just punt.
+    if ((mpPacker2D == nullptr) || mTextures.empty())
+        return;
+
+    int newMipLevel = 0;
+    for (size_t i = 0; i < mTextures.size(); ++i)
+        newMipLevel = (std::max)(newMipLevel, mTextures[i]->GetLevelCount());
+    if ((mLevels > 0) && (newMipLevel > mLevels))
+        newMipLevel = mLevels;
+
     long    newWidth    = GetWidth();
     long    newHeight   = GetHeight();
-    Region  tester;
 
-    if ((newMipLevel <= 0) || (mpPacker2D == nullptr))
+    if (newMipLevel <= 0)
         return;
 
-    // horizontal shrink first:
-    // Can we get rid of the right half of the atlas?
-    tester.mTop     = 0L;
-    tester.mBottom  = newHeight;
-    bool bShrinking = true;
-    while (bShrinking && (newWidth > 1))
+    // halve the atlas as long as the cut off half is empty
+    mpPacker2D->GetShrunkSize(newWidth, newHeight);
+
+    // -minsize: if some other size takes fewer bytes, lay the textures out
+    // anew in that size
+    if (   mpOptions->IsSet(CLO_MINSIZE) 
+        && FindMinimalSize(newMipLevel, newWidth, newHeight))
+        Relayout(newWidth, newHeight);
+
+    mWidth  = newWidth;
+    mHeight = newHeight;
+
+    // -taionly: the textures may not even have been loaded
+    if (mpOptions->IsSet(CLO_TAIONLY))
+        return;
+
+    mpImage = new ImageBuffer();
+    if (! mpImage->Create(GetFormat(), newWidth, newHeight, 1, newMipLevel))
     {
-        tester.mLeft   = newWidth/2L;
-        tester.mRight  = newWidth;
+        char string[kPrintStringLength];
+        sprintf_s(string, "Unable to create atlas %s.", GetFilename());
+        PrintError(string);
 
-        if (! mpPacker2D->Intersects(tester, true))
-            newWidth   = newWidth/2L;
-        else
-            bShrinking = false;
+        delete mpImage;
+        mpImage = nullptr;
+        return;
     }
 
-    // do the same vertically
-    tester.mLeft  = 0L;
-    tester.mRight = newWidth;
-    bShrinking    = true;
-    while (bShrinking && (newHeight > 1))
+    int const kWindow = SourceStream::GetWindow(*mpOptions);
+    if (kWindow > 0)
+        BlitStreamed(pool, kWindow);
+    else
+        Blit(pool);
+
+    GenerateMipMaps(pool);
+    Compress(pool);
+}
+
+//-----------------------------------------------------------------------------
+// Name: GenerateMipMaps()
+// Desc: -mipfilter: makes the mip-levels of the atlas from the base level
+//       the textures were copied into, within the region of each texture
+//       (w/o its margin).  Atlases of textures whose texels cannot be 
+//       filtered got all levels from them (see Texture2D::LoadTexture()).
+//-----------------------------------------------------------------------------
+void Atlas2D::GenerateMipMaps(ThreadPool &pool)
+{
+    MipGenerator::eFilter   filter;
+    bool                    gamma;
+    if (   (mpImage == nullptr) || (mpImage->GetLevelCount() < 2) 
+        || ! MipGenerator::GetFilter(*mpOptions, &filter, &gamma) || ! MipGenerator::CanFilter(mpImage->GetFormat()))
+        return;
+
+    std::vector<Region> regions(mTextures.size());
+    for (size_t i = 0; i < mTextures.size(); ++i)
     {
-        tester.mTop    = newHeight/2L;
-        tester.mBottom = newHeight;
+        OffsetStructure const &offset = mTextures[i]->GetOffset();
+        regions[i].mLeft   = offset.uOffset;
+        regions[i].mTop    = offset.vOffset;
+        regions[i].mRight  = offset.uOffset + offset.width  - mMargins[i];
+        regions[i].mBottom = offset.vOffset + offset.height - mMargins[i];
+    }
 
-        if (! mpPacker2D->Intersects(tester, true))
-            newHeight  = newHeight/2L;
-        else
-            bShrinking = false;
+    MipGenerator::Generate(*mpImage, regions, filter, gamma, pool);
+}
+
+//-----------------------------------------------------------------------------
+// Name: Compress()
+// Desc: -compress: replaces the texels by their DXTn compressed version, 
+//       all mip-levels.  Atlases of compressed textures are left alone, and
+//       those that are not a multiple of 4 texels wide and high are written
+//       uncompressed.
+//-----------------------------------------------------------------------------
+void Atlas2D::Compress(ThreadPool &pool)
+{
+    D3DFORMAT               format;
+    DXTCompressor::eQuality quality;
+    if (   (mpImage == nullptr) || ! FormatConverter::CanConvertFrom(mpImage->GetFormat())
+        || ! DXTCompressor::GetTarget(*mpOptions, &format, &quality))
+        return;
+
+    if (! DXTCompressor::CanCompress(*mpImage))
+    {
+        fprintf_s( stderr, "*** Warning: Atlas %s is not a multiple of 4 texels wide and high and thus is not compressed.\n", 
+                   GetFilename() );
+        return;
     }
 
-    // Now create a new alas w/ these new dimensions and copy 
-    // all the bits from one to the other. 
-    IDirect3DTexture9* pOldAtlas = mpTexture2D;
-    HRESULT hr = mpD3DDev->CreateTexture(newWidth, newHeight, newMipLevel, D3DUSAGE_DYNAMIC, GetFormat(), D3DPOOL_SYSTEMMEM, &mpTexture2D, nullptr ); 
-    if ( hr != D3D_OK )
+    ImageBuffer *pCompressed = new ImageBuffer();
+    if (! DXTCompressor::Compress(*mpImage, format, quality, *pCompressed, pool))
+    {
+        char string[kPrintStringLength];
+        sprintf_s(string, "Out of memory compressing atlas %s.", GetFilename());
+        PrintError(string);
+
+        delete pCompressed;
         return;
-    
-    tester.mLeft   = tester.mTop = 0L;
-    tester.mRight  = newWidth;
-    tester.mBottom = newHeight;
+    }
+
+    delete mpImage;
+    mpImage = pCompressed;
+}
+
+//-----------------------------------------------------------------------------
+// Name: Blit()
+// Desc: Copies the bits of each inserted texture into its region of the
+//       atlas, on pool
+//-----------------------------------------------------------------------------
+void Atlas2D::Blit(ThreadPool &pool)
+{
+    assert(mpImage != nullptr);
 
-    mpPacker2D->CopyBits(tester, pOldAtlas, 0);
-    pOldAtlas->Release();
+    BlitBands(pool, 0, mTextures.size());
+}
+
+//-----------------------------------------------------------------------------
+// Name: BlitBands()
+// Desc: Copies the textures first up to (not including) end into the atlas.
+//       The rows of each mip-level the textures cover are cut into bands of
+//       kBlitBandRows rows (units: texels or 4x4 blocks), and each band is a
+//       task of its own that copies the parts of the textures that land in 
+//       it.  The tasks write to disjoint rows, so they need no locks, and
+//       as each band gets its textures in the order they were inserted, the
+//       atlas ends up the same as w/ one thread even where the smallest 
+//       mip-maps of neighbors overlap.  The atlas must not be lazy, else 
+//       writing a row would allocate memory (see ImageBuffer::Create()).
+//-----------------------------------------------------------------------------
+void Atlas2D::BlitBands(ThreadPool &pool, size_t first, size_t end)
+{
+    assert(mpImage != nullptr);
+
+    struct Band
+    {
+        int                 mipLevel;
+        long                firstRow;
+        long                endRow;
+        std::vector<size_t> textures;       // that have rows in the band
+    };
+
+    int const kBlockFactor = (ImageBuffer::IsDXTnFormat(mpImage->GetFormat()) ? 4 : 1);
+
+    std::vector<Band> bands;
+    for (int mipLevel = 0; mipLevel < mpImage->GetLevelCount(); ++mipLevel)
+    {
+        // the rows each texture covers at this level, as CopyBits() sees them
+        long const          div      = 1L << mipLevel;
+        long const          kNumRows = mpImage->GetNumRows(mipLevel);
+        long                firstRow = kNumRows;
+        long                endRow   = 0;
+        std::vector<long>   tops, bottoms;
+        for (size_t i = first; i < end; ++i)
+        {
+            OffsetStructure const &offset = mTextures[i]->GetOffset();
+            long const kMipHeight = (std::max)(1L, (offset.height - mMargins[i]) / div);
+            long const kTop       = (offset.vOffset / div) / kBlockFactor;
+            long const kBottom    = (std::min)(kNumRows, kTop + (kMipHeight + kBlockFactor - 1) / kBlockFactor);
+
+            tops.push_back(kTop);
+            bottoms.push_back(kBottom);
+            firstRow = (std::min)(firstRow, kTop);
+            endRow   = (std::max)(endRow,   kBottom);
+        }
+
+        size_t const kFirstBand = bands.size();
+        for (long row = firstRow; row < endRow; row += kBlitBandRows)
+        {
+            bands.push_back(Band());
+            bands.back().mipLevel = mipLevel;
+            bands.back().firstRow = row;
+            bands.back().endRow   = (std::min)(endRow, row + kBlitBandRows);
+        }
+
+        for (size_t i = first; i < end; ++i)
+        {
+            long const kTop    = tops   [i - first];
+            long const kBottom = bottoms[i - first];
+            if (kTop >= kBottom)
+                continue;
+
+            long const kLastBand = (kBottom - 1 - firstRow) / kBlitBandRows;
+            for (long band = (kTop - firstRow) / kBlitBandRows; band <= kLastBand; ++band)
+                bands[kFirstBand + band].textures.push_back(i);
+        }
+    }
+
+    pool.Run(static_cast<int>(bands.size()), [&](int k)
+    {
+        Band const &band = bands[k];
+        for (size_t j = 0; j < band.textures.size(); ++j)
+        {
+            size_t const            i      = band.textures[j];
+            OffsetStructure const & offset = mTextures[i]->GetOffset();
+
+            Region target;
+            target.mLeft   = offset.uOffset;
+            target.mTop    = offset.vOffset;
+            target.mRight  = offset.uOffset + offset.width;
+            target.mBottom = offset.vOffset + offset.height;
+
+            mpPacker2D->CopyBits(target, mTextures[i]->GetImage(), mMargins[i], offset.rotated,
+                                 band.mipLevel, band.firstRow, band.endRow);
+        }
+    });
+}
+
+//-----------------------------------------------------------------------------
+// Name: BlitStreamed()
+// Desc: Blit() for -stream: the textures are decoded on worker threads, at
+//       most window ahead of the one being copied, and freed right after 
+//       their copy.  A texture that cannot be decoded leaves its region 
+//       black.  Textures taller than a band are copied on pool.
+//-----------------------------------------------------------------------------
+void Atlas2D::BlitStreamed(ThreadPool &pool, int window)
+{
+    assert(mpImage != nullptr);
+
+    int const kBlockFactor = (ImageBuffer::IsDXTnFormat(mpImage->GetFormat()) ? 4 : 1);
+
+    SourceStream stream(*mpOptions, mTextures, window);
+    for (size_t i = 0; i < mTextures.size(); ++i)
+    {
+        Texture2D const * const pTexture = stream.Acquire(static_cast<int>(i));
+        if ((pTexture != nullptr) && (pTexture->GetOffset().height > kBlitBandRows * kBlockFactor))
+            BlitBands(pool, i, i + 1);
+        else if (pTexture != nullptr)
+        {
+            OffsetStructure const &offset = pTexture->GetOffset();
+
+            Region target;
+            target.mLeft   = offset.uOffset;
+            target.mTop    = offset.vOffset;
+            target.mRight  = offset.uOffset + offset.width;
+            target.mBottom = offset.vOffset + offset.height;
+
+            mpPacker2D->CopyBits(target, pTexture->GetImage(), mMargins[i], offset.rotated);
+        }
+        stream.Release(static_cast<int>(i));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: FindMinimalSize()
+// Desc: Searches for the atlas size that takes the fewest bytes (all of its
+//       levels, at most levels) and still holds all inserted textures.
+//       Candidate sizes are powers of 2 for -minsize pow2, and multiples of
+//       4 for -minsize npot.  For each candidate width the smallest height 
+//       the textures fit into is found by bisection, between what their 
+//       area needs and the largest height that would still take fewer bytes
+//       than the best size so far.  Every test lays all textures out anew.
+//       width and height pass in the size halving arrived at; returns true
+//       if they were replaced w/ a size that takes fewer bytes.
+//-----------------------------------------------------------------------------
+bool Atlas2D::FindMinimalSize(int levels, long &width, long &height) const
+{
+    bool const      kPowerOf2       = (_strcmpi(mpOptions->GetArgument(CLO_MINSIZE, 0), "pow2") == 0);
+    bool const      kAllowRotation  = mpOptions->IsSet(CLO_ROTATE);
+    long const      kMaxWidthSteps  = 64;       // npot widths tried at most
+    D3DFORMAT const kFormat         = GetFormat();
+
+    // candidate sizes are numbered: index i stands for 2^i or 4*i texels
+    auto ToSize  = [kPowerOf2](long index) { return kPowerOf2 ? (1L << index) : 4L * index; };
+    auto ToIndex = [kPowerOf2](long size)       // index of the smallest size >= size
+    {
+        long index = kPowerOf2 ? 0L : 1L;
+        if (kPowerOf2)
+            while ((1L << index) < size)
+                ++index;
+        else
+            index = (std::max)(index, (size + 3L) / 4L);
+        return index;
+    };
+
+    // every texture needs its own extent (or w/ -rotate its shorter side) 
+    // in both directions, and all of them together at least their area; the
+    // packers only add the margin to the right of and below a texture
+    long        minWidth  = 1;
+    long        minHeight = 1;
+    long long   area      = 0;
+    for (size_t i = 0; i < mTextures.size(); ++i)
+    {
+        long const kWidth  = mTextures[i]->GetWidth()  + mMargins[i];
+        long const kHeight = mTextures[i]->GetHeight() + mMargins[i];
+        long const kShort  = (std::min)(kWidth, kHeight);
+
+        minWidth   = (std::max)(minWidth,  kAllowRotation ? kShort : kWidth);
+        minHeight  = (std::max)(minHeight, kAllowRotation ? kShort : kHeight);
+        area      += static_cast<long long>(kWidth) * kHeight;
+    }
+
+    size_t  bestBytes   = ImageBuffer::GetSizeInBytes(kFormat, width, height, levels);
+    bool    bFound      = false;
+
+    long const kFirstWidth = ToIndex(minWidth);
+    long const kLastWidth  = ToIndex(GetWidth() + 1) - 1;
+    long const kWidthStep  = (std::max)(1L, (kLastWidth - kFirstWidth + kMaxWidthSteps) / kMaxWidthSteps);
+    long const kLastHeight = ToIndex(GetHeight() + 1) - 1;
+
+    for (long w = kFirstWidth; w <= kLastWidth; w += kWidthStep)
+    {
+        long const kWidth      = ToSize(w);
+        long const kAreaHeight = static_cast<long>((area + kWidth - 1) / kWidth);
+
+        long const kLowest = ToIndex((std::max)(minHeight, kAreaHeight));
+        long low  = kLowest;
+        long high = kLastHeight;
+        if (   (low > high) 
+            || (ImageBuffer::GetSizeInBytes(kFormat, kWidth, ToSize(low), levels) >= bestBytes))
+            continue;
+
+        // largest height that still takes fewer bytes than the best size so far
+        while (low < high)
+        {
+            long const kMiddle = (low + high + 1) / 2;
+            if (ImageBuffer::GetSizeInBytes(kFormat, kWidth, ToSize(kMiddle), levels) < bestBytes)
+                low  = kMiddle;
+            else
+                high = kMiddle - 1;
+        }
+        low = kLowest;
+
+        // smallest height the textures fit into
+        if (! FitsInto(kWidth, ToSize(high)))
+            continue;
+        while (low < high)
+        {
+            long const kMiddle = (low + high) / 2;
+            if (FitsInto(kWidth, ToSize(kMiddle)))
+                high = kMiddle;
+            else
+                low  = kMiddle + 1;
+        }
+
+        width     = kWidth;
+        height    = ToSize(high);
+        bestBytes = ImageBuffer::GetSizeInBytes(kFormat, width, height, levels);
+        bFound    = true;
+    }
+    return bFound;
+}
+
+//-----------------------------------------------------------------------------
+// Name: FitsInto()
+// Desc: returns true if all inserted textures fit into an atlas of the 
+//       passed in size, laid out w/ the same packer and in the same order
+//-----------------------------------------------------------------------------
+bool Atlas2D::FitsInto(long width, long height) const
+{
+    AtlasDesc desc;
+    desc.width  = width;
+    desc.height = height;
+    desc.format = GetFormat();
+    desc.mipMaps = ! mpOptions->IsSet(CLO_NOMIPMAP);
+
+    char const *pName = mpPackerName;
+    if (pName == nullptr)
+        pName = mpOptions->IsSet(CLO_PACKER) ? mpOptions->GetArgument(CLO_PACKER, 0) : "grid";
+
+    Packer2D    *pPacker = Packer2D::Create(pName, mpOptions->IsSet(CLO_ROTATE), desc);
+    bool        bFits    = true;
+    for (size_t i = 0; bFits && (i < mTextures.size()); ++i)
+    {
+        Region  placed;
+        bool    bRotated;
+        bFits = pPacker->Place(mTextures[i]->GetWidth(), mTextures[i]->GetHeight(), mMargins[i], placed, bRotated);
+    }
+    delete pPacker;
+    return bFits;
+}
+
+//-----------------------------------------------------------------------------
+// Name: Relayout()
+// Desc: Lays all textures out anew in an atlas of the passed in size
+//-----------------------------------------------------------------------------
+void Atlas2D::Relayout(long width, long height)
+{
+    mWidth  = width;
+    mHeight = height;
+
+    delete mpPacker2D;
+    mpPacker2D = Packer2D::Create(*mpOptions, this, mpPackerName);
+
+    for (size_t i = 0; i < mTextures.size(); ++i)
+    {
+        Placement   placement;
+        bool const  kFound = mpPacker2D->FindPlacement(mTextures[i]->GetWidth(), mTextures[i]->GetHeight(), 
+                                                       mMargins[i], placement);
+        assert(kFound);      // FitsInto() laid out the very same way
+        UNREFERENCED_PARAMETER(kFound);
+
+        mpPacker2D->InsertAt(mTextures[i], placement);
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -725,26 +1388,33 @@ void Atlas2D::Shrink()
 //-----------------------------------------------------------------------------
 AtlasVolume::AtlasVolume(CmdLineOptionCollection const &options, Texture2D *pTexture, int num)
     : AtlasObject()
-    , mpTextureVolume(NULL)
+    , mpImage(nullptr)
+    , mpPackerVolume(nullptr)
 {
     mType = TEXTYPE_ATLASVOLUME;
 
-    mAtlasId = num;
-    sprintf_s(mFilename, "%s%d.dds", options.GetArgument(CLO_OUTFILE, 0), num);
+    SetId(options, num);
     Init(pTexture->GetDevice(), mFilename);
 
-    // create mpTextureVolume: use pTexture's format, and some max width height
-    D3DCAPS9    caps;
-    HRESULT     hr = mpD3DDev->GetDeviceCaps(&caps);
-    assert(hr == S_OK);
+    // create mpImage: use pTexture's format, and some max width height
+    int maxDepth = kDefaultMaxVolumeExtent;
+    if (mpD3DDev != nullptr)
+    {
+        D3DCAPS9        caps;
+        HRESULT const   hr = mpD3DDev->GetDeviceCaps(&caps);
+        assert(hr == S_OK);
+        UNREFERENCED_PARAMETER(hr);
+
+        maxDepth = static_cast<int>(caps.MaxVolumeExtent);
+    }
 
     int         width  = pTexture->GetWidth();
     int         height = pTexture->GetHeight();
-    int         depth = static_cast<int>(caps.MaxVolumeExtent);
+    int         depth  = maxDepth;
     if (options.IsSet(CLO_DEPTH))
         sscanf_s(options.GetArgument(CLO_DEPTH, 0), "%i", &depth);
-    if (depth > static_cast<int>(caps.MaxVolumeExtent))
-        depth = static_cast<int>(caps.MaxVolumeExtent);
+    if (depth > maxDepth)
+        depth = maxDepth;
 
     int const levels = 1;     // volume maps can only use one mipmap
     assert(options.IsSet(CLO_NOMIPMAP));
@@ -758,8 +1428,9 @@ AtlasVolume::AtlasVolume(CmdLineOptionCollection const &options, Texture2D *pTex
         return;
     }
 
-    hr = mpD3DDev->CreateVolumeTexture(width, height, depth, levels, D3DUSAGE_DYNAMIC, pTexture->GetFormat(), D3DPOOL_SYSTEMMEM, &mpTextureVolume, nullptr ); 
-    if ( hr != D3D_OK )
+    // lazy: only the slices filled take memory
+    mpImage = new ImageBuffer();
+    if (! mpImage->Create(pTexture->GetFormat(), width, height, depth, levels, true))
     {
         sprintf_s(string, "Unable to create atlas for texture %s.", pTexture->GetFilename());
         PrintError(string);
@@ -783,24 +1454,21 @@ AtlasVolume::AtlasVolume(CmdLineOptionCollection const &options, Texture2D *pTex
 //-----------------------------------------------------------------------------
 // Name: ~AtlasVolume()
 // Desc: Destructor for class: clean stuff up
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 AtlasVolume::~AtlasVolume()
 { 
     delete mpPackerVolume;
-    if (mpTextureVolume != nullptr)
-        mpTextureVolume->Release();
+    delete mpImage;
 }
 
 //-----------------------------------------------------------------------------
 // Name: GetFormat()
 // Desc: returns the format of the texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 D3DFORMAT AtlasVolume::GetFormat() const
 {
-	D3DVOLUME_DESC     desc;
-	mpTextureVolume->GetLevelDesc(0, &desc);
-
-    return desc.Format;
+    assert(mpImage != nullptr);
+    return mpImage->GetFormat();
 }
 
 //-----------------------------------------------------------------------------
@@ -809,7 +1477,7 @@ D3DFORMAT AtlasVolume::GetFormat() const
 //       The list of supported formats are essentially all formats that we 
 //       currently know how to deal with, ie they have a known size.  
 //       It is a fail-safe mechansim to not have to deal w/ unknown 4CC codes.
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 bool AtlasVolume::IsSupportedFormat(D3DFORMAT format) const
 {
     switch (format)
@@ -835,14 +1503,11 @@ bool AtlasVolume::IsSupportedFormat(D3DFORMAT format) const
 //-----------------------------------------------------------------------------
 // Name: GetNumTexels()
 // Desc: returns the number of texels in this texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 long AtlasVolume::GetNumTexels() const
 {
-	D3DVOLUME_DESC     desc;
-    assert(mpTextureVolume != nullptr);
-	mpTextureVolume->GetLevelDesc(0, &desc);
-
-    return desc.Width * desc.Height * desc.Depth;
+    assert(mpImage != nullptr);
+    return mpImage->GetWidth() * mpImage->GetHeight() * mpImage->GetDepth();
 }
 
 //-----------------------------------------------------------------------------
@@ -863,10 +1528,15 @@ bool AtlasVolume::Insert(Texture2D *pTexture, LONG margin)
 // Name: Shrink()
 // Desc: shrink the d3d volume texture to the minimum number of slices required 
 //       to store all data
-//-----------------------------------------------------------------------------~
-void AtlasVolume::Shrink()
+//-----------------------------------------------------------------------------
+void AtlasVolume::Shrink(ThreadPool &pool)
 {
-    IDirect3DVolumeTexture9*    pOldAtlas = mpTextureVolume;
+    UNREFERENCED_PARAMETER(pool);
+
+    if (mpPackerVolume == nullptr)
+        return;
+
+    ImageBuffer *pOldAtlas = mpImage;
 
     // compute remainder of log2(depth): 
     // if it is 0 then depth is a power of 2, and thus legal, else bump it to next power of 2
@@ -876,81 +1546,53 @@ void AtlasVolume::Shrink()
     int const   kPowerOf2Depth = (kRemainder == 0.0f) ? mpPackerVolume->GetSlicesUsed() 
                                                       : static_cast<const int>(pow(2, static_cast<int>(kLog2)+1));
 
-    HRESULT hr = mpD3DDev->CreateVolumeTexture(GetWidth(), GetHeight(),  kPowerOf2Depth, 
-                                               1, D3DUSAGE_DYNAMIC, GetFormat(), 
-                                               D3DPOOL_SYSTEMMEM, &mpTextureVolume, nullptr ); 
-    if ( hr != D3D_OK )
+    mpImage = new ImageBuffer();
+    if (! mpImage->Create(pOldAtlas->GetFormat(), pOldAtlas->GetWidth(), pOldAtlas->GetHeight(), kPowerOf2Depth, 1))
     {
-        mpTextureVolume = pOldAtlas;
+        delete mpImage;
+        mpImage = pOldAtlas;
         return;
     }
-    mpPackerVolume->CopyBits(pOldAtlas);
-    pOldAtlas->Release();
+    mpPackerVolume->CopyVolumeBits(*pOldAtlas);
+    delete pOldAtlas;
 }
 
 //-----------------------------------------------------------------------------
 // Name: WriteToDisk()
-// Desc: save the d3d texture into disk file w/ given filename
-//-----------------------------------------------------------------------------~
-void AtlasVolume::WriteToDisk() const
+// Desc: save the texture into disk file w/ given filename
+//       (single slice volumes end up as a 2D texture in the file)
+//       Returns the number of bytes written, 0 if it failed.
+//-----------------------------------------------------------------------------
+size_t AtlasVolume::WriteToDisk() const
 {
-    HRESULT const hr = D3DXSaveTextureToFile(GetFilename(), D3DXIFF_DDS,
-                                             mpTextureVolume, nullptr);
-    if (hr != S_OK)
+    size_t const kNumBytes = mpImage->WriteDDS(GetFilename());
+    if (kNumBytes == 0)
     {
         char    string[kPrintStringLength];
         sprintf_s(string, "Unable to save atlas %s.", GetFilename());
         PrintError(string);
     }
+    return kNumBytes;
 }
 
 //-----------------------------------------------------------------------------
 // Name: GetWidth()
 // Desc: returns the width of the texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 long AtlasVolume::GetWidth() const
 {
-	D3DVOLUME_DESC     desc;
-    assert(mpTextureVolume != nullptr);
-	mpTextureVolume->GetLevelDesc(0, &desc);
-
-    return desc.Width;
+    assert(mpImage != nullptr);
+    return mpImage->GetWidth();
 }
 
 //-----------------------------------------------------------------------------
 // Name: GetHeight()
 // Desc: returns the height of the texture
-//-----------------------------------------------------------------------------~
-long AtlasVolume::GetHeight() const
-{
-	D3DVOLUME_DESC     desc;
-    assert(mpTextureVolume != nullptr);
-	mpTextureVolume->GetLevelDesc(0, &desc);
-
-    return desc.Height;
-}
-
-//-----------------------------------------------------------------------------
-// Name: GetDepth()
-// Desc: returns the depth of the volume-texture
-//-----------------------------------------------------------------------------~
-long AtlasVolume::GetDepth() const
-{
-	D3DVOLUME_DESC     desc;
-    assert(mpTextureVolume != nullptr);
-	mpTextureVolume->GetLevelDesc(0, &desc);
-
-    return desc.Depth;
-}
-
 //-----------------------------------------------------------------------------
-// Name: GetD3DTexture()
-// Desc: returns the pointer to the D3d volume texture
-//-----------------------------------------------------------------------------~
-IDirect3DVolumeTexture9*  AtlasVolume::GetD3DTexture() const
+long AtlasVolume::GetHeight() const
 {
-    assert(mpTextureVolume != nullptr);
-    return mpTextureVolume;
+    assert(mpImage != nullptr);
+    return mpImage->GetHeight();
 }
 
 //-----------------------------------------------------------------------------
@@ -959,7 +1601,7 @@ IDirect3DVolumeTexture9*  AtlasVolume::GetD3DTexture() const
 //-----------------------------------------------------------------------------
 AtlasCube::AtlasCube(CmdLineOptionCollection const &options, Texture2D * /*pTexture*/, int /*num*/)
     : AtlasObject()
-    , mpTextureCube(NULL)
+    , mpImage(nullptr)
 {
     UNREFERENCED_PARAMETER(options);
     mType = TEXTYPE_ATLASCUBE;
@@ -968,23 +1610,20 @@ AtlasCube::AtlasCube(CmdLineOptionCollection const &options, Texture2D * /*pText
 //-----------------------------------------------------------------------------
 // Name: ~AtlasCube()
 // Desc: Destructor for class: clean stuff up
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 AtlasCube::~AtlasCube()
 { 
-    if (mpTextureCube != nullptr)
-        mpTextureCube->Release();
+    delete mpImage;
 }
 
 //-----------------------------------------------------------------------------
 // Name: GetFormat()
 // Desc: returns the format of the texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 D3DFORMAT AtlasCube::GetFormat() const
 {
-	D3DSURFACE_DESC     desc;
-	mpTextureCube->GetLevelDesc(0, &desc);
-
-    return desc.Format;
+    assert(mpImage != nullptr);
+    return mpImage->GetFormat();
 }
 
 //-----------------------------------------------------------------------------
@@ -993,10 +1632,10 @@ D3DFORMAT AtlasCube::GetFormat() const
 //       The list of supported formats are essentially all formats that we 
 //       currently know how to deal with, ie they have a known size.  
 //       It is a fail-safe mechansim to not have to deal w/ unknown 4CC codes.
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 bool AtlasCube::IsSupportedFormat(D3DFORMAT format) const
 {
-    switch (format)
+    switch (static_cast<DWORD>(format))
     {
 		case D3DFMT_A8R8G8B8:	
 		case D3DFMT_X8R8G8B8:	
@@ -1014,6 +1653,8 @@ bool AtlasCube::IsSupportedFormat(D3DFORMAT format) const
 		case D3DFMT_DXT3:			
 		case D3DFMT_DXT4:			
 		case D3DFMT_DXT5:			
+		case D3DFMT_ATI1:
+		case D3DFMT_ATI2:
 		case D3DFMT_L16:			
             break;
         default:
@@ -1025,14 +1666,11 @@ bool AtlasCube::IsSupportedFormat(D3DFORMAT format) const
 //-----------------------------------------------------------------------------
 // Name: GetNumTexels()
 // Desc: returns the number of texels in this texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 long AtlasCube::GetNumTexels() const
 {
-	D3DSURFACE_DESC     desc;
-    assert(mpTextureCube != nullptr);
-	mpTextureCube->GetLevelDesc(0, &desc);
-
-    return desc.Width * desc.Height * 6;
+    assert(mpImage != nullptr);
+    return mpImage->GetWidth() * mpImage->GetHeight() * 6;
 }
 
 
@@ -1051,43 +1689,38 @@ bool AtlasCube::Insert(Texture2D * pTexture, LONG /*margin*/)
 //-----------------------------------------------------------------------------
 // Name: WriteToDisk()
 // Desc: save the d3d texture into disk file w/ given filename
-//-----------------------------------------------------------------------------~
-void AtlasCube::WriteToDisk() const
+//       Returns the number of bytes written, 0 if it failed.
+//-----------------------------------------------------------------------------
+size_t AtlasCube::WriteToDisk() const
 {
-    HRESULT const hr = D3DXSaveTextureToFile(GetFilename(), D3DXIFF_DDS,
-                                             mpTextureCube, nullptr);
-    if (hr != S_OK)
+    size_t const kNumBytes = (mpImage != nullptr) ? mpImage->WriteDDS(GetFilename()) : 0;
+    if (kNumBytes == 0)
     {
         char    string[kPrintStringLength];
         sprintf_s(string, "Unable to save atlas %s.", GetFilename());
         PrintError(string);
     }
+    return kNumBytes;
 }
 
 //-----------------------------------------------------------------------------
 // Name: GetWidth()
 // Desc: returns the width of the texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 long AtlasCube::GetWidth() const
 {
-	D3DSURFACE_DESC     desc;
-    assert(mpTextureCube != nullptr);
-	mpTextureCube->GetLevelDesc(0, &desc);
-
-    return desc.Width;
+    assert(mpImage != nullptr);
+    return mpImage->GetWidth();
 }
 
 //-----------------------------------------------------------------------------
 // Name: GetHeight()
 // Desc: returns the height of the texture
-//-----------------------------------------------------------------------------~
+//-----------------------------------------------------------------------------
 long AtlasCube::GetHeight() const
 {
-	D3DSURFACE_DESC     desc;
-    assert(mpTextureCube != nullptr);
-	mpTextureCube->GetLevelDesc(0, &desc);
-
-    return desc.Height;
+    assert(mpImage != nullptr);
+    return mpImage->GetHeight();
 }
 
 #pragma warning(pop)
@@ -17,17 +17,18 @@
 #ifndef TEXTUREOBJECT_H
 #define TEXTUREOBJECT_H
 
+#include <algorithm>
+#include <assert.h>
 #include <string>
-#include <d3dx9.h>
-//#include <d3d9.h>
-//#include <d3d9types.h>
-//#include "DX9SDKSampleFramework/d3dx9_compatibility.h"
 
 #include "TATypes.h"
+#include "ImageBuffer.h"
 
 class CmdLineOptionCollection;
+class ThreadPool;
 class Packer2D;
 class PackerVolume;
+struct Placement;
 
 //-----------------------------------------------------------------------------
 // Name: OffsetStructure
@@ -40,7 +41,9 @@ struct OffsetStructure
     long   vOffset;
     long   width;
     long   height;
+    long   margin;          // right and bottom, included in width and height
     long   slice;
+    bool   rotated;         // stored transposed: width and height are swapped
 };
 
 //-----------------------------------------------------------------------------
@@ -75,6 +78,7 @@ public:
     eTextureType        GetType()     const;
 
     void Init(IDirect3DDevice9 *pD3d, const std::string& pFilename);
+    void SetDevice(IDirect3DDevice9 *pD3d);
 
 protected:
     void PrintError(char const * pText) const;
@@ -104,19 +108,34 @@ public:
     
     virtual long        GetWidth()  const;
     virtual long        GetHeight() const;
+    int                 GetLevelCount() const;
 
     HRESULT             LoadTexture(CmdLineOptionCollection const &options);
-    void                SetAtlas(AtlasObject const *pAtlas, OffsetStructure const &offset);
+    HRESULT             ProbeTexture(CmdLineOptionCollection const &options);
+    void                ReleaseImage();
+    void                SetAtlas(AtlasObject const *pAtlas, OffsetStructure const &offset)
+                            { mpAtlas = pAtlas; mOffset = offset; }
 
-    IDirect3DTexture9*  GetD3DTexture()                                                const;
-    void                WriteTAILine(CmdLineOptionCollection const &options, FILE *fp, LONG margin) const;
+    ImageBuffer const & GetImage() const { assert(mImage.IsCreated()); return mImage; }
+    void                WriteTAILine(CmdLineOptionCollection const &options, FILE *fp) const;
 
     AtlasObject const* GetAtlas() const { return mpAtlas; }
+    OffsetStructure const & GetOffset() const { return mOffset; }
 
 private:
-    IDirect3DTexture9*          mpTexture2D;
+    static bool         IsKeptByAnyDevice(D3DFORMAT format, long width, long height);
+    D3DFORMAT           GetLoadedFormat(CmdLineOptionCollection const &options, 
+                                        IDirect3DTexture9 *pTexture2D, D3DFORMAT format) const;
+
+    ImageBuffer                 mImage;             // not created if only probed or released
     AtlasObject const *         mpAtlas;
     OffsetStructure             mOffset;
+
+    // what the texture will be once loaded, see ProbeTexture()
+    long                        mWidth;
+    long                        mHeight;
+    D3DFORMAT                   mFormat;
+    int                         mLevels;
 };
 
 //-----------------------------------------------------------------------------
@@ -135,12 +154,15 @@ public:
     virtual long        GetNumTexels()               const = 0;
 
     virtual bool Insert(Texture2D *pTexture, LONG margin) = 0;
-    virtual void Shrink();
-    virtual void WriteToDisk() const = 0;
+    virtual void Shrink(ThreadPool &pool);
+    virtual void PrintStatistics() const;
+    virtual size_t WriteToDisk() const = 0;
+    virtual void ReleaseImage();
     virtual long GetWidth()    const = 0;
     virtual long GetHeight()   const = 0;
 
     int          GetId()       const;
+    void         SetId(CmdLineOptionCollection const &options, int id);
     char const * GetFilename() const;
 
 protected:
@@ -153,28 +175,64 @@ protected:
 // Desc: Derived class representing 2D Atlases.
 //       Most notably it stores a pointer to a Packer2D object so it 
 //       knows how to deal w/ insertions.
+//       Insertions only lay the textures out.  The texels are allocated at
+//       the final size, and each texture is copied in once, by Shrink().
+//       With -stream the textures are decoded only for that copy, a few at
+//       a time (see SourceStream).
 //-----------------------------------------------------------------------------
 class Atlas2D : public AtlasObject
 {
 public:
-    Atlas2D(CmdLineOptionCollection const &options, Texture2D *pTexture, int num);
+    Atlas2D(CmdLineOptionCollection const &options, Texture2D *pTexture, LONG margin, int num, char const *pPackerName = nullptr);
     virtual ~Atlas2D();
 
+    static void         GetMaxSize(CmdLineOptionCollection const &options, IDirect3DDevice9 *pD3DDev,
+                                   long &width, long &height);
+
     virtual D3DFORMAT   GetFormat()                  const;
     virtual bool        IsSupportedFormat(D3DFORMAT) const;
     virtual long        GetNumTexels()               const;
 
     virtual bool        Insert(Texture2D *pTexture, LONG margin);
-    virtual void        Shrink();
-    virtual void        WriteToDisk() const;
+    virtual void        Shrink(ThreadPool &pool);
+    virtual void        PrintStatistics() const;
+    virtual size_t      WriteToDisk() const;
+    virtual void        ReleaseImage();
     virtual long        GetWidth()    const;
     virtual long        GetHeight()   const;
 
-    IDirect3DTexture9*  GetD3DTexture() const;
+    bool                FindPlacement(Texture2D *pTexture, LONG margin, Placement &placement);
+    void                InsertAt(Texture2D *pTexture, Placement const &placement);
+
+    ImageBuffer &       GetImage() const { assert(mpImage != nullptr); return *mpImage; }
+
+private:
+    bool                FindMinimalSize(int levels, long &width, long &height) const;
+    bool                FitsInto(long width, long height) const;
+    void                Relayout(long width, long height);
+    void                Blit(ThreadPool &pool);
+    void                BlitBands(ThreadPool &pool, size_t first, size_t end);
+    void                BlitStreamed(ThreadPool &pool, int window);
+    void                GenerateMipMaps(ThreadPool &pool);
+    void                Compress(ThreadPool &pool);
 
 private:
-    IDirect3DTexture9*          mpTexture2D;
+    enum
+    {
+        kBlitBandRows = 64,             // units (texels or 4x4 blocks)
+    };
+
+    ImageBuffer *               mpImage;                // nullptr until Shrink()
     Packer2D *                  mpPacker2D;
+    long                        mWidth;
+    long                        mHeight;
+    D3DFORMAT                   mFormat;
+    int                         mLevels;                // 0: all
+
+    CmdLineOptionCollection const * mpOptions;
+    char const *                mpPackerName;           // nullptr: the -packer option's
+    TTexture2DPtrVector         mTextures;              // inserted textures, in order, 
+    std::vector<LONG>           mMargins;               // and their margins
 };
 
 //-----------------------------------------------------------------------------
@@ -193,16 +251,16 @@ public:
     virtual long        GetNumTexels()               const;
 
     virtual bool        Insert(Texture2D *pTexture, LONG margin);
-    virtual void        Shrink();
-    virtual void        WriteToDisk() const;
+    virtual void        Shrink(ThreadPool &pool);
+    virtual size_t      WriteToDisk() const;
     virtual long        GetWidth()    const;
     virtual long        GetHeight()   const;
-            long        GetDepth()   const;
+            long        GetDepth()   const { assert(mpImage != nullptr); return mpImage->GetDepth(); }
 
-    IDirect3DVolumeTexture9*  GetD3DTexture() const;
+    ImageBuffer &       GetImage() const { assert(mpImage != nullptr); return *mpImage; }
 
 private:
-    IDirect3DVolumeTexture9*    mpTextureVolume;
+    ImageBuffer *               mpImage;
     PackerVolume *              mpPackerVolume;
 };
 
@@ -222,12 +280,12 @@ public:
     virtual long        GetNumTexels()               const;
 
     virtual bool        Insert(Texture2D *pTexture, LONG margin);
-    virtual void        WriteToDisk() const;
+    virtual size_t      WriteToDisk() const;
     virtual long        GetWidth()    const;
     virtual long        GetHeight()   const;
 
 private:
-    IDirect3DCubeTexture9*    mpTextureCube;
+    ImageBuffer *               mpImage;
 };
 
 //-----------------------------------------------------------------------------
@@ -251,6 +309,40 @@ typedef struct _TEXTURE2DGREATER
     }
 } Texture2DGreater;
 
+//-----------------------------------------------------------------------------
+// Name: Texture2DMaxSideGreater
+// Desc: struct used for sorting of Texture2D objects by their longer side, 
+//       then by area
+//-----------------------------------------------------------------------------
+typedef struct _TEXTURE2DMAXSIDEGREATER 
+{
+    bool operator()(Texture2D const *s1, Texture2D const *s2) const
+    {
+        long const kMaxSide1 = (std::max)(s1->GetWidth(), s1->GetHeight());
+        long const kMaxSide2 = (std::max)(s2->GetWidth(), s2->GetHeight());
+        if (kMaxSide1 != kMaxSide2)
+            return kMaxSide1 > kMaxSide2;
+        return s1->GetHeight()*s1->GetWidth() > s2->GetHeight()*s2->GetWidth();
+    }
+} Texture2DMaxSideGreater;
+
+//-----------------------------------------------------------------------------
+// Name: Texture2DPerimeterGreater
+// Desc: struct used for sorting of Texture2D objects by their perimeter, 
+//       then by their longer side
+//-----------------------------------------------------------------------------
+typedef struct _TEXTURE2DPERIMETERGREATER 
+{
+    bool operator()(Texture2D const *s1, Texture2D const *s2) const
+    {
+        long const kPerimeter1 = s1->GetWidth() + s1->GetHeight();
+        long const kPerimeter2 = s2->GetWidth() + s2->GetHeight();
+        if (kPerimeter1 != kPerimeter2)
+            return kPerimeter1 > kPerimeter2;
+        return (std::max)(s1->GetWidth(), s1->GetHeight()) > (std::max)(s2->GetWidth(), s2->GetHeight());
+    }
+} Texture2DPerimeterGreater;
+
 
 
-#endif TEXTUREOBJECT_H
+#endif // TEXTUREOBJECT_H
@@ -0,0 +1,133 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: ThreadPool.cpp
+// Desc: Implementation of the ThreadPool class
+//-----------------------------------------------------------------------------
+
+#include <assert.h>
+
+#include "ThreadPool.h"
+
+//-----------------------------------------------------------------------------
+// Name: ThreadPool()
+// Desc: Constructor: starts the workers.  numThreads counts the calling 
+//       thread, which works on tasks as well during Run(); 0 picks 
+//       GetDefaultNumThreads().
+//-----------------------------------------------------------------------------
+ThreadPool::ThreadPool(int numThreads)
+    : mpTask(nullptr)
+    , mNumTasks(0)
+    , mNextTask(0)
+    , mNumFinished(0)
+    , mbQuit(false)
+{
+    if (numThreads <= 0)
+        numThreads = GetDefaultNumThreads();
+
+    for (int i = 1; i < numThreads; ++i)
+        mWorkers.push_back(std::thread(&ThreadPool::WorkerMain, this));
+}
+
+//-----------------------------------------------------------------------------
+// Name: ~ThreadPool()
+// Desc: Destructor: stops and joins the workers
+//-----------------------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mbQuit = true;
+    }
+    mWorkAvailable.notify_all();
+
+    std::vector<std::thread>::iterator iterWorker;
+    for (iterWorker = mWorkers.begin(); iterWorker != mWorkers.end(); ++iterWorker)
+        iterWorker->join();
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetNumThreads()
+// Desc: returns the number of threads running tasks, the caller included
+//-----------------------------------------------------------------------------
+int ThreadPool::GetNumThreads() const
+{
+    return static_cast<int>(mWorkers.size()) + 1;
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetDefaultNumThreads()
+// Desc: One thread per hardware thread, or 1 if that is unknown
+//-----------------------------------------------------------------------------
+int ThreadPool::GetDefaultNumThreads()
+{
+    unsigned int const kHardwareThreads = std::thread::hardware_concurrency();
+    return (kHardwareThreads > 0) ? static_cast<int>(kHardwareThreads) : 1;
+}
+
+//-----------------------------------------------------------------------------
+// Name: Run()
+// Desc: Runs task(0) ... task(numTasks-1) and returns when all are done
+//-----------------------------------------------------------------------------
+void ThreadPool::Run(int numTasks, std::function<void(int)> const &task)
+{
+    if (numTasks <= 0)
+        return;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    assert(mpTask == nullptr);
+
+    mpTask       = &task;
+    mNumTasks    = numTasks;
+    mNextTask    = 0;
+    mNumFinished = 0;
+    mWorkAvailable.notify_all();
+
+    // lend a hand instead of just waiting
+    while (RunNextTask(lock))
+        ;
+    mAllDone.wait(lock, [this] { return mNumFinished == mNumTasks; });
+
+    mpTask = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// Name: WorkerMain()
+// Desc: Worker thread: runs tasks as long as there are any, sleeps otherwise
+//-----------------------------------------------------------------------------
+void ThreadPool::WorkerMain()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        mWorkAvailable.wait(lock, [this] { return mbQuit || ((mpTask != nullptr) && (mNextTask < mNumTasks)); });
+        if (mbQuit)
+            return;
+
+        RunNextTask(lock);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: RunNextTask()
+// Desc: Takes the next task, if any, and runs it w/ the mutex unlocked.
+//       Returns false if there was no task left.  lock must hold mMutex.
+//-----------------------------------------------------------------------------
+bool ThreadPool::RunNextTask(std::unique_lock<std::mutex> &lock)
+{
+    if ((mpTask == nullptr) || (mNextTask >= mNumTasks))
+        return false;
+
+    int const                       kTask = mNextTask++;
+    std::function<void(int)> const &task  = *mpTask;
+
+    lock.unlock();
+    task(kTask);
+    lock.lock();
+
+    if (++mNumFinished == mNumTasks)
+        mAllDone.notify_all();
+    return true;
+}
@@ -0,0 +1,56 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: ThreadPool.h
+// Desc: Header file for ThreadPool class
+//-----------------------------------------------------------------------------
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Name: ThreadPool
+// Desc: A fixed set of worker threads that run numbered tasks: Run(n, task)
+//       calls task(0) ... task(n-1), spread over the workers and the calling
+//       thread, and returns once all of them are done.  Which thread runs 
+//       which task is not defined, so tasks must only write to data of 
+//       their own (e.g., the n-th element of a result vector).
+//       Run() must not be called from within a task.
+//-----------------------------------------------------------------------------
+class ThreadPool
+{
+public:
+    ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+
+    int  GetNumThreads() const;
+    void Run(int numTasks, std::function<void(int)> const &task);
+
+    static int GetDefaultNumThreads();
+
+private:
+    void WorkerMain();
+    bool RunNextTask(std::unique_lock<std::mutex> &lock);
+
+private:
+    std::vector<std::thread>            mWorkers;
+    std::mutex                          mMutex;
+    std::condition_variable             mWorkAvailable;
+    std::condition_variable             mAllDone;
+
+    std::function<void(int)> const *    mpTask;
+    int                                 mNumTasks;
+    int                                 mNextTask;
+    int                                 mNumFinished;
+    bool                                mbQuit;
+};
+
+#endif // THREADPOOL_H
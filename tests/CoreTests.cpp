@@ -0,0 +1,562 @@
+//-----------------------------------------------------------------------------
+// Contributions provided by www.RallySimFans.hu team.
+// This file is distributed under the same terms as the NVIDIA Corporation
+// texture atlas tool sources it extends (see LICENSE_NVidia_DeveloperSDK.txt).
+//
+// File: CoreTests.cpp
+// Desc: Tests of the device independent atlas core: ImageBuffer addressing,
+//       the invariants of the 2D packers, FormatConverter round trips and
+//       DXTn block compression.  Runs every group, or only the ones named
+//       on the command line; returns the number of failed checks.
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "ImageBuffer.h"
+#include "FormatConverter.h"
+#include "DXTCompressor.h"
+#include "Packer.h"
+
+namespace
+{
+
+int gNumChecks = 0;
+int gNumFailed = 0;
+
+#define CHECK(condition)                                                        \
+    do                                                                          \
+    {                                                                           \
+        ++gNumChecks;                                                           \
+        if (! (condition))                                                      \
+        {                                                                       \
+            ++gNumFailed;                                                       \
+            fprintf(stderr, "%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        }                                                                       \
+    } while (0)
+
+//-----------------------------------------------------------------------------
+// Name: TestImageBufferLayout()
+// Desc: checks the mip chain, row sizes and pitches of an image, and that
+//       every row of every slice and level has memory of its own
+//-----------------------------------------------------------------------------
+void TestImageBufferLayout(D3DFORMAT format, long width, long height, long depth)
+{
+    ImageBuffer image;
+    CHECK(image.Create(format, width, height, depth, 0));
+    CHECK(image.GetLevelCount() == ImageBuffer::GetMaxMipLevels(width, height));
+
+    int const    kBlockFactor = ImageBuffer::IsDXTnFormat(format) ? 4 : 1;
+    size_t const kTexelBits   = ImageBuffer::SizeOfTexel(format);
+
+    for (int level = 0; level < image.GetLevelCount(); ++level)
+    {
+        long const kWidth   = (std::max)(1L, width  >> level);
+        long const kHeight  = (std::max)(1L, height >> level);
+        long const kColumns = (kWidth  + kBlockFactor - 1) / kBlockFactor;
+        long const kRows    = (kHeight + kBlockFactor - 1) / kBlockFactor;
+
+        CHECK(image.GetWidth(level)  == kWidth);
+        CHECK(image.GetHeight(level) == kHeight);
+        CHECK(image.GetNumRows(level) == kRows);
+        CHECK(image.GetRowBytes(level) == static_cast<long>(kColumns * kBlockFactor * kBlockFactor * kTexelBits / 8));
+        CHECK(image.GetRowPitch(level) >= image.GetRowBytes(level));
+        CHECK(image.GetRowPitch(level) % ImageBuffer::kRowAlignment == 0);
+    }
+    if (depth == 1)
+        CHECK(image.GetSizeInBytes() == ImageBuffer::GetSizeInBytes(format, width, height, 0));
+
+    // fill every row w/ its own pattern, then read them all back
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        ImageBuffer const &kImage = image;
+        for (int level = 0; level < image.GetLevelCount(); ++level)
+            for (long slice = 0; slice < image.GetDepth(level); ++slice)
+                for (long row = 0; row < image.GetNumRows(level); ++row)
+                {
+                    UCHAR const kPattern = static_cast<UCHAR>(level * 71 + slice * 13 + row * 7 + 1);
+                    long const  kBytes   = image.GetRowBytes(level);
+
+                    if (pass == 0)
+                    {
+                        UCHAR *pRow = image.GetRow(level, row, slice);
+                        CHECK(reinterpret_cast<uintptr_t>(pRow) % ImageBuffer::kRowAlignment == 0);
+                        memset(pRow, kPattern, kBytes);
+                        continue;
+                    }
+
+                    UCHAR const *pRow = kImage.GetRow(level, row, slice);
+                    bool         same = true;
+                    for (long i = 0; i < kBytes; ++i)
+                        same = same && (pRow[i] == kPattern);
+                    CHECK(same);
+
+                    // rows of one band are one pitch apart
+                    if ((row + 1 < image.GetNumRows(level)) && ((slice * image.GetNumRows(level) + row + 1) % ImageBuffer::kBandRows != 0))
+                        CHECK(kImage.GetRow(level, row + 1, slice) - pRow == image.GetRowPitch(level));
+                }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Name: TestImageBufferLazy()
+// Desc: checks that a lazy image reads as zeros, and allocates one band of
+//       rows at a time, when a row of it is first written to
+//-----------------------------------------------------------------------------
+void TestImageBufferLazy()
+{
+    long const  kWidth  = 100;
+    long const  kHeight = 3 * ImageBuffer::kBandRows + 5;
+
+    ImageBuffer image;
+    CHECK(image.Create(D3DFMT_A8R8G8B8, kWidth, kHeight, 1, 1, true));
+    CHECK(image.GetAllocatedBytes() == 0);
+
+    ImageBuffer const &kImage = image;
+    for (long row = 0; row < kHeight; ++row)
+    {
+        UCHAR const *pRow = kImage.GetRow(0, row);
+        bool         zero = true;
+        for (long i = 0; i < image.GetRowBytes(0); ++i)
+            zero = zero && (pRow[i] == 0);
+        CHECK(zero);
+    }
+    CHECK(image.GetAllocatedBytes() == 0);
+
+    long const kRow = ImageBuffer::kBandRows + 3;
+    memset(image.GetRow(0, kRow), 0xab, image.GetRowBytes(0));
+    size_t const kBandBytes = image.GetAllocatedBytes();
+    CHECK(kBandBytes >= static_cast<size_t>(ImageBuffer::kBandRows * image.GetRowPitch(0)));
+    CHECK(kBandBytes <  static_cast<size_t>(2 * ImageBuffer::kBandRows * image.GetRowPitch(0)));
+
+    // rows of the same band take no more memory, rows of the others stay zero
+    image.GetRow(0, ImageBuffer::kBandRows);
+    CHECK(image.GetAllocatedBytes() == kBandBytes);
+    CHECK(kImage.GetRow(0, kRow)[0] == 0xab);
+    CHECK(kImage.GetRow(0, kRow + 1)[0] == 0);
+    CHECK(kImage.GetRow(0, 0)[0] == 0);
+    CHECK(kImage.GetRow(0, kHeight - 1)[0] == 0);
+
+    // the last band is a whole one too, even if the image ends inside it
+    image.GetRow(0, kHeight - 1);
+    CHECK(image.GetAllocatedBytes() == 2 * kBandBytes);
+    CHECK(image.GetAllocatedBytes() < image.GetSizeInBytes());
+}
+
+//-----------------------------------------------------------------------------
+// Name: TestImageBuffer()
+//-----------------------------------------------------------------------------
+void TestImageBuffer()
+{
+    TestImageBufferLayout(D3DFMT_A8R8G8B8, 37, 19, 1);
+    TestImageBufferLayout(D3DFMT_R8G8B8,   33, 70, 1);
+    TestImageBufferLayout(D3DFMT_R5G6B5,  256,  1, 1);
+    TestImageBufferLayout(D3DFMT_L8,        1, 55, 1);
+    TestImageBufferLayout(D3DFMT_DXT1,     36, 20, 1);
+    TestImageBufferLayout(D3DFMT_DXT5,     64, 64, 1);
+    TestImageBufferLayout(D3DFMT_A8R8G8B8, 16,  8, 5);
+    TestImageBufferLazy();
+
+    CHECK(ImageBuffer::GetMaxMipLevels(1, 1)    == 1);
+    CHECK(ImageBuffer::GetMaxMipLevels(256, 3)  == 9);
+    CHECK(ImageBuffer::GetMaxMipLevels(37, 100) == 7);
+    CHECK(ImageBuffer::GetSizeInBytes(D3DFMT_DXT1, 4, 4, 0) == 3 * 8);
+    CHECK(ImageBuffer::GetSizeInBytes(D3DFMT_A8R8G8B8, 4, 2, 0) == (8 + 2 + 1) * 4);
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetMipAlignment()
+// Desc: the offset granularity a texture of the passed in size must get
+//-----------------------------------------------------------------------------
+long GetMipAlignment(AtlasDesc const &desc, long width, long height)
+{
+    long alignment = ImageBuffer::IsDXTnFormat(desc.format) ? 4 : 1;
+    if (desc.mipMaps)
+        while (alignment * 2 <= (std::min)(width, height))
+            alignment *= 2;
+    return alignment;
+}
+
+//-----------------------------------------------------------------------------
+// Name: TestPacker()
+// Desc: places textures of random sizes until the atlas is full, and checks
+//       that each one lies inside the atlas, at its alignment, w/ its margin,
+//       and overlaps none of the others
+//-----------------------------------------------------------------------------
+void TestPacker(char const *pName, AtlasDesc const &desc, bool allowRotation, LONG margin, unsigned seed)
+{
+    Packer2D *pPacker = Packer2D::Create(pName, allowRotation, desc);
+    CHECK(pPacker != nullptr);
+    if (pPacker == nullptr)
+        return;
+
+    std::mt19937                         random(seed);
+    std::uniform_int_distribution<long>  sideLog(0, 7);
+    std::uniform_int_distribution<long>  side(1, 160);
+    std::vector<Region>                  placed;
+    long const                           kBlockFactor = ImageBuffer::IsDXTnFormat(desc.format) ? 4 : 1;
+    int                                  numFailed    = 0;
+
+    for (int i = 0; (i < 2000) && (numFailed < 200); ++i)
+    {
+        // half of them powers of 2, as most textures are; w/ an auto margin
+        // start w/ one that leaves room for the margin in one orientation only
+        long width  = (i % 2 == 0) ? (1L << sideLog(random)) : side(random);
+        long height = (i % 4 == 0) ? width : ((i % 2 == 0) ? (1L << sideLog(random)) : side(random));
+        if ((i == 0) && (margin == kAutoMargin))
+        {
+            width  = desc.width / 10;
+            height = desc.height - 4;
+        }
+        width  = ((width  + kBlockFactor - 1) / kBlockFactor) * kBlockFactor;
+        height = ((height + kBlockFactor - 1) / kBlockFactor) * kBlockFactor;
+
+        Region  region;
+        bool    rotated = false;
+        if (! pPacker->Place(width, height, margin, region, rotated))
+        {
+            ++numFailed;
+            continue;
+        }
+        CHECK(allowRotation || ! rotated);
+
+        long const kWidth  = rotated ? height : width;
+        long const kHeight = rotated ? width  : height;
+        long const kMargin = region.GetWidth() - kWidth;
+        long const kAlign  = GetMipAlignment(desc, width, height);
+
+        CHECK(region.GetHeight() - kHeight == kMargin);
+        if (margin == kAutoMargin)
+            CHECK(kMargin == (std::max)(0L, (std::min)(kAlign, (std::min)(desc.width - kWidth, desc.height - kHeight))));
+        else
+            CHECK(kMargin == margin);
+
+        CHECK((region.mLeft >= 0) && (region.mTop >= 0));
+        CHECK((region.mRight <= desc.width) && (region.mBottom <= desc.height));
+        CHECK((region.mLeft % kAlign == 0) && (region.mTop % kAlign == 0));
+
+        for (size_t j = 0; j < placed.size(); ++j)
+            CHECK(! placed[j].Intersect(region));
+        placed.push_back(region);
+    }
+    CHECK(placed.size() > 1);
+    delete pPacker;
+}
+
+//-----------------------------------------------------------------------------
+// Name: TestPackers()
+//-----------------------------------------------------------------------------
+void TestPackers()
+{
+    static char const * const kPackers[] =
+    {
+        "grid", "maxrects", "maxrects:baf", "maxrects:bl", "maxrects:cp", "skyline", "skyline:waste",
+        "guillotine", "guillotine:bssf:las", "guillotine:merge", "bitmap",
+    };
+
+    AtlasDesc desc;
+    desc.width   = 1024;
+    desc.height  = 512;
+
+    for (size_t i = 0; i < sizeof(kPackers) / sizeof(kPackers[0]); ++i)
+    {
+        CHECK(Packer2D::IsValidPackerName(kPackers[i]));
+        for (int rotate = 0; rotate < 2; ++rotate)
+        {
+            desc.format  = D3DFMT_A8R8G8B8;
+            desc.mipMaps = false;
+            TestPacker(kPackers[i], desc, rotate != 0, 0, 1u + i);
+            TestPacker(kPackers[i], desc, rotate != 0, 3, 2u + i);
+
+            desc.mipMaps = true;
+            TestPacker(kPackers[i], desc, rotate != 0, 0, 3u + i);
+            TestPacker(kPackers[i], desc, rotate != 0, kAutoMargin, 4u + i);
+
+            desc.format  = D3DFMT_DXT5;
+            TestPacker(kPackers[i], desc, rotate != 0, 0, 5u + i);
+            TestPacker(kPackers[i], desc, rotate != 0, kAutoMargin, 6u + i);
+        }
+    }
+    CHECK(! Packer2D::IsValidPackerName("maxrects:nope"));
+    CHECK(! Packer2D::IsValidPackerName(nullptr));
+}
+
+//-----------------------------------------------------------------------------
+// Name: TestFormatConverter()
+// Desc: converts random A8R8G8B8 texels to each format; those texels must
+//       come back unchanged when converted to A8R8G8B8 and back again.  All
+//       row lengths are converted at once and texel by texel, so the SIMD
+//       and the scalar code are compared.
+//-----------------------------------------------------------------------------
+void TestFormatConverter()
+{
+    static D3DFORMAT const kFormats[] =
+    {
+        D3DFMT_A8R8G8B8, D3DFMT_X8R8G8B8, D3DFMT_A8B8G8R8, D3DFMT_X8B8G8R8, D3DFMT_R8G8B8,
+        D3DFMT_R5G6B5, D3DFMT_X1R5G5B5, D3DFMT_A1R5G5B5, D3DFMT_A4R4G4B4, D3DFMT_X4R4G4B4,
+        D3DFMT_L8, D3DFMT_A8L8, D3DFMT_A8,
+    };
+    long const kMaxTexels = 37;
+
+    std::mt19937             random(42);
+    std::vector<uint32_t>    source(kMaxTexels);
+    for (long i = 0; i < kMaxTexels; ++i)
+        source[i] = static_cast<uint32_t>(random());
+
+    for (size_t f = 0; f < sizeof(kFormats) / sizeof(kFormats[0]); ++f)
+    {
+        D3DFORMAT const kFormat = kFormats[f];
+        CHECK(FormatConverter::CanConvertFrom(kFormat));
+        if (! FormatConverter::CanConvertTo(kFormat))
+            continue;
+
+        size_t const kBytes = ImageBuffer::SizeOfTexel(kFormat) / 8;
+        for (long n = 1; n <= kMaxTexels; ++n)
+        {
+            std::vector<UCHAR>      texels(n * kBytes), single(n * kBytes), again(n * kBytes);
+            std::vector<uint32_t>   wide(n);
+
+            FormatConverter::ConvertRow(D3DFMT_A8R8G8B8, reinterpret_cast<UCHAR const *>(&source[0]), kFormat, &texels[0], n);
+            for (long i = 0; i < n; ++i)
+                FormatConverter::ConvertRow(D3DFMT_A8R8G8B8, reinterpret_cast<UCHAR const *>(&source[i]), kFormat, &single[i * kBytes], 1);
+            CHECK(texels == single);
+
+            FormatConverter::ConvertRow(kFormat, &texels[0], D3DFMT_A8R8G8B8, reinterpret_cast<UCHAR *>(&wide[0]), n);
+            FormatConverter::ConvertRow(D3DFMT_A8R8G8B8, reinterpret_cast<UCHAR const *>(&wide[0]), kFormat, &again[0], n);
+            CHECK(texels == again);
+        }
+    }
+
+    // widening replicates the high bits, missing alpha is opaque
+    uint16_t const  k565[2] = { 0xffff, 0x8410 };
+    uint32_t        wide[2];
+    FormatConverter::ConvertRow(D3DFMT_R5G6B5, reinterpret_cast<UCHAR const *>(k565), D3DFMT_A8R8G8B8, reinterpret_cast<UCHAR *>(wide), 2);
+    CHECK(wide[0] == 0xffffffffu);
+    CHECK(wide[1] == 0xff848284u);
+
+    // narrowing rounds
+    uint32_t const  k8888 = 0x80ff7f03u;
+    uint16_t        narrow;
+    FormatConverter::ConvertRow(D3DFMT_A8R8G8B8, reinterpret_cast<UCHAR const *>(&k8888), D3DFMT_A4R4G4B4, reinterpret_cast<UCHAR *>(&narrow), 1);
+    CHECK(narrow == 0x8f70);
+
+    CHECK(FormatConverter::ParseFormat("565") == D3DFMT_R5G6B5);
+    CHECK(FormatConverter::ParseFormat("a8r8g8b8") == D3DFMT_A8R8G8B8);
+}
+
+//-----------------------------------------------------------------------------
+// Name: Expand565()
+// Desc: returns an R5G6B5 color as A8R8G8B8, opaque
+//-----------------------------------------------------------------------------
+uint32_t Expand565(uint16_t color)
+{
+    uint32_t const r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    return   0xff000000u | (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8)
+           | ((b << 3) | (b >> 2));
+}
+
+//-----------------------------------------------------------------------------
+// Name: Blend()
+// Desc: returns (a * wa + b * wb) / (wa + wb), channel by channel
+//-----------------------------------------------------------------------------
+uint32_t Blend(uint32_t a, int wa, uint32_t b, int wb)
+{
+    uint32_t result = 0xff000000u;
+    for (int shift = 0; shift < 24; shift += 8)
+        result |= ((((a >> shift) & 255) * wa + ((b >> shift) & 255) * wb) / (wa + wb)) << shift;
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+// Name: DecodeColorBlock()
+// Desc: reference decoder of a DXT1 (BC1) color block
+//-----------------------------------------------------------------------------
+void DecodeColorBlock(UCHAR const block[8], bool allowThreeColors, uint32_t texels[16])
+{
+    uint16_t const kColor0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    uint16_t const kColor1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+
+    uint32_t palette[4];
+    palette[0] = Expand565(kColor0);
+    palette[1] = Expand565(kColor1);
+    if ((kColor0 > kColor1) || ! allowThreeColors)
+    {
+        palette[2] = Blend(palette[0], 2, palette[1], 1);
+        palette[3] = Blend(palette[0], 1, palette[1], 2);
+    }
+    else
+    {
+        palette[2] = Blend(palette[0], 1, palette[1], 1);
+        palette[3] = 0;
+    }
+
+    uint32_t const kIndices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+    for (int i = 0; i < 16; ++i)
+        texels[i] = palette[(kIndices >> (2 * i)) & 3];
+}
+
+//-----------------------------------------------------------------------------
+// Name: DecodeAlphaBlock()
+// Desc: reference decoder of a DXT5 alpha (BC4) block
+//-----------------------------------------------------------------------------
+void DecodeAlphaBlock(UCHAR const block[8], UCHAR values[16])
+{
+    int palette[8];
+    palette[0] = block[0];
+    palette[1] = block[1];
+    if (block[0] > block[1])
+    {
+        for (int i = 1; i < 7; ++i)
+            palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+    }
+    else
+    {
+        for (int i = 1; i < 5; ++i)
+            palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; ++i)
+        indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+    for (int i = 0; i < 16; ++i)
+        values[i] = static_cast<UCHAR>(palette[(indices >> (3 * i)) & 7]);
+}
+
+//-----------------------------------------------------------------------------
+// Name: GetColorError()
+// Desc: returns the largest difference of any color channel of two texels
+//-----------------------------------------------------------------------------
+int GetColorError(uint32_t a, uint32_t b)
+{
+    int error = 0;
+    for (int shift = 0; shift < 24; shift += 8)
+        error = (std::max)(error, abs(static_cast<int>((a >> shift) & 255) - static_cast<int>((b >> shift) & 255)));
+    return error;
+}
+
+//-----------------------------------------------------------------------------
+// Name: TestDXTCompressor()
+// Desc: compresses blocks at each quality and checks them w/ the reference
+//       decoders: colors the block format holds exactly must come back
+//       exactly, smooth gradients close, and DXT1 alpha below 128 as
+//       transparent texels
+//-----------------------------------------------------------------------------
+void TestDXTCompressor()
+{
+    static DXTCompressor::eQuality const kQualities[] =
+    {
+        DXTCompressor::QUALITY_FAST, DXTCompressor::QUALITY_NORMAL, DXTCompressor::QUALITY_BEST,
+    };
+
+    std::mt19937 random(7);
+    for (int q = 0; q < 3; ++q)
+    {
+        DXTCompressor::eQuality const kQuality = kQualities[q];
+        for (int trial = 0; trial < 200; ++trial)
+        {
+            uint32_t    texels[16], decoded[16];
+            UCHAR       block[16], values[16], decodedValues[16];
+
+            // a single color that R5G6B5 holds
+            uint32_t const kColor = Expand565(static_cast<uint16_t>(random()));
+            for (int i = 0; i < 16; ++i)
+                texels[i] = kColor;
+            DXTCompressor::CompressBlockDXT1(texels, kQuality, block);
+            DecodeColorBlock(block, true, decoded);
+            CHECK(std::equal(texels, texels + 16, decoded));
+
+            DXTCompressor::CompressBlockDXT5(texels, kQuality, block);
+            DecodeColorBlock(block + 8, false, decoded);
+            CHECK(std::equal(texels, texels + 16, decoded));
+            DecodeAlphaBlock(block, values);
+            CHECK(std::count(values, values + 16, 255) == 16);
+
+            // a gradient between two colors
+            uint32_t const kFrom = static_cast<uint32_t>(random()), kTo = static_cast<uint32_t>(random());
+            for (int i = 0; i < 16; ++i)
+                texels[i] = Blend(kFrom, 15 - i, kTo, i);
+            DXTCompressor::CompressBlockDXT5(texels, kQuality, block);
+            DecodeColorBlock(block + 8, false, decoded);
+            int error = 0;
+            for (int i = 0; i < 16; ++i)
+                error = (std::max)(error, GetColorError(texels[i], decoded[i]));
+            CHECK(error <= 48);
+
+            // DXT1 alpha: transparent below 128, opaque otherwise
+            for (int i = 0; i < 16; ++i)
+                texels[i] = (kColor & 0x00ffffffu) | ((random() % 2 != 0) ? 0xff000000u : 0x40000000u);
+            DXTCompressor::CompressBlockDXT1(texels, kQuality, block);
+            DecodeColorBlock(block, true, decoded);
+            for (int i = 0; i < 16; ++i)
+                CHECK((texels[i] >> 24 == 0xff) ? (decoded[i] == kColor) : (decoded[i] == 0));
+
+            // one channel blocks: two values come back exactly, a range
+            // w/ an error of at most half of a palette step
+            UCHAR const kLow = static_cast<UCHAR>(random() % 128), kHigh = static_cast<UCHAR>(128 + random() % 128);
+            for (int i = 0; i < 16; ++i)
+                values[i] = (random() % 2 != 0) ? kLow : kHigh;
+            DXTCompressor::CompressBlockATI1(values, kQuality, block);
+            DecodeAlphaBlock(block, decodedValues);
+            CHECK(std::equal(values, values + 16, decodedValues));
+
+            for (int i = 0; i < 16; ++i)
+                values[i] = static_cast<UCHAR>(kLow + (kHigh - kLow) * i / 15);
+            DXTCompressor::CompressBlockATI2(values, values, kQuality, block);
+            for (int half = 0; half < 2; ++half)
+            {
+                DecodeAlphaBlock(block + 8 * half, decodedValues);
+                error = 0;
+                for (int i = 0; i < 16; ++i)
+                    error = (std::max)(error, abs(values[i] - decodedValues[i]));
+                CHECK(error <= (kHigh - kLow) / 14 + 2);
+            }
+        }
+    }
+}
+
+struct TestGroup
+{
+    char const *    pName;
+    void            (*pTest)();
+};
+
+TestGroup const kGroups[] =
+{
+    { "ImageBuffer",        TestImageBuffer },
+    { "Packers",            TestPackers },
+    { "FormatConverter",    TestFormatConverter },
+    { "DXTCompressor",      TestDXTCompressor },
+};
+
+} // namespace
+
+//-----------------------------------------------------------------------------
+// Name: main()
+// Desc: runs the test groups named on the command line, or all of them
+//-----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+    size_t const kNumGroups = sizeof(kGroups) / sizeof(kGroups[0]);
+    for (size_t i = 0; i < kNumGroups; ++i)
+    {
+        bool run = (argc < 2);
+        for (int arg = 1; arg < argc; ++arg)
+            run = run || (strcmp(argv[arg], kGroups[i].pName) == 0);
+        if (! run)
+            continue;
+
+        int const kFailed = gNumFailed;
+        kGroups[i].pTest();
+        printf("%-16s %s\n", kGroups[i].pName, (gNumFailed == kFailed) ? "passed" : "FAILED");
+    }
+
+    printf("%d checks, %d failed\n", gNumChecks, gNumFailed);
+    return (gNumFailed == 0) ? 0 : 1;
+}